@@ -49,6 +49,11 @@ android {
         }
         debug {
             applicationIdSuffix += ".debug"
+            externalNativeBuild {
+                cmake {
+                    arguments += "-DUSB_VIDEO_TRACING=ON"
+                }
+            }
         }
     }
     compileOptions {
@@ -0,0 +1,43 @@
+#version 300 es
+precision mediump float;
+in vec2 vTexCoord;
+out vec4 fragColor;
+// Converted RGB frames with image row 0 in texture row 0.
+uniform sampler2D uCurrent;
+uniform sampler2D uPrevious;
+// Row parity of the field being shown: 0 for the top field (even rows), 1 for the bottom one.
+uniform int uFieldParity;
+// The rows of the other field are the ones shown just before this field: the same frame's for
+// the second field, the previous frame's for the first.
+uniform int uWeaveFromPrevious;
+// Weaves where nothing moved instead of always interpolating the missing rows.
+uniform int uMotionAdaptive;
+
+const vec3 LUMA = vec3(0.299, 0.587, 0.114);
+
+float motionAt(ivec2 pos) {
+    return abs(dot(texelFetch(uCurrent, pos, 0).rgb - texelFetch(uPrevious, pos, 0).rgb, LUMA));
+}
+
+void main() {
+    ivec2 size = textureSize(uCurrent, 0);
+    ivec2 pos = clamp(ivec2(vTexCoord * vec2(size)), ivec2(0), size - 1);
+    if ((pos.y & 1) == uFieldParity) {
+        fragColor = vec4(texelFetch(uCurrent, pos, 0).rgb, 1.0);
+        return;
+    }
+
+    // Bob: the missing row interpolated from the rows of this field around it.
+    ivec2 above = ivec2(pos.x, pos.y > 0 ? pos.y - 1 : pos.y + 1);
+    ivec2 below = ivec2(pos.x, pos.y + 1 < size.y ? pos.y + 1 : pos.y - 1);
+    vec3 bob = 0.5 * (texelFetch(uCurrent, above, 0).rgb + texelFetch(uCurrent, below, 0).rgb);
+    if (uMotionAdaptive == 0) {
+        fragColor = vec4(bob, 1.0);
+        return;
+    }
+
+    vec3 weave = uWeaveFromPrevious == 1 ? texelFetch(uPrevious, pos, 0).rgb : texelFetch(uCurrent, pos, 0).rgb;
+    // Each row compared with the same row one frame earlier, so both fields are checked.
+    float motion = max(motionAt(pos), max(motionAt(above), motionAt(below)));
+    fragColor = vec4(mix(weave, bob, smoothstep(0.02, 0.08, motion)), 1.0);
+}
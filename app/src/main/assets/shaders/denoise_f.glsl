@@ -0,0 +1,43 @@
+#version 300 es
+precision mediump float;
+in vec2 vTexCoord;
+out vec4 fragColor;
+// The converted frame and the previous output, at the same size.
+uniform sampler2D uCurrent;
+uniform sampler2D uHistory;
+// Weight of the history where a pixel did not change.
+uniform float uStrength;
+
+// A neighbour only replaces the co-located history pixel when it matches this much better, so
+// still noise is not blurred sideways.
+const float NEIGHBOUR_BIAS = 0.004;
+
+const ivec2 NEIGHBOURS[4] = ivec2[4](ivec2(-1, 0), ivec2(1, 0), ivec2(0, -1), ivec2(0, 1));
+
+float difference(vec3 a, vec3 b) {
+    return dot(abs(a - b), vec3(1.0 / 3.0));
+}
+
+void main() {
+    ivec2 size = textureSize(uCurrent, 0);
+    ivec2 pos = clamp(ivec2(vTexCoord * vec2(size)), ivec2(0), size - 1);
+    vec3 current = texelFetch(uCurrent, pos, 0).rgb;
+
+    // Instead of a motion search, the history is taken from the best match among the pixel and
+    // its four neighbours, which follows jitter and slow pans of up to one pixel per frame.
+    vec3 history = texelFetch(uHistory, pos, 0).rgb;
+    float change = difference(current, history);
+    for (int i = 0; i < 4; i++) {
+        vec3 candidate = texelFetch(uHistory, clamp(pos + NEIGHBOURS[i], ivec2(0), size - 1), 0).rgb;
+        float candidateChange = difference(current, candidate) + NEIGHBOUR_BIAS;
+        if (candidateChange < change) {
+            history = candidate;
+            change = candidateChange;
+        }
+    }
+
+    // Changes the size of sensor and compression noise are averaged away; larger ones are motion
+    // and take the current pixel, so moving edges do not trail.
+    float weight = uStrength * (1.0 - smoothstep(0.02, 0.08, change));
+    fragColor = vec4(mix(current, history, weight), 1.0);
+}
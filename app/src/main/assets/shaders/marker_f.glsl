@@ -0,0 +1,76 @@
+#version 300 es
+precision highp float;
+precision highp int;
+in vec2 vTexCoord;
+out vec4 fragColor;
+// Top left corner of the marker in window pixels, with y growing upwards, and the size of a cell.
+uniform vec2 uOrigin;
+uniform float uCell;
+// Capture sequence number, capture time in milliseconds and the XOR of their eight bytes.
+uniform uvec3 uWords;
+
+// Layout in cells; must be kept in sync with FrameMarker.h and FrameMarkerDecoder.kt.
+const int MARGIN = 2;
+const int BITS = 78;
+const int BAR_ROWS = 6;
+const int DIGIT_TOP = MARGIN + BAR_ROWS + 2;
+const int DIGIT_WIDTH = 3;
+const int DIGIT_ROWS = 5;
+const int DIGIT_PITCH = 4;
+const int SEQUENCE_DIGITS = 8;
+const int TIME_DIGITS = 9;
+const int TIME_LEFT = MARGIN + (SEQUENCE_DIGITS + 1) * DIGIT_PITCH;
+
+// Segments a to g of the digits 0 to 9.
+const int SEGMENTS[10] = int[10](0x3f, 0x06, 0x5b, 0x4f, 0x66, 0x6d, 0x7d, 0x07, 0x7f, 0x6f);
+
+// Guard bits 101, the two words and the checksum byte, most significant bit first, and 101.
+bool bit(int index) {
+    if (index < 3) return index != 1;
+    if (index >= BITS - 3) return index != BITS - 2;
+    int data = index - 3;
+    uint word = data < 32 ? uWords.x : data < 64 ? uWords.y : uWords.z << 24;
+    return ((word >> uint(31 - data % 32)) & 1u) == 1u;
+}
+
+// Whether cell (x, y) of a 3x5 cell seven-segment digit is lit.
+bool digitCell(uint digit, int x, int y) {
+    int segments = SEGMENTS[int(digit)];
+    bool left = x == 0;
+    bool right = x == DIGIT_WIDTH - 1;
+    bool upper = y <= 2;
+    bool lower = y >= 2;
+    return (y == 0 && (segments & 0x01) != 0)
+            || (right && upper && (segments & 0x02) != 0)
+            || (right && lower && (segments & 0x04) != 0)
+            || (y == DIGIT_ROWS - 1 && (segments & 0x08) != 0)
+            || (left && lower && (segments & 0x10) != 0)
+            || (left && upper && (segments & 0x20) != 0)
+            || (y == 2 && (segments & 0x40) != 0);
+}
+
+// Whether cell (x, y) of a right aligned decimal number of the given digits is lit.
+bool numberCell(uint value, int digits, int x, int y) {
+    int position = x / DIGIT_PITCH;
+    int column = x % DIGIT_PITCH;
+    if (position >= digits || column >= DIGIT_WIDTH) return false;
+    for (int i = position + 1; i < digits; i++) value /= 10u;
+    return digitCell(value % 10u, column, y);
+}
+
+void main() {
+    vec2 local = vec2(gl_FragCoord.x - uOrigin.x, uOrigin.y - gl_FragCoord.y);
+    ivec2 cell = ivec2(floor(local / uCell));
+    bool lit = false;
+    if (cell.y >= MARGIN && cell.y < MARGIN + BAR_ROWS && cell.x >= MARGIN && cell.x < MARGIN + BITS) {
+        lit = bit(cell.x - MARGIN);
+    } else if (cell.y >= DIGIT_TOP && cell.y < DIGIT_TOP + DIGIT_ROWS) {
+        int y = cell.y - DIGIT_TOP;
+        if (cell.x >= TIME_LEFT) {
+            lit = numberCell(uWords.y % 1000000000u, TIME_DIGITS, cell.x - TIME_LEFT, y);
+        } else if (cell.x >= MARGIN) {
+            lit = numberCell(uWords.x % 100000000u, SEQUENCE_DIGITS, cell.x - MARGIN, y);
+        }
+    }
+    fragColor = lit ? vec4(1.0) : vec4(0.0, 0.0, 0.0, 1.0);
+}
@@ -0,0 +1,100 @@
+#version 300 es
+precision highp float;
+in vec2 vTexCoord;
+out vec4 fragColor;
+// One direction of a separable resampling filter. The horizontal pass reads the frame (or one of
+// its mipmap levels) and writes rows of output width; the vertical pass reads those rows and
+// writes the window.
+uniform sampler2D uSource;
+uniform int uLevel;
+uniform int uKernel;
+// Source texels per output pixel along the filtered axis.
+uniform float uScale;
+uniform float uSharpness;
+layout (std140) uniform Overlay {
+    highp mat4 uMVPMatrix;
+    highp float uTime;
+    highp int uShowZebra;
+    highp int uTransfer;
+    highp int uToneMap;
+};
+
+const int KERNEL_LANCZOS = 1;
+const float PI = 3.14159265;
+
+// Catmull-Rom
+float cubic(float x) {
+    x = abs(x);
+    if (x < 1.0) return (1.5 * x - 2.5) * x * x + 1.0;
+    if (x < 2.0) return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+    return 0.0;
+}
+
+float lanczos3(float x) {
+    x = abs(x);
+    if (x < 1e-4) return 1.0;
+    if (x >= 3.0) return 0.0;
+    float px = PI * x;
+    return 3.0 * sin(px) * sin(px / 3.0) / (px * px);
+}
+
+void main() {
+    ivec2 size = textureSize(uSource, uLevel);
+#ifdef VERTICAL
+    int extent = size.y;
+    float position = vTexCoord.y;
+    int fixedCoord = clamp(int(vTexCoord.x * float(size.x)), 0, size.x - 1);
+#else
+    int extent = size.x;
+    float position = vTexCoord.x;
+    int fixedCoord = clamp(int(vTexCoord.y * float(size.y)), 0, size.y - 1);
+#endif
+
+    // The kernel is stretched over the source texels that map to one output pixel when
+    // reducing, which is what keeps downscaling from aliasing.
+    float support = uKernel == KERNEL_LANCZOS ? 3.0 : 2.0;
+    float stretch = max(uScale, 1.0);
+    float center = position * float(extent) - 0.5;
+    int first = int(floor(center - support * stretch)) + 1;
+    int last = int(floor(center + support * stretch));
+    vec3 sum = vec3(0.0);
+    float weightSum = 0.0;
+    for (int i = first; i <= last; i++) {
+        float x = (float(i) - center) / stretch;
+        float weight = uKernel == KERNEL_LANCZOS ? lanczos3(x) : cubic(x);
+        int coord = clamp(i, 0, extent - 1);
+#ifdef VERTICAL
+        vec3 texel = texelFetch(uSource, ivec2(fixedCoord, coord), uLevel).rgb;
+#else
+        vec3 texel = texelFetch(uSource, ivec2(coord, fixedCoord), uLevel).rgb;
+#endif
+        sum += weight * texel;
+        weightSum += weight;
+    }
+    vec4 color = vec4(clamp(sum / weightSum, 0.0, 1.0), 1.0);
+
+#ifdef VERTICAL
+    if (uSharpness > 0.0) {
+        // Unsharp mask against the neighbouring output columns and source rows.
+        ivec2 pos = ivec2(fixedCoord, clamp(int(floor(center + 0.5)), 0, extent - 1));
+        vec3 middle = texelFetch(uSource, pos, 0).rgb;
+        vec3 blur = 0.25 * (texelFetch(uSource, ivec2(max(pos.x - 1, 0), pos.y), 0).rgb +
+                            texelFetch(uSource, ivec2(min(pos.x + 1, size.x - 1), pos.y), 0).rgb +
+                            texelFetch(uSource, ivec2(pos.x, max(pos.y - 1, 0)), 0).rgb +
+                            texelFetch(uSource, ivec2(pos.x, min(pos.y + 1, extent - 1)), 0).rgb);
+        color.rgb = clamp(color.rgb + uSharpness * (middle - blur), 0.0, 1.0);
+    }
+    if (uShowZebra == 1) {
+        float luma = dot(color.rgb, vec3(0.299, 0.587, 0.114));
+        float stripe = mod((gl_FragCoord.x - gl_FragCoord.y + uTime * 0.05), 16.0);
+        if (stripe < 6.0) {
+            if (luma >= 0.85) {
+                color = vec4(1.0, 0.0, 0.0, 1.0);
+            } else if (luma >= 0.8) {
+                color = vec4(0.0, 1.0, 0.0, 1.0);
+            }
+        }
+    }
+#endif
+    fragColor = color;
+}
@@ -0,0 +1,50 @@
+#version 300 es
+precision highp float;
+in vec2 vTexCoord;
+out vec4 fragColor;
+// Hits of the sampled chroma, decayed over time, with +V at the top row.
+uniform sampler2D uTrace;
+// Size of a window pixel in scope units, which span -1 to 1.
+uniform float uPixel;
+
+// The 75% colour bars, whose chroma the targets mark.
+const vec3 BARS[6] = vec3[6](
+        vec3(0.75, 0.0, 0.0), vec3(0.75, 0.75, 0.0), vec3(0.0, 0.75, 0.0),
+        vec3(0.0, 0.75, 0.75), vec3(0.0, 0.0, 0.75), vec3(0.75, 0.0, 0.75));
+// Direction of skin tones, 123 degrees from +U.
+const vec2 SKIN_TONE = vec2(-0.544639, 0.838671);
+
+vec2 scopePosition(vec3 rgb) {
+    return 2.0 * vec2(dot(rgb, vec3(-0.168736, -0.331264, 0.5)), dot(rgb, vec3(0.5, -0.418688, -0.081312)));
+}
+
+// 1 within width pixels of a line d scope units away, fading out over a pixel.
+float line(float d, float width) {
+    return 1.0 - smoothstep(width * uPixel, (width + 1.0) * uPixel, abs(d));
+}
+
+void main() {
+    vec2 p = vTexCoord * 2.0 - 1.0;
+    float radius = length(p);
+    if (radius > 1.0 + 2.0 * uPixel) discard;
+
+    float graticule = line(radius - 1.0, 0.5) + 0.5 * line(radius - 0.75, 0.5);
+    graticule += 0.35 * (line(p.x, 0.5) + line(p.y, 0.5));
+    float along = dot(p, SKIN_TONE);
+    if (along > 0.0) graticule += 0.6 * line(dot(p, vec2(SKIN_TONE.y, -SKIN_TONE.x)), 0.5);
+    for (int i = 0; i < 6; i++) {
+        vec2 offset = abs(p - scopePosition(BARS[i]));
+        float box = max(offset.x, offset.y);
+        graticule += line(box - 0.04, 0.5);
+    }
+    graticule = min(graticule, 1.0);
+
+    // The trace takes the hue of its chroma at mid luma.
+    float density = 1.0 - exp(-6.0 * texture(uTrace, vTexCoord).r);
+    vec2 uv = 0.5 * p;
+    vec3 hue = clamp(vec3(0.5) + vec3(1.402 * uv.y, -0.344136 * uv.x - 0.714136 * uv.y, 1.772 * uv.x), 0.0, 1.0);
+    vec3 trace = density * mix(vec3(1.0), hue, 0.6);
+
+    vec3 color = max(trace, vec3(0.55) * graticule);
+    fragColor = vec4(color, max(0.6, max(density, graticule)));
+}
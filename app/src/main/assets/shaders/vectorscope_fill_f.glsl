@@ -0,0 +1,8 @@
+#version 300 es
+precision mediump float;
+out vec4 fragColor;
+// Added to, or subtracted from, the trace by the blend state.
+uniform float uIntensity;
+void main() {
+    fragColor = vec4(uIntensity);
+}
@@ -0,0 +1,14 @@
+#version 300 es
+precision highp float;
+// The converted frame, sampled at the centre of each cell of a uGrid grid, one point per cell.
+uniform sampler2D uFrame;
+uniform ivec2 uGrid;
+void main() {
+    ivec2 cell = ivec2(gl_VertexID % uGrid.x, gl_VertexID / uGrid.x);
+    vec3 rgb = textureLod(uFrame, (vec2(cell) + 0.5) / vec2(uGrid), 0.0).rgb;
+    // BT.601 chroma, the inverse of the format programs; +-0.5 reaches the edge of the scope.
+    float u = dot(rgb, vec3(-0.168736, -0.331264, 0.5));
+    float v = dot(rgb, vec3(0.5, -0.418688, -0.081312));
+    gl_Position = vec4(2.0 * u, 2.0 * v, 0.0, 1.0);
+    gl_PointSize = 1.0;
+}
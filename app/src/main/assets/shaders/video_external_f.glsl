@@ -0,0 +1,29 @@
+#version 300 es
+#extension GL_OES_EGL_image_external_essl3 : require
+precision mediump float;
+in vec2 vTexCoord;
+out vec4 fragColor;
+uniform samplerExternalOES uTextureRGBA;
+layout (std140) uniform Overlay {
+    highp mat4 uMVPMatrix;
+    highp float uTime;
+    highp int uShowZebra;
+    highp int uTransfer;
+    highp int uToneMap;
+};
+void main() {
+    // The driver converts the decoder's YUV output to RGB when sampling.
+    vec4 color = texture(uTextureRGBA, vTexCoord);
+    if (uShowZebra == 1) {
+        float luma = dot(color.rgb, vec3(0.299, 0.587, 0.114));
+        float stripe = mod((gl_FragCoord.x - gl_FragCoord.y + uTime * 0.05), 16.0);
+        if (stripe < 6.0) {
+            if (luma >= 0.85) {
+                color = vec4(1.0, 0.0, 0.0, 1.0);
+            } else if (luma >= 0.8) {
+                color = vec4(0.0, 1.0, 0.0, 1.0);
+            }
+        }
+    }
+    fragColor = color;
+}
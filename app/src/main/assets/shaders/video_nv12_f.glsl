@@ -4,8 +4,13 @@ in vec2 vTexCoord;
 out vec4 fragColor;
 uniform sampler2D uTextureY;
 uniform sampler2D uTextureUV;
-uniform float uTime;
-uniform int uShowZebra;
+layout (std140) uniform Overlay {
+    highp mat4 uMVPMatrix;
+    highp float uTime;
+    highp int uShowZebra;
+    highp int uTransfer;
+    highp int uToneMap;
+};
 void main() {
     float y = texture(uTextureY, vTexCoord).r;
     vec2 uv = texture(uTextureUV, vTexCoord).rg;
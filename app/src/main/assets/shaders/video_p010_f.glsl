@@ -0,0 +1,94 @@
+#version 300 es
+precision highp float;
+precision highp usampler2D;
+in vec2 vTexCoord;
+out vec4 fragColor;
+uniform usampler2D uTextureY;
+uniform usampler2D uTextureUV;
+layout (std140) uniform Overlay {
+    highp mat4 uMVPMatrix;
+    highp float uTime;
+    highp int uShowZebra;
+    highp int uTransfer;
+    highp int uToneMap;
+};
+
+const int TRANSFER_PQ = 1;
+const int TRANSFER_HLG = 2;
+const float SDR_WHITE_NITS = 203.0;
+const float HDR_PEAK_NITS = 1000.0;
+
+// Limited range Y'CbCr from the top 10 bits of each 16-bit P010 sample.
+vec3 fetchYCbCr() {
+    ivec2 size = textureSize(uTextureY, 0);
+    ivec2 pos = clamp(ivec2(vTexCoord * vec2(size)), ivec2(0), size - 1);
+    float y = float(texelFetch(uTextureY, pos, 0).r >> 6u);
+    vec2 cbcr = vec2(texelFetch(uTextureUV, pos / 2, 0).rg >> 6u);
+    return vec3((y - 64.0) / 876.0, (cbcr - 512.0) / 896.0);
+}
+
+// SMPTE ST 2084 EOTF, in nits.
+vec3 pqToNits(vec3 e) {
+    const float m1 = 0.1593017578125;
+    const float m2 = 78.84375;
+    const float c1 = 0.8359375;
+    const float c2 = 18.8515625;
+    const float c3 = 18.6875;
+    vec3 p = pow(clamp(e, 0.0, 1.0), vec3(1.0 / m2));
+    return 10000.0 * pow(max(p - c1, 0.0) / (c2 - c3 * p), vec3(1.0 / m1));
+}
+
+// ARIB STD-B67 inverse OETF followed by the BT.2100 OOTF of a display with HDR_PEAK_NITS.
+vec3 hlgToNits(vec3 e) {
+    const float a = 0.17883277;
+    const float b = 0.28466892;
+    const float c = 0.55991073;
+    e = clamp(e, 0.0, 1.0);
+    vec3 scene = mix(e * e / 3.0, (exp((e - c) / a) + b) / 12.0, step(0.5, e));
+    float ys = dot(scene, vec3(0.2627, 0.6780, 0.0593));
+    return HDR_PEAK_NITS * pow(ys, 0.2) * scene;
+}
+
+void main() {
+    vec3 ycbcr = fetchYCbCr();
+    float y = ycbcr.x;
+    float cb = ycbcr.y;
+    float cr = ycbcr.z;
+    vec3 rgb;
+    if (uTransfer == TRANSFER_PQ || uTransfer == TRANSFER_HLG) {
+        // BT.2020 non-constant luminance
+        vec3 encoded = vec3(y + 1.4746 * cr, y - 0.16455 * cb - 0.57135 * cr, y + 1.8814 * cb);
+        vec3 nits = uTransfer == TRANSFER_PQ ? pqToNits(encoded) : hlgToNits(encoded);
+        // BT.2020 to BT.709 primaries, relative to SDR reference white.
+        const mat3 bt2020ToBt709 = mat3(
+                1.6605, -0.1246, -0.0182,
+                -0.5876, 1.1329, -0.1006,
+                -0.0728, -0.0083, 1.1187);
+        vec3 linear = max(bt2020ToBt709 * nits / SDR_WHITE_NITS, 0.0);
+        if (uToneMap == 1) {
+            // Extended Reinhard on luminance, mapping the peak to SDR white.
+            const float peak = HDR_PEAK_NITS / SDR_WHITE_NITS;
+            float l = dot(linear, vec3(0.2126, 0.7152, 0.0722));
+            float mapped = l * (1.0 + l / (peak * peak)) / (1.0 + l);
+            linear *= l > 0.0 ? mapped / l : 0.0;
+        }
+        rgb = pow(clamp(linear, 0.0, 1.0), vec3(1.0 / 2.2));
+    } else {
+        // BT.709
+        rgb = vec3(y + 1.5748 * cr, y - 0.1873 * cb - 0.4681 * cr, y + 1.8556 * cb);
+    }
+    vec4 color = vec4(clamp(rgb, 0.0, 1.0), 1.0);
+
+    if (uShowZebra == 1) {
+        float luma = dot(color.rgb, vec3(0.299, 0.587, 0.114));
+        float stripe = mod((gl_FragCoord.x - gl_FragCoord.y + uTime * 0.05), 16.0);
+        if (stripe < 6.0) {
+            if (luma >= 0.85) {
+                color = vec4(1.0, 0.0, 0.0, 1.0);
+            } else if (luma >= 0.8) {
+                color = vec4(0.0, 1.0, 0.0, 1.0);
+            }
+        }
+    }
+    fragColor = color;
+}
@@ -3,10 +3,20 @@ precision mediump float;
 in vec2 vTexCoord;
 out vec4 fragColor;
 uniform sampler2D uTextureRGBA;
-uniform float uTime;
-uniform int uShowZebra;
+layout (std140) uniform Overlay {
+    highp mat4 uMVPMatrix;
+    highp float uTime;
+    highp int uShowZebra;
+    highp int uTransfer;
+    highp int uToneMap;
+};
 void main() {
     vec4 color = texture(uTextureRGBA, vTexCoord);
+#if defined(BGR)
+    color = vec4(color.bgr, 1.0);
+#elif defined(GRAY)
+    color = vec4(color.rrr, 1.0);
+#endif
     if (uShowZebra == 1) {
         float luma = dot(color.rgb, vec3(0.299, 0.587, 0.114));
         float stripe = mod((gl_FragCoord.x - gl_FragCoord.y + uTime * 0.05), 16.0);
@@ -2,7 +2,13 @@
 layout (location = 0) in vec4 aPosition;
 layout (location = 1) in vec2 aTexCoord;
 out vec2 vTexCoord;
-uniform mat4 uMVPMatrix;
+layout (std140) uniform Overlay {
+    highp mat4 uMVPMatrix;
+    highp float uTime;
+    highp int uShowZebra;
+    highp int uTransfer;
+    highp int uToneMap;
+};
 void main() {
     gl_Position = uMVPMatrix * aPosition;
     vTexCoord = aTexCoord;
@@ -0,0 +1,32 @@
+#version 300 es
+precision highp float;
+precision highp usampler2D;
+in vec2 vTexCoord;
+out vec4 fragColor;
+uniform usampler2D uTextureY;
+layout (std140) uniform Overlay {
+    highp mat4 uMVPMatrix;
+    highp float uTime;
+    highp int uShowZebra;
+    highp int uTransfer;
+    highp int uToneMap;
+};
+void main() {
+    ivec2 size = textureSize(uTextureY, 0);
+    ivec2 pos = clamp(ivec2(vTexCoord * vec2(size)), ivec2(0), size - 1);
+    float y = float(texelFetch(uTextureY, pos, 0).r) / 65535.0;
+    vec4 color = vec4(y, y, y, 1.0);
+
+    if (uShowZebra == 1) {
+        float luma = dot(color.rgb, vec3(0.299, 0.587, 0.114));
+        float stripe = mod((gl_FragCoord.x - gl_FragCoord.y + uTime * 0.05), 16.0);
+        if (stripe < 6.0) {
+            if (luma >= 0.85) {
+                color = vec4(1.0, 0.0, 0.0, 1.0);
+            } else if (luma >= 0.8) {
+                color = vec4(0.0, 1.0, 0.0, 1.0);
+            }
+        }
+    }
+    fragColor = color;
+}
@@ -0,0 +1,52 @@
+#version 300 es
+precision highp float;
+in vec2 vTexCoord;
+out vec4 fragColor;
+// Planar 4:2:0 as one single channel texture: the Y plane with the two chroma planes below it.
+uniform sampler2D uTextureY;
+layout (std140) uniform Overlay {
+    highp mat4 uMVPMatrix;
+    highp float uTime;
+    highp int uShowZebra;
+    highp int uTransfer;
+    highp int uToneMap;
+};
+
+float fetchSample(int index, int width, int firstRow) {
+    return texelFetch(uTextureY, ivec2(index % width, firstRow + index / width), 0).r;
+}
+
+void main() {
+    ivec2 size = textureSize(uTextureY, 0);
+    ivec2 frameSize = ivec2(size.x, size.y * 2 / 3);
+    ivec2 pos = clamp(ivec2(vTexCoord * vec2(frameSize)), ivec2(0), frameSize - 1);
+    float y = texelFetch(uTextureY, pos, 0).r;
+
+    // Chroma planes are half as wide as the texture, so each texture row holds two of their rows.
+    int chromaIndex = (pos.y / 2) * (frameSize.x / 2) + pos.x / 2;
+    int chromaPlaneSize = frameSize.x * frameSize.y / 4;
+#ifdef YV12
+    float v = fetchSample(chromaIndex, frameSize.x, frameSize.y) - 0.5;
+    float u = fetchSample(chromaIndex + chromaPlaneSize, frameSize.x, frameSize.y) - 0.5;
+#else
+    float u = fetchSample(chromaIndex, frameSize.x, frameSize.y) - 0.5;
+    float v = fetchSample(chromaIndex + chromaPlaneSize, frameSize.x, frameSize.y) - 0.5;
+#endif
+    float r = y + 1.402 * v;
+    float g = y - 0.34414 * u - 0.71414 * v;
+    float b = y + 1.772 * u;
+    vec4 color = vec4(r, g, b, 1.0);
+
+    if (uShowZebra == 1) {
+        float luma = dot(color.rgb, vec3(0.299, 0.587, 0.114));
+        float stripe = mod((gl_FragCoord.x - gl_FragCoord.y + uTime * 0.05), 16.0);
+        if (stripe < 6.0) {
+            if (luma >= 0.85) {
+                color = vec4(1.0, 0.0, 0.0, 1.0);
+            } else if (luma >= 0.8) {
+                color = vec4(0.0, 1.0, 0.0, 1.0);
+            }
+        }
+    }
+    fragColor = color;
+}
@@ -0,0 +1,46 @@
+#version 300 es
+precision highp float;
+in vec2 vTexCoord;
+out vec4 fragColor;
+// Packed 4:2:2, one RGBA texel per two pixels.
+uniform sampler2D uTextureY;
+layout (std140) uniform Overlay {
+    highp mat4 uMVPMatrix;
+    highp float uTime;
+    highp int uShowZebra;
+    highp int uTransfer;
+    highp int uToneMap;
+};
+void main() {
+    ivec2 size = textureSize(uTextureY, 0);
+    ivec2 frameSize = ivec2(size.x * 2, size.y);
+    ivec2 pos = clamp(ivec2(vTexCoord * vec2(frameSize)), ivec2(0), frameSize - 1);
+    vec4 texel = texelFetch(uTextureY, ivec2(pos.x / 2, pos.y), 0);
+    bool even = (pos.x & 1) == 0;
+#ifdef UYVY
+    float y = even ? texel.g : texel.a;
+    float u = texel.r - 0.5;
+    float v = texel.b - 0.5;
+#else
+    float y = even ? texel.r : texel.b;
+    float u = texel.g - 0.5;
+    float v = texel.a - 0.5;
+#endif
+    float r = y + 1.402 * v;
+    float g = y - 0.34414 * u - 0.71414 * v;
+    float b = y + 1.772 * u;
+    vec4 color = vec4(r, g, b, 1.0);
+
+    if (uShowZebra == 1) {
+        float luma = dot(color.rgb, vec3(0.299, 0.587, 0.114));
+        float stripe = mod((gl_FragCoord.x - gl_FragCoord.y + uTime * 0.05), 16.0);
+        if (stripe < 6.0) {
+            if (luma >= 0.85) {
+                color = vec4(1.0, 0.0, 0.0, 1.0);
+            } else if (luma >= 0.8) {
+                color = vec4(0.0, 1.0, 0.0, 1.0);
+            }
+        }
+    }
+    fragColor = color;
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "AudioSpectrum.h"
+
+#include <android/log.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+
+#include "ThreadPolicy.h"
+#include "Trace.h"
+
+#define ULOGI(...) __android_log_print(ANDROID_LOG_INFO, "AudioSpectrum", __VA_ARGS__)
+
+namespace {
+
+constexpr auto kAnalysisInterval = duration_cast<nanoseconds>(duration<double>(1.0 / 30.0));
+
+// How fast a band falls back after a peak, so short sounds stay visible for a few frames.
+constexpr float kFallDbPerSecond = 40.0f;
+
+nanoseconds threadCpuTime() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return seconds(ts.tv_sec) + nanoseconds(ts.tv_nsec);
+}
+
+} // namespace
+
+void SpectrumStats::recordAnalysis(nanoseconds time, uint32_t dropped) {
+    analyses++;
+    droppedSamples += dropped;
+    analysisTime += time;
+
+    auto now = steady_clock::now();
+    if (now - t0 < 10s) return;
+    nanoseconds cpuTime = threadCpuTime();
+    ULOGI("Audio spectrum: %u analyses, avg %.3f ms, %u samples dropped, %.2f%% of a core",
+          analyses,
+          duration<float, std::milli>(analysisTime).count() / static_cast<float>(analyses),
+          droppedSamples,
+          100.0f * duration<float>(cpuTime - cpuTime0).count() / duration<float>(now - t0).count());
+    *this = {};
+    t0 = now;
+    cpuTime0 = cpuTime;
+}
+
+AudioSpectrum::AudioSpectrum(uint32_t sampleRate, uint32_t channelCount)
+        : sampleRate_(sampleRate), channelCount_(std::max<uint32_t>(channelCount, 1)) {
+    tap_.resize(kTapCapacity);
+    history_.resize(kFftSize);
+    windowed_.resize(kFftSize);
+    power_.resize(kFftSize / 2);
+    window_.resize(kFftSize);
+    for (size_t i = 0; i < kFftSize; i++) {
+        window_[i] = 0.5f - 0.5f * std::cos(2.0f * std::numbers::pi_v<float> * static_cast<float>(i) / kFftSize);
+    }
+
+    float binWidth = static_cast<float>(sampleRate_) / kFftSize;
+    float top = std::min(kMaxFrequency, static_cast<float>(sampleRate_) / 2.0f);
+    for (size_t band = 0; band < kBands; band++) {
+        float low = kMinFrequency * std::pow(kMaxFrequency / kMinFrequency, static_cast<float>(band) / kBands);
+        float high = kMinFrequency * std::pow(kMaxFrequency / kMinFrequency, static_cast<float>(band + 1) / kBands);
+        if (low >= top) continue; // stays empty
+        // Bands narrower than a bin take the bin their centre falls in.
+        auto first = static_cast<uint32_t>(std::lround(low / binWidth));
+        auto last = static_cast<uint32_t>(std::lround(std::min(high, top) / binWidth));
+        if (last <= first) {
+            first = static_cast<uint32_t>(std::sqrt(low * high) / binWidth);
+            last = first + 1;
+        }
+        firstBin_[band] = std::min<uint32_t>(first, kFftSize / 2 - 1);
+        lastBin_[band] = std::min<uint32_t>(last, kFftSize / 2);
+    }
+    levels_.fill(kFloorDb);
+}
+
+AudioSpectrum::~AudioSpectrum() {
+    setEnabled(false);
+}
+
+void AudioSpectrum::setEnabled(bool enabled) {
+    if (enabled == thread_.joinable()) return;
+    if (enabled) {
+        // The worker is not running, so the read position can be moved up to the producer's.
+        tapRead_.store(tapWrite_.load(std::memory_order_acquire), std::memory_order_release);
+        std::fill(history_.begin(), history_.end(), 0.0f);
+        levels_.fill(kFloorDb);
+        stopRequested_ = false;
+        tapOpen_.store(true, std::memory_order_release);
+        thread_ = std::thread(&AudioSpectrum::run, this);
+        return;
+    }
+    tapOpen_.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopRequested_ = true;
+    }
+    wakeUp_.notify_one();
+    thread_.join();
+    std::lock_guard<std::mutex> lock(bandsMutex_);
+    hasBands_ = false;
+}
+
+void AudioSpectrum::push(const int16_t *samples, size_t count) {
+    if (!tapOpen_.load(std::memory_order_relaxed)) return;
+    size_t write = tapWrite_.load(std::memory_order_relaxed);
+    size_t read = tapRead_.load(std::memory_order_acquire);
+    size_t fits = std::min(count, kTapCapacity - (write - read));
+    // Whole frames only, so the worker stays aligned to the channels.
+    fits -= fits % channelCount_;
+    if (fits < count) droppedSamples_.fetch_add(count - fits, std::memory_order_relaxed);
+
+    size_t start = write % kTapCapacity;
+    size_t first = std::min(fits, kTapCapacity - start);
+    std::memcpy(tap_.data() + start, samples, first * sizeof(int16_t));
+    std::memcpy(tap_.data(), samples + first, (fits - first) * sizeof(int16_t));
+    tapWrite_.store(write + fits, std::memory_order_release);
+}
+
+uint32_t AudioSpectrum::drainTap() {
+    size_t read = tapRead_.load(std::memory_order_relaxed);
+    size_t write = tapWrite_.load(std::memory_order_acquire);
+    size_t available = write - read;
+    drained_.resize(available);
+    size_t start = read % kTapCapacity;
+    size_t first = std::min(available, kTapCapacity - start);
+    std::memcpy(drained_.data(), tap_.data() + start, first * sizeof(int16_t));
+    std::memcpy(drained_.data() + first, tap_.data(), (available - first) * sizeof(int16_t));
+    tapRead_.store(write, std::memory_order_release);
+
+    constexpr float kScale = 1.0f / 32768.0f;
+    float channelScale = kScale / static_cast<float>(channelCount_);
+    for (size_t frame = 0; frame + channelCount_ <= available; frame += channelCount_) {
+        int32_t sum = 0;
+        for (uint32_t channel = 0; channel < channelCount_; channel++) sum += drained_[frame + channel];
+        history_[historyPos_] = static_cast<float>(sum) * channelScale;
+        historyPos_ = (historyPos_ + 1) % kFftSize;
+    }
+    return droppedSamples_.exchange(0, std::memory_order_relaxed);
+}
+
+void AudioSpectrum::analyze(float elapsedSeconds) {
+    for (size_t i = 0; i < kFftSize; i++) {
+        windowed_[i] = history_[(historyPos_ + i) % kFftSize] * window_[i];
+    }
+    fft_.powerSpectrum(windowed_.data(), power_.data());
+
+    // A full scale sine peaks at kFftSize / 4 through the Hann window, which is 0 dBFS.
+    constexpr float kFullScale = (kFftSize / 4.0f) * (kFftSize / 4.0f);
+    float fall = kFallDbPerSecond * elapsedSeconds;
+    for (size_t band = 0; band < kBands; band++) {
+        float peak = 0.0f;
+        for (uint32_t bin = firstBin_[band]; bin < lastBin_[band]; bin++) peak = std::max(peak, power_[bin]);
+        float level = peak > 0.0f ? std::max(kFloorDb, 10.0f * std::log10(peak / kFullScale)) : kFloorDb;
+        levels_[band] = std::max(level, levels_[band] - fall);
+    }
+    std::lock_guard<std::mutex> lock(bandsMutex_);
+    bands_ = levels_;
+    hasBands_ = true;
+}
+
+bool AudioSpectrum::readBands(float *bands, size_t count) {
+    std::lock_guard<std::mutex> lock(bandsMutex_);
+    if (!hasBands_) return false;
+    std::copy_n(bands_.begin(), std::min(count, kBands), bands);
+    return true;
+}
+
+void AudioSpectrum::run() {
+    applyThreadPolicy(ThreadRole::Spectrum);
+    ULOGI("Audio spectrum started at %u Hz, %u channels", sampleRate_, channelCount_);
+    stats_ = {};
+    stats_.cpuTime0 = threadCpuTime();
+    auto last = steady_clock::now();
+    auto next = last + kAnalysisInterval;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopRequested_) {
+        wakeUp_.wait_until(lock, next);
+        if (stopRequested_) break;
+        lock.unlock();
+
+        TRACE_SECTION("audioSpectrum");
+        auto now = steady_clock::now();
+        // Skips ticks that were missed instead of running them back to back.
+        next += kAnalysisInterval;
+        if (next < now) next = now + kAnalysisInterval;
+        uint32_t dropped = drainTap();
+        auto analysisStart = steady_clock::now();
+        analyze(duration<float>(now - last).count());
+        stats_.recordAnalysis(steady_clock::now() - analysisStart, dropped);
+        last = now;
+        lock.lock();
+    }
+    ULOGI("Audio spectrum stopped");
+}
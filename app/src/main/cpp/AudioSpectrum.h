@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "RealFft.h"
+
+using namespace std::chrono;
+
+struct SpectrumStats {
+    uint32_t analyses = 0;
+    uint32_t droppedSamples = 0;
+    nanoseconds analysisTime{0ns};
+    nanoseconds cpuTime0{0ns};
+    steady_clock::time_point t0{steady_clock::now()};
+
+    void recordAnalysis(nanoseconds time, uint32_t dropped);
+};
+
+/**
+ * Spectrum analyzer of the USB audio stream for display. The transfer callback copies the 16-bit
+ * PCM it receives into a lock free single producer, single consumer tap, which is separate from
+ * the ring buffer that AAudio plays from; a worker thread drains the tap 30 times a second,
+ * downmixes it to mono and turns the latest kFftSize samples into the peak level of kBands
+ * logarithmically spaced bands.
+ *
+ * Neither the transfer callback nor the AAudio callback ever waits for the analyzer: when the
+ * worker falls behind, the callback drops the samples that don't fit.
+ */
+class AudioSpectrum final {
+public:
+    static constexpr size_t kFftSize = 2048;
+    static constexpr size_t kBands = 64;
+    // Band edges, clamped to the Nyquist frequency.
+    static constexpr float kMinFrequency = 20.0f;
+    static constexpr float kMaxFrequency = 20000.0f;
+    // Level of silent bands and of bands above the Nyquist frequency, in dBFS.
+    static constexpr float kFloorDb = -100.0f;
+
+    AudioSpectrum(uint32_t sampleRate, uint32_t channelCount);
+
+    ~AudioSpectrum();
+
+    AudioSpectrum(const AudioSpectrum &) = delete;
+    AudioSpectrum &operator=(const AudioSpectrum &) = delete;
+
+    /** Starts or stops the worker; samples pushed while stopped are discarded. */
+    void setEnabled(bool enabled);
+
+    /** Called on the USB event thread with interleaved samples of whole frames. Never blocks. */
+    void push(const int16_t *samples, size_t count);
+
+    /** Copies the level of each band in dBFS. Returns false until the first analysis. */
+    bool readBands(float *bands, size_t count);
+
+private:
+    void run();
+    // Moves what the tap holds into history_. Returns the samples that were dropped meanwhile.
+    uint32_t drainTap();
+    void analyze(float elapsedSeconds);
+
+    uint32_t sampleRate_;
+    uint32_t channelCount_;
+
+    // Written only by push() and read only by drainTap(); the positions count samples since the
+    // tap was opened and wrap at kTapCapacity.
+    static constexpr size_t kTapCapacity = 16384;
+    std::vector<int16_t> tap_;
+    std::atomic<size_t> tapWrite_{0};
+    std::atomic<size_t> tapRead_{0};
+    std::atomic<bool> tapOpen_{false};
+    std::atomic<uint32_t> droppedSamples_{0};
+
+    // Worker state: the last kFftSize mono samples, history_[historyPos_] being the oldest.
+    std::vector<float> history_;
+    size_t historyPos_{0};
+    std::vector<int16_t> drained_;
+    std::vector<float> window_;
+    std::vector<float> windowed_;
+    std::vector<float> power_;
+    RealFft fft_{kFftSize};
+    // First and one past the last FFT bin of each band.
+    std::array<uint32_t, kBands> firstBin_{};
+    std::array<uint32_t, kBands> lastBin_{};
+    std::array<float, kBands> levels_{};
+    SpectrumStats stats_{};
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wakeUp_;
+    bool stopRequested_{false};
+
+    // Guards the published bands between the worker and readers.
+    std::mutex bandsMutex_;
+    std::array<float, kBands> bands_{};
+    bool hasBands_{false};
+};
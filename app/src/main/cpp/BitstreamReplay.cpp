@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BitstreamReplay.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include "ThreadPolicy.h"
+#include "VideoDecoder.h"
+
+#define ULOGI(...) __android_log_print(ANDROID_LOG_INFO, "BitstreamReplay", __VA_ARGS__)
+
+using namespace std::chrono;
+
+namespace {
+
+// Time given to the decoder to output the pictures still in flight after the last unit.
+constexpr auto kDrainTimeout = 500ms;
+
+} // namespace
+
+std::string BitstreamReplay::run(const std::string &path) const {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return std::format("Cannot open {}", path);
+    std::vector<uint8_t> stream{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    std::vector<AccessUnitRange> units = splitAccessUnits(codec, stream.data(), stream.size());
+    if (units.empty() || fps <= 0) return std::format("No access units in {}", path);
+
+    std::atomic<uint32_t> decodedFrames{0};
+    std::unique_ptr<VideoDecoder> decoder;
+    if (useMediaCodec) {
+        decoder = std::make_unique<VideoDecoder>(codec, width, height, fps);
+        VideoDecoder *rawDecoder = decoder.get();
+        decoder->setFrameListener([rawDecoder, &decodedFrames] {
+            rawDecoder->discardLatestImage();
+            decodedFrames++;
+        });
+        if (!decoder->start()) return "Decoder failed to start";
+    }
+
+    std::atomic<bool> loadRunning{true};
+    std::vector<std::thread> load;
+    for (int32_t i = 0; i < backgroundThreads; i++) {
+        load.emplace_back([&loadRunning] {
+            applyThreadPolicy(ThreadRole::Background);
+            while (loadRunning.load(std::memory_order_relaxed)) {
+            }
+        });
+    }
+
+    AccessUnitFilter filter(codec);
+    uint32_t keyFrames = 0;
+    uint32_t queued = 0;
+    nanoseconds lateness{0ns};
+    nanoseconds maxLateness{0ns};
+    auto start = steady_clock::now();
+    std::thread feeder([&] {
+        applyThreadPolicy(ThreadRole::Capture);
+        for (size_t i = 0; i < units.size(); i++) {
+            const uint8_t *data = stream.data() + units[i].offset;
+            size_t size = units[i].size;
+            if (inspectAccessUnit(codec, data, size).isKeyFrame) keyFrames++;
+
+            // Paced like a camera so the decoder sees the same input rate as on USB.
+            auto due = start + microseconds(i * 1000000 / fps);
+            std::this_thread::sleep_until(due);
+            auto late = steady_clock::now() - due;
+            lateness += late;
+            maxLateness = std::max(maxLateness, duration_cast<nanoseconds>(late));
+            if (decoder != nullptr) {
+                int64_t ptsUs = duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+                if (decoder->decode(data, size, ptsUs)) queued++;
+            } else if (filter.accept(data, size)) {
+                queued++;
+            }
+        }
+    });
+    feeder.join();
+    if (decoder != nullptr) {
+        auto deadline = steady_clock::now() + kDrainTimeout;
+        while (decodedFrames < queued && steady_clock::now() < deadline) std::this_thread::sleep_for(5ms);
+        // Stops the codec before decodedFrames goes out of scope.
+        decoder = nullptr;
+    }
+    float seconds = duration<float>(steady_clock::now() - start).count();
+    loadRunning = false;
+    for (std::thread &thread : load) thread.join();
+    reportThreadCpuTimes();
+
+    std::string summary = std::format(
+            "{} {}: {} access units ({} keyframes, {} bytes), {} queued, {} decoded in {:.2f} s, "
+            "pacing late avg {:.2f} ms max {:.2f} ms with {} background threads",
+            codec == VideoCodec::H264 ? "H264" : "HEVC",
+            useMediaCodec ? "MediaCodec" : "stand-in",
+            units.size(),
+            keyFrames,
+            stream.size(),
+            queued,
+            useMediaCodec ? decodedFrames.load() : queued,
+            seconds,
+            duration<float, std::milli>(lateness).count() / units.size(),
+            duration<float, std::milli>(maxLateness).count(),
+            backgroundThreads);
+    ULOGI("%s", summary.c_str());
+    return summary;
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "H26xBitstream.h"
+
+/**
+ * Feeds a recorded Annex B elementary stream (.h264/.h265) through the same access unit path
+ * as UVC frame based payloads, paced at fps, so decoding can be checked without a camera.
+ *
+ * With useMediaCodec the units go to a VideoDecoder, otherwise to a stand-in that only applies
+ * the keyframe filter, which isolates bitstream handling from the platform decoder.
+ *
+ * Units are queued from a thread with the Capture policy, like the libuvc callback. The
+ * backgroundThreads busy threads compete with it for the CPU so the effect of the thread policy
+ * shows up as pacing lateness.
+ */
+struct BitstreamReplay {
+    VideoCodec codec;
+    int32_t width;
+    int32_t height;
+    int32_t fps;
+    bool useMediaCodec;
+    int32_t backgroundThreads;
+
+    /** Returns a one line summary, or a description of why the replay failed. */
+    std::string run(const std::string &path) const;
+};
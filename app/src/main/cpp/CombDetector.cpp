@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "CombDetector.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+#define ULOGI(...) __android_log_print(ANDROID_LOG_INFO, "CombDetector", __VA_ARGS__)
+
+namespace {
+
+// Every 8th column of every row is sampled, which is plenty for combing spread over moving edges.
+constexpr int32_t kColumnStep = 8;
+// Minimum luma difference to both neighbouring rows.
+constexpr int32_t kCombThreshold = 24;
+// Rows in a row whose comb direction alternates, which interleaved fields produce and a single
+// bright or dark line does not.
+constexpr uint8_t kAlternatingRows = 4;
+// Minimum luma change since the previous analysed frame; fields only comb where the scene moves.
+constexpr int32_t kMotionThreshold = 16;
+// Share of sampled pixels that have to be combed for the frame to count as combed.
+constexpr float kCombedRatio = 0.01f;
+constexpr uint32_t kCombedFramesToLatch = 3;
+constexpr uint32_t kCleanFramesToRelease = 30;
+
+} // namespace
+
+void CombDetector::analyze(const uint8_t *luma, int32_t width, int32_t height, int32_t pixelStride, int32_t rowStride) {
+    if (luma == nullptr || width < kColumnStep || height < 3) return;
+
+    size_t columns = static_cast<size_t>(width + kColumnStep - 1) / kColumnStep;
+    size_t sampleCount = columns * static_cast<size_t>(height - 2);
+    // Motion can only be told from the second frame of the same size on.
+    bool hasPrevious = previous_.size() == sampleCount;
+    previous_.resize(sampleCount);
+    lastDirection_.assign(columns, 0);
+    alternatingRows_.assign(columns, 0);
+
+    uint32_t samples = 0;
+    uint32_t combedSamples = 0;
+    for (int32_t y = 1; y + 1 < height; y++) {
+        const uint8_t *above = luma + static_cast<size_t>(y - 1) * rowStride;
+        const uint8_t *row = above + rowStride;
+        const uint8_t *below = row + rowStride;
+        uint8_t *previousRow = previous_.data() + static_cast<size_t>(y - 1) * columns;
+        for (size_t column = 0; column < columns; column++) {
+            size_t offset = column * kColumnStep * pixelStride;
+            int32_t up = row[offset] - above[offset];
+            int32_t down = row[offset] - below[offset];
+            int8_t direction = 0;
+            if (up > kCombThreshold && down > kCombThreshold) direction = 1;
+            if (up < -kCombThreshold && down < -kCombThreshold) direction = -1;
+            if (direction != 0 && direction == -lastDirection_[column]) {
+                alternatingRows_[column] = std::min<uint8_t>(alternatingRows_[column] + 1, kAlternatingRows);
+            } else {
+                alternatingRows_[column] = direction != 0 ? 1 : 0;
+            }
+            lastDirection_[column] = direction;
+
+            bool moved = hasPrevious && std::abs(row[offset] - previousRow[column]) > kMotionThreshold;
+            previousRow[column] = row[offset];
+            if (moved && alternatingRows_[column] >= kAlternatingRows) combedSamples++;
+            samples++;
+        }
+    }
+
+    if (combedSamples > samples * kCombedRatio) {
+        cleanRun_ = 0;
+        if (++combedRun_ >= kCombedFramesToLatch && !combed_) {
+            combed_ = true;
+            ULOGI("Combing in %u of %u samples, treating the source as interlaced", combedSamples, samples);
+        }
+    } else {
+        combedRun_ = 0;
+        if (++cleanRun_ >= kCleanFramesToRelease && combed_) {
+            combed_ = false;
+            ULOGI("No combing in %u frames, treating the source as progressive", cleanRun_);
+        }
+    }
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Detects combing, the teeth that interlaced frames show on motion, in sources whose descriptors
+ * claim progressive video. Capture cards usually pass 1080i through as woven frames without
+ * setting the interlace flags.
+ *
+ * A pixel is combed when it differs from the rows above and below in the same direction, the
+ * direction alternates over several consecutive rows as it does between the two fields, and the
+ * pixel changed since the previous analysed frame. Sharp horizontal edges, 1-pixel lines of text
+ * and UI and static grids fail one of these. Static interlaced scenes show no combing, so the
+ * detector latches quickly and lets go only after a long run of clean frames.
+ */
+class CombDetector final {
+public:
+    /** Samples the 8-bit luma of a frame, pixelStride bytes apart within rows of rowStride bytes. */
+    void analyze(const uint8_t *luma, int32_t width, int32_t height, int32_t pixelStride, int32_t rowStride);
+
+    bool combed() const { return combed_; }
+
+    void reset() { *this = {}; }
+
+private:
+    bool combed_{false};
+    uint32_t combedRun_{0};
+    uint32_t cleanRun_{0};
+    // Sampled luma of the previous analysed frame, and per sampled column the comb direction of
+    // the last row and how many rows it has alternated for.
+    std::vector<uint8_t> previous_;
+    std::vector<int8_t> lastDirection_;
+    std::vector<uint8_t> alternatingRows_;
+};
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CpuFrameBlitter.h"
+
+#include <android/log.h>
+
+#include "UsbVideoStreamer.h"
+
+#define ULOGE(...) __android_log_print(ANDROID_LOG_ERROR, "CpuFrameBlitter", __VA_ARGS__)
+
+bool CpuFrameBlitter::blit(ANativeWindow *window, UsbVideoStreamer *streamer) {
+    if (streamer == nullptr) return false;
+    int32_t width = 0;
+    int32_t height = 0;
+    streamer->getFrameSize(width, height);
+    if (width <= 0 || height <= 0) return false;
+
+    if (width != bufferWidth_ || height != bufferHeight_) {
+        if (ANativeWindow_setBuffersGeometry(window, width, height, WINDOW_FORMAT_RGBX_8888) != 0) {
+            ULOGE("ANativeWindow_setBuffersGeometry %dx%d failed", width, height);
+            return false;
+        }
+        bufferWidth_ = width;
+        bufferHeight_ = height;
+    }
+
+    ANativeWindow_Buffer buffer{};
+    if (ANativeWindow_lock(window, &buffer, nullptr) != 0) {
+        ULOGE("ANativeWindow_lock failed");
+        return false;
+    }
+    bool converted = buffer.width == width && buffer.height == height &&
+                     streamer->convertFrameToRGBA(static_cast<uint8_t *>(buffer.bits), buffer.stride * 4, width, height);
+    ANativeWindow_unlockAndPost(window);
+    return converted;
+}
+
+void CpuFrameBlitter::reset(ANativeWindow *window) {
+    if (bufferWidth_ == 0 && bufferHeight_ == 0) return;
+    ANativeWindow_setBuffersGeometry(window, 0, 0, 0);
+    bufferWidth_ = 0;
+    bufferHeight_ = 0;
+}
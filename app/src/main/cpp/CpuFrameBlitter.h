@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android/native_window.h>
+#include <cstdint>
+
+class UsbVideoStreamer;
+
+/**
+ * GPU-less presentation path: sizes the window buffers to the video and converts each frame with
+ * libyuv straight into the locked ANativeWindow buffer. Scaling to the view is left to the
+ * hardware composer. The window must not be connected to an EGL surface while blitting.
+ */
+class CpuFrameBlitter final {
+public:
+    bool blit(ANativeWindow *window, UsbVideoStreamer *streamer);
+
+    /** Restores the window's default buffer geometry so that EGL can use it again. */
+    void reset(ANativeWindow *window);
+
+private:
+    int32_t bufferWidth_{0};
+    int32_t bufferHeight_{0};
+};
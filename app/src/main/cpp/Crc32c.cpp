@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Crc32c.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__aarch64__)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#elif defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace {
+
+constexpr uint32_t kPolynomial = 0x82f63b78; // reflected Castagnoli
+
+constexpr std::array<uint32_t, 256> makeTable() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ ((crc & 1) != 0 ? kPolynomial : 0);
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr std::array<uint32_t, 256> kTable = makeTable();
+
+uint32_t crc32cSoftware(uint32_t crc, const uint8_t *data, size_t size) {
+    for (size_t i = 0; i < size; i++) crc = kTable[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+#if defined(__aarch64__)
+
+__attribute__((target("crc")))
+uint32_t crc32cHardware(uint32_t crc, const uint8_t *data, size_t size) {
+    for (; size >= sizeof(uint64_t); data += sizeof(uint64_t), size -= sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc = __builtin_arm_crc32cd(crc, word);
+    }
+    for (; size > 0; data++, size--) crc = __builtin_arm_crc32cb(crc, *data);
+    return crc;
+}
+
+bool hasCrcInstructions() {
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+
+#elif defined(__x86_64__)
+
+__attribute__((target("sse4.2")))
+uint32_t crc32cHardware(uint32_t crc, const uint8_t *data, size_t size) {
+    uint64_t crc64 = crc;
+    for (; size >= sizeof(uint64_t); data += sizeof(uint64_t), size -= sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = static_cast<uint32_t>(crc64);
+    for (; size > 0; data++, size--) crc = _mm_crc32_u8(crc, *data);
+    return crc;
+}
+
+bool hasCrcInstructions() {
+    return __builtin_cpu_supports("sse4.2");
+}
+
+#else
+
+uint32_t crc32cHardware(uint32_t crc, const uint8_t *data, size_t size) {
+    return crc32cSoftware(crc, data, size);
+}
+
+bool hasCrcInstructions() {
+    return false;
+}
+
+#endif
+
+} // namespace
+
+uint32_t crc32c(const uint8_t *data, size_t size) {
+    static const bool hardware = hasCrcInstructions();
+    uint32_t crc = ~0u;
+    crc = hardware ? crc32cHardware(crc, data, size) : crc32cSoftware(crc, data, size);
+    return ~crc;
+}
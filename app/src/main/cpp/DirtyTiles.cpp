@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "DirtyTiles.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+#if defined(__ARM_NEON)
+bool anyNonZero(uint8x16_t v) {
+#if defined(__aarch64__)
+    return vmaxvq_u8(v) != 0;
+#else
+    uint8x8_t folded = vorr_u8(vget_low_u8(v), vget_high_u8(v));
+    return vget_lane_u64(vreinterpret_u64_u8(folded), 0) != 0;
+#endif
+}
+#endif
+
+// Whether the tile at a and b, height rows of width bytes stride bytes apart, is the same. Most
+// changed tiles differ in their first rows, so each row is checked before the next is loaded.
+bool tileEqual(const uint8_t *a, const uint8_t *b, int32_t width, int32_t height, int32_t stride) {
+    for (int32_t y = 0; y < height; y++) {
+        const uint8_t *rowA = a + static_cast<size_t>(y) * stride;
+        const uint8_t *rowB = b + static_cast<size_t>(y) * stride;
+        int32_t x = 0;
+#if defined(__ARM_NEON)
+        for (; x + 64 <= width; x += 64) {
+            uint8x16_t diff = veorq_u8(vld1q_u8(rowA + x), vld1q_u8(rowB + x));
+            diff = vorrq_u8(diff, veorq_u8(vld1q_u8(rowA + x + 16), vld1q_u8(rowB + x + 16)));
+            diff = vorrq_u8(diff, veorq_u8(vld1q_u8(rowA + x + 32), vld1q_u8(rowB + x + 32)));
+            diff = vorrq_u8(diff, veorq_u8(vld1q_u8(rowA + x + 48), vld1q_u8(rowB + x + 48)));
+            if (anyNonZero(diff)) return false;
+        }
+        for (; x + 16 <= width; x += 16) {
+            if (anyNonZero(veorq_u8(vld1q_u8(rowA + x), vld1q_u8(rowB + x)))) return false;
+        }
+#endif
+        if (x < width && std::memcmp(rowA + x, rowB + x, width - x) != 0) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+void DirtyTiles::resize(int32_t width, int32_t height) {
+    if (width == width_ && height == height_ && !dirty_.empty()) return;
+    width_ = width;
+    height_ = height;
+    columns_ = (width + kTileSize - 1) / kTileSize;
+    rows_ = (height + kTileSize - 1) / kTileSize;
+    dirty_.assign(static_cast<size_t>(columns_) * rows_, 0);
+    markAll();
+}
+
+void DirtyTiles::markAll() {
+    std::fill(dirty_.begin(), dirty_.end(), 1);
+    dirtyCount_ = static_cast<uint32_t>(dirty_.size());
+}
+
+void DirtyTiles::clear() {
+    std::fill(dirty_.begin(), dirty_.end(), 0);
+    dirtyCount_ = 0;
+}
+
+void DirtyTiles::mark(size_t tile) {
+    if (dirty_[tile] != 0) return;
+    dirty_[tile] = 1;
+    dirtyCount_++;
+}
+
+void DirtyTiles::copyPlane(
+        uint8_t *dst, const uint8_t *src, int32_t rowBytes, int32_t rows, int32_t tileBytes, int32_t tileRows) {
+    for (int32_t row = 0; row < rows_; row++) {
+        int32_t top = row * tileRows;
+        if (top >= rows) break;
+        int32_t height = std::min(tileRows, rows - top);
+        for (int32_t column = 0; column < columns_; column++) {
+            int32_t left = column * tileBytes;
+            if (left >= rowBytes) break;
+            int32_t width = std::min(tileBytes, rowBytes - left);
+            size_t offset = static_cast<size_t>(top) * rowBytes + left;
+            if (tileEqual(dst + offset, src + offset, width, height, rowBytes)) continue;
+            for (int32_t y = 0; y < height; y++) {
+                std::memcpy(dst + offset + static_cast<size_t>(y) * rowBytes,
+                            src + offset + static_cast<size_t>(y) * rowBytes, width);
+            }
+            mark(static_cast<size_t>(row) * columns_ + column);
+        }
+    }
+}
+
+void DirtyTiles::forEachRun(const std::function<void(int32_t column, int32_t row, int32_t length)> &visitor) const {
+    for (int32_t row = 0; row < rows_; row++) {
+        const uint8_t *tiles = dirty_.data() + static_cast<size_t>(row) * columns_;
+        int32_t column = 0;
+        while (column < columns_) {
+            if (tiles[column] == 0) {
+                column++;
+                continue;
+            }
+            int32_t start = column;
+            while (column < columns_ && tiles[column] != 0) column++;
+            visitor(start, row, column - start);
+        }
+    }
+}
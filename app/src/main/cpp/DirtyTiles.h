@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * Tracks which 64x64 pixel tiles of the stored frame changed since it was last uploaded, so that
+ * mostly static screen captures only upload the tiles that moved. Frames are copied into the
+ * stored planes through copyPlane(), which compares each tile with what is stored and copies and
+ * marks only the ones that differ. Tiles stay marked across frames that were replaced before
+ * they were uploaded, until clear().
+ */
+class DirtyTiles final {
+public:
+    static constexpr int32_t kTileSize = 64;
+
+    /** Sizes the map to a frame, and marks every tile when the size changed. */
+    void resize(int32_t width, int32_t height);
+
+    /** Marks every tile, when the stored planes no longer match the uploaded textures. */
+    void markAll();
+
+    void clear();
+
+    /**
+     * Copies rows of rowBytes from src to dst, both packed, tile by tile: tileBytes and tileRows
+     * are the size of a tile in this plane, which is smaller for subsampled chroma.
+     */
+    void copyPlane(
+            uint8_t *dst, const uint8_t *src, int32_t rowBytes, int32_t rows, int32_t tileBytes, int32_t tileRows);
+
+    uint32_t dirtyCount() const { return dirtyCount_; }
+    uint32_t tileCount() const { return static_cast<uint32_t>(dirty_.size()); }
+
+    /** Calls visitor with the first tile column, tile row and length of each run of dirty tiles. */
+    void forEachRun(const std::function<void(int32_t column, int32_t row, int32_t length)> &visitor) const;
+
+private:
+    void mark(size_t tile);
+
+    int32_t width_{};
+    int32_t height_{};
+    int32_t columns_{};
+    int32_t rows_{};
+    std::vector<uint8_t> dirty_;
+    uint32_t dirtyCount_{};
+};
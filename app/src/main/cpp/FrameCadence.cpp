@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameCadence.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+#include <cmath>
+
+#define ULOGI(...) __android_log_print(ANDROID_LOG_INFO, "FrameCadence", __VA_ARGS__)
+
+namespace {
+
+// Rates that sources actually run at; a measured rate within kRateTolerance snaps to them.
+constexpr float kStandardRates[] = {23.976f, 24.0f, 25.0f, 29.97f, 30.0f, 48.0f, 50.0f, 59.94f, 60.0f};
+constexpr float kRateTolerance = 0.015f;
+
+// Frames a new source rate must be measured for before the display rate follows it.
+constexpr uint32_t kRateChangeFrames = 30;
+
+// Arrival intervals are smoothed with this weight; longer gaps are drops and are not counted.
+constexpr double kIntervalWeight = 1.0 / 16.0;
+constexpr int kMaxIntervalGap = 3;
+
+// Refresh period assumed until a display rate is chosen.
+constexpr nanoseconds kDefaultRefreshPeriod = 16'666'667ns;
+
+float snapToStandardRate(float rate) {
+    for (float standard: kStandardRates) {
+        if (std::abs(rate - standard) <= standard * kRateTolerance) return standard;
+    }
+    return rate;
+}
+
+// The refresh at or after time on a grid of period; the phase of the real vsync is unknown but
+// constant, so differences between these times equal the on-screen durations.
+steady_clock::time_point nextVsync(steady_clock::time_point time, nanoseconds period) {
+    auto ticks = (time.time_since_epoch() + period - 1ns) / period;
+    return steady_clock::time_point(ticks * period);
+}
+
+} // namespace
+
+void CadenceStats::recordFrame(nanoseconds unpacedError, nanoseconds pacedError) {
+    frames++;
+    unpacedSquaredError += std::pow(duration<double, std::milli>(unpacedError).count(), 2);
+    pacedSquaredError += std::pow(duration<double, std::milli>(pacedError).count(), 2);
+}
+
+void CadenceStats::log(float sourceRate, float displayRate) {
+    auto now = steady_clock::now();
+    if (now - t0 < 10s) return;
+    if (frames > 0) {
+        ULOGI("Cadence: source %.2f fps on %.0f Hz, judder (RMS) as arrived %.2f ms, paced %.2f ms, %u re-anchors",
+              sourceRate, displayRate,
+              std::sqrt(unpacedSquaredError / frames),
+              std::sqrt(pacedSquaredError / frames),
+              reanchors);
+    }
+    *this = {};
+    t0 = now;
+}
+
+void FrameCadence::setDisplayRates(std::vector<float> rates) {
+    displayRates_ = std::move(rates);
+    // Chosen again for the current source with the new rates.
+    chosenSourceRate_ = 0.0f;
+}
+
+void FrameCadence::setFieldsPerFrame(int32_t fieldsPerFrame) {
+    if (fieldsPerFrame == fieldsPerFrame_) return;
+    fieldsPerFrame_ = fieldsPerFrame;
+    chosenSourceRate_ = 0.0f;
+}
+
+nanoseconds FrameCadence::refreshPeriod() const {
+    if (displayRate_ <= 0.0f) return kDefaultRefreshPeriod;
+    return duration_cast<nanoseconds>(duration<double>(1.0 / displayRate_));
+}
+
+float FrameCadence::chooseDisplayRate(float contentRate) const {
+    // A frame is held floor(ratio) or ceil(ratio) refreshes; the RMS timing error of that
+    // pattern is one refresh period times sqrt(f * (1 - f)) for the fractional part f. Exact
+    // multiples have none, and among those the lowest rate saves power.
+    float best = 0.0f;
+    double bestJudder = 0.0;
+    for (float rate: displayRates_) {
+        double ratio = rate / contentRate;
+        if (ratio < 1.0 - kRateTolerance) continue;
+        double fraction = ratio - std::floor(ratio);
+        if (fraction < kRateTolerance || fraction > 1.0 - kRateTolerance) fraction = 0.0;
+        double judder = std::sqrt(fraction * (1.0 - fraction)) / rate;
+        if (best == 0.0f || judder < bestJudder - 1e-6 || (judder <= bestJudder + 1e-6 && rate < best)) {
+            best = rate;
+            bestJudder = judder;
+        }
+    }
+    if (best == 0.0f && !displayRates_.empty()) {
+        best = *std::max_element(displayRates_.begin(), displayRates_.end());
+    }
+    return best;
+}
+
+void FrameCadence::reset(nanoseconds nominalInterval) {
+    interval_ = nominalInterval;
+    measuredFrames_ = 0;
+    framesAtOtherRate_ = 0;
+    lastArrival_.reset();
+    lastSlot_.reset();
+    lastUnpacedVsync_.reset();
+    lastPacedVsync_.reset();
+}
+
+steady_clock::time_point FrameCadence::schedule(steady_clock::time_point arrival) {
+    if (lastArrival_.has_value()) {
+        nanoseconds gap = arrival - *lastArrival_;
+        if (interval_ == 0ns) {
+            interval_ = gap;
+        } else if (gap < interval_ * kMaxIntervalGap) {
+            interval_ += duration_cast<nanoseconds>((gap - interval_) * kIntervalWeight);
+        }
+        measuredFrames_++;
+    }
+    lastArrival_ = arrival;
+    if (interval_ <= 0ns) return arrival;
+
+    float sourceRate = snapToStandardRate(1.0f / duration<float>(interval_).count());
+    if (sourceRate != chosenSourceRate_ && !displayRates_.empty() && measuredFrames_ >= kRateChangeFrames) {
+        if (chosenSourceRate_ == 0.0f || ++framesAtOtherRate_ >= kRateChangeFrames) {
+            float rate = chooseDisplayRate(sourceRate * static_cast<float>(fieldsPerFrame_));
+            if (rate != displayRate_) {
+                ULOGI("Source at %.2f fps (%d fields per frame), display to %.0f Hz",
+                      sourceRate, fieldsPerFrame_, rate);
+                displayRate_ = rate;
+                pendingDisplayRate_ = rate;
+            }
+            chosenSourceRate_ = sourceRate;
+            framesAtOtherRate_ = 0;
+        }
+    } else {
+        framesAtOtherRate_ = 0;
+    }
+
+    // The buffer has to be queued a refresh before it is latched. Frames go out one interval
+    // apart; when arrivals drift off that schedule by more than a frame, it is anchored again
+    // with a quarter interval of headroom for the arrival jitter.
+    nanoseconds period = refreshPeriod();
+    auto earliest = arrival + period;
+    auto slot = lastSlot_.has_value() ? *lastSlot_ + interval_ : earliest;
+    if (!lastSlot_.has_value() || slot < earliest || slot > earliest + interval_) {
+        if (lastSlot_.has_value()) stats_.reanchors++;
+        slot = earliest + interval_ / 4;
+    }
+    lastSlot_ = slot;
+
+    auto unpacedVsync = nextVsync(earliest, period);
+    auto pacedVsync = nextVsync(slot, period);
+    if (lastUnpacedVsync_.has_value() && lastPacedVsync_.has_value()) {
+        stats_.recordFrame(
+                (unpacedVsync - *lastUnpacedVsync_) - interval_,
+                (pacedVsync - *lastPacedVsync_) - interval_);
+    }
+    lastUnpacedVsync_ = unpacedVsync;
+    lastPacedVsync_ = pacedVsync;
+    stats_.log(sourceRate, displayRate_ > 0.0f ? displayRate_ : 1.0f / duration<float>(kDefaultRefreshPeriod).count());
+    return slot;
+}
+
+std::optional<float> FrameCadence::takeDisplayRateChange() {
+    auto rate = pendingDisplayRate_;
+    pendingDisplayRate_.reset();
+    return rate;
+}
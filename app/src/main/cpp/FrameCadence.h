@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+using namespace std::chrono;
+
+// Judder of the frames presented as they arrive and of the same frames on the paced schedule.
+struct CadenceStats {
+    uint32_t frames = 0;
+    // Squared deviation of the on-screen duration of each frame from the source frame interval.
+    double unpacedSquaredError = 0;
+    double pacedSquaredError = 0;
+    uint32_t reanchors = 0;
+    steady_clock::time_point t0{steady_clock::now()};
+
+    void recordFrame(nanoseconds unpacedError, nanoseconds pacedError);
+    void log(float sourceRate, float displayRate);
+};
+
+/**
+ * Fits the display refresh rate to the source and paces frames onto an even schedule.
+ *
+ * A source rate that doesn't divide the refresh rate (25 fps at 72 Hz) shows frames for an
+ * uneven number of refreshes, and frames that are presented when they arrive add the USB
+ * arrival jitter on top. The cadence picks the supported refresh rate that minimizes that
+ * judder, and gives every frame a presentation time one measured frame interval after the
+ * previous one, so the compositor spreads the repeats evenly.
+ *
+ * Used on the render thread only.
+ */
+class FrameCadence final {
+public:
+    /** Refresh rates the display supports at its current resolution. */
+    void setDisplayRates(std::vector<float> rates);
+
+    /** Fields are shown one at a time, so deinterlaced sources run at twice the frame rate. */
+    void setFieldsPerFrame(int32_t fieldsPerFrame);
+
+    /**
+     * Starts over for a new or reconfigured source, from the frame interval it negotiated (0 when
+     * unknown) instead of the first measured gap, which a startup stall would skew.
+     */
+    void reset(nanoseconds nominalInterval);
+
+    /** Records a frame that arrived at arrival and returns when it should be presented. */
+    steady_clock::time_point schedule(steady_clock::time_point arrival);
+
+    /** A refresh rate to switch the window to, once per change of the source rate. */
+    std::optional<float> takeDisplayRateChange();
+
+    nanoseconds frameInterval() const { return interval_; }
+
+private:
+    float chooseDisplayRate(float contentRate) const;
+    nanoseconds refreshPeriod() const;
+
+    std::vector<float> displayRates_;
+    int32_t fieldsPerFrame_{1};
+    float displayRate_{0.0f};
+    std::optional<float> pendingDisplayRate_;
+    // Source rate the display rate was chosen for, and how long another one has been measured.
+    float chosenSourceRate_{0.0f};
+    uint32_t framesAtOtherRate_{0};
+
+    nanoseconds interval_{0ns};
+    uint32_t measuredFrames_{0};
+    std::optional<steady_clock::time_point> lastArrival_;
+    std::optional<steady_clock::time_point> lastSlot_;
+    // On-screen times of the previous frame, for the judder statistics.
+    std::optional<steady_clock::time_point> lastUnpacedVsync_;
+    std::optional<steady_clock::time_point> lastPacedVsync_;
+    CadenceStats stats_{};
+};
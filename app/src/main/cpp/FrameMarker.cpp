@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "FrameMarker.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+
+#include "ProgramCache.h"
+
+#define ULOGE(...) __android_log_print(ANDROID_LOG_ERROR, "FrameMarker", __VA_ARGS__)
+
+namespace {
+
+// Width of the band as a fraction of the window; a cell is never smaller than this in pixels.
+constexpr float kWidthFraction = 0.5f;
+constexpr int32_t kMinCellSize = 2;
+
+uint32_t checksum(uint32_t sequence, uint32_t millis) {
+    uint32_t folded = sequence ^ millis;
+    return (folded ^ folded >> 8 ^ folded >> 16 ^ folded >> 24) & 0xff;
+}
+
+} // namespace
+
+bool FrameMarker::init(ProgramCache &programCache, GLuint windowVao) {
+    program_ = programCache.getOrCreateProgram("shaders/video_v.glsl", "shaders/marker_f.glsl");
+    if (program_ == 0) {
+        ULOGE("No frame marker program");
+        return false;
+    }
+    // Shares the Overlay block binding of the format programs, see VideoRenderer.
+    GLuint blockIndex = glGetUniformBlockIndex(program_, "Overlay");
+    if (blockIndex != GL_INVALID_INDEX) glUniformBlockBinding(program_, blockIndex, 0);
+    originLocation_ = glGetUniformLocation(program_, "uOrigin");
+    cellLocation_ = glGetUniformLocation(program_, "uCell");
+    wordsLocation_ = glGetUniformLocation(program_, "uWords");
+    windowVao_ = windowVao;
+    return true;
+}
+
+void FrameMarker::draw(const FrameStamp &stamp, int32_t windowWidth, int32_t windowHeight) {
+    // Whole pixels per cell keep the bars sharp edged.
+    int32_t cell = std::max(
+            kMinCellSize, static_cast<int32_t>(static_cast<float>(windowWidth) * kWidthFraction / kColumns));
+    int32_t width = std::min(windowWidth, cell * kColumns);
+    int32_t height = std::min(windowHeight, cell * kRows);
+    auto sequence = stamp.sequence;
+    auto millis = static_cast<uint32_t>(
+            duration_cast<milliseconds>(stamp.captured.time_since_epoch()).count());
+
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(0, windowHeight - height, width, height);
+    glUseProgram(program_);
+    glUniform2f(originLocation_, 0.0f, static_cast<float>(windowHeight));
+    glUniform1f(cellLocation_, static_cast<float>(cell));
+    glUniform3ui(wordsLocation_, sequence, millis, checksum(sequence, millis));
+    glBindVertexArray(windowVao_);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    glDisable(GL_SCISSOR_TEST);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <cstdint>
+
+#include "UsbVideoStreamer.h"
+
+class ProgramCache;
+
+/**
+ * Burns the capture sequence number and capture time of the shown frame into the top left
+ * corner of the window, as digits and as a bar code that FrameMarkerDecoder.kt reads back from a
+ * high-speed recording of the screen. The time is steady_clock (CLOCK_MONOTONIC) in
+ * milliseconds, the clock of SystemClock.uptimeMillis().
+ *
+ * The bar code is a row of 78 equal cells on a black band: the guard bits 101, the sequence
+ * number and the time as 32-bit words and the XOR of their eight bytes, most significant bit
+ * first, and 101 again. The layout must be kept in sync with marker_f.glsl and
+ * FrameMarkerDecoder.kt.
+ */
+class FrameMarker final {
+public:
+    // Size of the band in cells, margins included.
+    static constexpr int32_t kColumns = 82;
+    static constexpr int32_t kRows = 17;
+
+    /** windowVao draws a full screen quad into the window. */
+    bool init(ProgramCache &programCache, GLuint windowVao);
+
+    /** Draws the marker of stamp over the window, which is bound at the given size. */
+    void draw(const FrameStamp &stamp, int32_t windowWidth, int32_t windowHeight);
+
+private:
+    GLuint program_{};
+    GLint originLocation_{-1};
+    GLint cellLocation_{-1};
+    GLint wordsLocation_{-1};
+    GLuint windowVao_{};
+};
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GpuTimer.h"
+
+#include <GLES2/gl2ext.h>
+#include <android/log.h>
+
+#include <cstring>
+
+#define ULOGI(...) __android_log_print(ANDROID_LOG_INFO, "GpuTimer", __VA_ARGS__)
+
+bool GpuTimer::init() {
+    *this = {};
+    auto extensions = reinterpret_cast<const char *>(glGetString(GL_EXTENSIONS));
+    supported_ = extensions != nullptr && std::strstr(extensions, "GL_EXT_disjoint_timer_query") != nullptr;
+    if (!supported_) {
+        ULOGI("No GL_EXT_disjoint_timer_query, GPU times are not measured");
+        return false;
+    }
+    for (Query &query: queries_) glGenQueries(1, &query.id);
+    // Clears a disjoint state left from before the queries existed.
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    return true;
+}
+
+void GpuTimer::begin(uint32_t tag) {
+    if (!supported_ || active_ != nullptr) return;
+    Query &query = queries_[next_];
+    if (query.pending) return;
+    next_ = (next_ + 1) % kQueries;
+    // On GLES 3 the extension makes the core query functions accept GL_TIME_ELAPSED_EXT.
+    glBeginQuery(GL_TIME_ELAPSED_EXT, query.id);
+    query.tag = tag;
+    active_ = &query;
+}
+
+void GpuTimer::end() {
+    if (active_ == nullptr) return;
+    glEndQuery(GL_TIME_ELAPSED_EXT);
+    active_->pending = true;
+    active_ = nullptr;
+}
+
+void GpuTimer::collect(const std::function<void(uint32_t tag, nanoseconds gpuTime)> &onResult) {
+    if (!supported_) return;
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    for (Query &query: queries_) {
+        if (!query.pending) continue;
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_FALSE) continue;
+        GLuint elapsed = 0;
+        glGetQueryObjectuiv(query.id, GL_QUERY_RESULT, &elapsed);
+        query.pending = false;
+        // A frequency change or context switch makes every result in flight meaningless.
+        if (disjoint == 0) onResult(query.tag, nanoseconds(elapsed));
+    }
+}
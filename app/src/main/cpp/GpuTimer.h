@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+using namespace std::chrono;
+
+/**
+ * Measures how long the GPU spends on a range of GL commands with GL_EXT_disjoint_timer_query.
+ * Results arrive a few frames later, so a small ring of queries is kept in flight; ranges that
+ * start while all of them are busy are not timed. Must be used on the GL thread.
+ */
+class GpuTimer final {
+public:
+    /** Returns false when the context has no timer queries, after which every call is a no-op. */
+    bool init();
+
+    /** Starts timing; tag is passed back with the result. Ranges must not nest. */
+    void begin(uint32_t tag);
+
+    void end();
+
+    /** Reports every finished range, dropping those the GPU was disjoint during. */
+    void collect(const std::function<void(uint32_t tag, nanoseconds gpuTime)> &onResult);
+
+private:
+    struct Query {
+        GLuint id{};
+        uint32_t tag{};
+        bool pending{false};
+    };
+
+    static constexpr size_t kQueries = 4;
+
+    std::array<Query, kQueries> queries_{};
+    size_t next_{0};
+    Query *active_{nullptr};
+    bool supported_{false};
+};
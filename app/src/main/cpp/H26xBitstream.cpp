@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "H26xBitstream.h"
+
+namespace {
+
+// Offset of the next 00 00 01 start code at or after pos, or size when there is none.
+size_t findStartCode(const uint8_t *data, size_t size, size_t pos) {
+    for (size_t i = pos; i + 2 < size; i++) {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) return i;
+    }
+    return size;
+}
+
+void forEachNalUnitAt(
+        const uint8_t *data,
+        size_t size,
+        const std::function<void(size_t, const uint8_t *, size_t)> &visitor) {
+    size_t startCode = findStartCode(data, size, 0);
+    while (startCode < size) {
+        size_t nalStart = startCode + 3;
+        size_t next = findStartCode(data, size, nalStart);
+        // Drops trailing_zero_8bits and the leading zero of a 4 byte start code.
+        size_t nalEnd = next;
+        while (nalEnd > nalStart && data[nalEnd - 1] == 0) nalEnd--;
+        if (nalEnd > nalStart) visitor(startCode, data + nalStart, nalEnd - nalStart);
+        startCode = next;
+    }
+}
+
+int nalType(VideoCodec codec, const uint8_t *nal) {
+    return codec == VideoCodec::H264 ? nal[0] & 0x1f : (nal[0] >> 1) & 0x3f;
+}
+
+bool isSlice(VideoCodec codec, int type) {
+    return codec == VideoCodec::H264 ? type >= 1 && type <= 5 : type <= 31;
+}
+
+bool isKeyFrameSlice(VideoCodec codec, int type) {
+    // H.264 IDR; HEVC BLA, IDR and CRA
+    return codec == VideoCodec::H264 ? type == 5 : type >= 16 && type <= 21;
+}
+
+bool isSequenceParameterSet(VideoCodec codec, int type) {
+    return codec == VideoCodec::H264 ? type == 7 : type == 33;
+}
+
+bool isAccessUnitDelimiter(VideoCodec codec, int type) {
+    return codec == VideoCodec::H264 ? type == 9 : type == 35;
+}
+
+// NAL units that may only precede the first slice of an access unit.
+bool isPrefix(VideoCodec codec, int type) {
+    if (codec == VideoCodec::H264) return type == 6 || type == 7 || type == 8 || (type >= 14 && type <= 18);
+    return (type >= 32 && type <= 34) || type == 39 || (type >= 41 && type <= 44) || (type >= 48 && type <= 55);
+}
+
+// first_mb_in_slice == 0 for H.264, first_slice_segment_in_pic_flag for HEVC.
+bool isFirstSliceOfPicture(VideoCodec codec, const uint8_t *nal, size_t size) {
+    size_t headerSize = codec == VideoCodec::H264 ? 1 : 2;
+    return size > headerSize && (nal[headerSize] & 0x80) != 0;
+}
+
+} // namespace
+
+void forEachNalUnit(const uint8_t *data, size_t size, const std::function<void(const uint8_t *, size_t)> &visitor) {
+    forEachNalUnitAt(data, size, [&visitor](size_t, const uint8_t *nal, size_t nalSize) {
+        visitor(nal, nalSize);
+    });
+}
+
+AccessUnitInfo inspectAccessUnit(VideoCodec codec, const uint8_t *data, size_t size) {
+    AccessUnitInfo info;
+    forEachNalUnit(data, size, [codec, &info](const uint8_t *nal, size_t) {
+        int type = nalType(codec, nal);
+        info.nalUnits++;
+        if (isSequenceParameterSet(codec, type)) info.hasParameterSets = true;
+        if (isKeyFrameSlice(codec, type)) info.isKeyFrame = true;
+    });
+    return info;
+}
+
+std::vector<AccessUnitRange> splitAccessUnits(VideoCodec codec, const uint8_t *data, size_t size) {
+    std::vector<AccessUnitRange> units;
+    bool hasUnit = false;
+    size_t unitStart = 0;
+    bool pictureSeen = false;
+    forEachNalUnitAt(data, size, [&](size_t offset, const uint8_t *nal, size_t nalSize) {
+        int type = nalType(codec, nal);
+        bool slice = isSlice(codec, type);
+        bool boundary = isAccessUnitDelimiter(codec, type) ||
+                        (pictureSeen && isPrefix(codec, type)) ||
+                        (pictureSeen && slice && isFirstSliceOfPicture(codec, nal, nalSize));
+        if (boundary && hasUnit) {
+            units.push_back({unitStart, offset - unitStart});
+            unitStart = offset;
+            pictureSeen = false;
+        }
+        if (!hasUnit) {
+            hasUnit = true;
+            unitStart = offset;
+        }
+        if (slice) pictureSeen = true;
+    });
+    if (hasUnit) units.push_back({unitStart, size - unitStart});
+    return units;
+}
+
+bool AccessUnitFilter::accept(const uint8_t *data, size_t size) {
+    AccessUnitInfo info = inspectAccessUnit(codec_, data, size);
+    if (info.hasParameterSets) hasParameterSets_ = true;
+    if (!synced_ && hasParameterSets_ && info.isKeyFrame) synced_ = true;
+    if (synced_) {
+        accepted_++;
+    } else {
+        dropped_++;
+    }
+    return synced_;
+}
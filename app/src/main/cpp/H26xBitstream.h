@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Annex B helpers for UVC frame based H.264/HEVC payloads. Free of Android dependencies so the
+// same code handles both the USB payloads and replayed elementary streams.
+
+enum class VideoCodec {
+    H264,
+    HEVC,
+};
+
+struct AccessUnitInfo {
+    uint32_t nalUnits{0};
+    // SPS (and VPS for HEVC) present
+    bool hasParameterSets{false};
+    // IDR slice for H.264, IRAP slice for HEVC
+    bool isKeyFrame{false};
+};
+
+struct AccessUnitRange {
+    size_t offset;
+    size_t size;
+};
+
+/** Calls visitor with every start code delimited NAL unit (without its start code). */
+void forEachNalUnit(const uint8_t *data, size_t size, const std::function<void(const uint8_t *, size_t)> &visitor);
+
+AccessUnitInfo inspectAccessUnit(VideoCodec codec, const uint8_t *data, size_t size);
+
+/**
+ * Splits an Annex B elementary stream into access units. A new unit starts at an access unit
+ * delimiter, at parameter sets or SEI following a picture, or at the first slice of a picture.
+ */
+std::vector<AccessUnitRange> splitAccessUnits(VideoCodec codec, const uint8_t *data, size_t size);
+
+/**
+ * Holds back access units a decoder can't start from: everything until parameter sets have been
+ * seen and a keyframe arrives. reset() makes it wait for the next keyframe again, e.g. after an
+ * access unit was lost.
+ */
+class AccessUnitFilter final {
+public:
+    explicit AccessUnitFilter(VideoCodec codec) : codec_(codec) {}
+
+    bool accept(const uint8_t *data, size_t size);
+
+    void reset() { synced_ = false; }
+
+    uint32_t accepted() const { return accepted_; }
+
+    uint32_t dropped() const { return dropped_; }
+
+private:
+    VideoCodec codec_;
+    bool hasParameterSets_{false};
+    bool synced_{false};
+    uint32_t accepted_{0};
+    uint32_t dropped_{0};
+};
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MemoryBudget.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+
+#define ULOGW(...) __android_log_print(ANDROID_LOG_WARN, "MemoryBudget", __VA_ARGS__)
+
+namespace {
+
+constexpr size_t kSubsystems = static_cast<size_t>(MemorySubsystem::COUNT);
+
+struct Counter {
+    std::atomic<size_t> current{0};
+    std::atomic<size_t> peak{0};
+
+    size_t add(size_t bytes) {
+        size_t now = current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        size_t peakSoFar = peak.load(std::memory_order_relaxed);
+        while (now > peakSoFar && !peak.compare_exchange_weak(peakSoFar, now, std::memory_order_relaxed)) {
+        }
+        return now;
+    }
+};
+
+std::array<Counter, kSubsystems> subsystems_;
+Counter total_;
+std::atomic<size_t> budget_{0};
+// Set while the total is over the budget, so the warning is logged once per excursion.
+std::atomic<bool> overBudget_{false};
+
+} // namespace
+
+void setMemoryBudget(size_t bytes) {
+    budget_ = bytes;
+    overBudget_ = false;
+}
+
+void trackAllocation(MemorySubsystem subsystem, size_t bytes) {
+    if (bytes == 0) return;
+    subsystems_[static_cast<size_t>(subsystem)].add(bytes);
+    size_t total = total_.add(bytes);
+    size_t budget = budget_.load(std::memory_order_relaxed);
+    if (budget > 0 && total > budget && !overBudget_.exchange(true)) {
+        ULOGW("%.1f MB of native buffers exceed the budget of %.1f MB, %zu bytes for %s",
+              static_cast<float>(total) / (1024.0f * 1024.0f),
+              static_cast<float>(budget) / (1024.0f * 1024.0f),
+              bytes,
+              memorySubsystemName(subsystem));
+    }
+}
+
+void trackRelease(MemorySubsystem subsystem, size_t bytes) {
+    if (bytes == 0) return;
+    subsystems_[static_cast<size_t>(subsystem)].current.fetch_sub(bytes, std::memory_order_relaxed);
+    size_t total = total_.current.fetch_sub(bytes, std::memory_order_relaxed) - bytes;
+    size_t budget = budget_.load(std::memory_order_relaxed);
+    if (budget == 0 || total <= budget) overBudget_ = false;
+}
+
+size_t grantMemory(size_t wanted) {
+    size_t budget = budget_.load(std::memory_order_relaxed);
+    if (budget == 0) return wanted;
+    size_t total = total_.current.load(std::memory_order_relaxed);
+    return std::min(wanted, budget > total ? budget - total : 0);
+}
+
+MemoryUsage memoryUsage(MemorySubsystem subsystem) {
+    const Counter &counter = subsystems_[static_cast<size_t>(subsystem)];
+    return {counter.current.load(std::memory_order_relaxed), counter.peak.load(std::memory_order_relaxed)};
+}
+
+MemoryUsage totalMemoryUsage() {
+    return {total_.current.load(std::memory_order_relaxed), total_.peak.load(std::memory_order_relaxed)};
+}
+
+const char *memorySubsystemName(MemorySubsystem subsystem) {
+    switch (subsystem) {
+        case MemorySubsystem::VideoFrames:
+            return "video frames";
+        case MemorySubsystem::UsbTransfers:
+            return "USB transfers";
+        case MemorySubsystem::AudioRing:
+            return "audio ring";
+        case MemorySubsystem::Thumbnails:
+            return "thumbnails";
+        case MemorySubsystem::Replay:
+            return "replay";
+        case MemorySubsystem::COUNT:
+            break;
+    }
+    return "?";
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// Accounting of the large native buffers of the pipeline per subsystem, against one budget for
+// all of them. Buffers the pipeline needs are always allocated and only counted; optional
+// caches ask grantMemory() for their size, so they shrink to what the budget has left.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Must be kept in sync with MemorySubsystem in UsbVideoNativeLibrary.kt.
+enum class MemorySubsystem : int32_t {
+    // Planes of the stored frame and decoded MJPEG.
+    VideoFrames = 0,
+    // Frame buffers of libuvc and isochronous transfers of the USB audio path.
+    UsbTransfers,
+    AudioRing,
+    Thumbnails,
+    Replay,
+    COUNT,
+};
+
+struct MemoryUsage {
+    size_t current;
+    size_t peak;
+};
+
+/** Caps the total of all subsystems, in bytes; 0 lifts the cap. */
+void setMemoryBudget(size_t bytes);
+
+void trackAllocation(MemorySubsystem subsystem, size_t bytes);
+
+void trackRelease(MemorySubsystem subsystem, size_t bytes);
+
+/** How much of wanted an optional cache may take: all of it, or what the budget has left. */
+size_t grantMemory(size_t wanted);
+
+MemoryUsage memoryUsage(MemorySubsystem subsystem);
+
+/** Current total and the peak of the total, which is not the sum of the subsystem peaks. */
+MemoryUsage totalMemoryUsage();
+
+const char *memorySubsystemName(MemorySubsystem subsystem);
+
+/** Counts bytes against a subsystem for its lifetime, for memory that is allocated elsewhere. */
+class TrackedMemory final {
+public:
+    TrackedMemory() = default;
+
+    TrackedMemory(MemorySubsystem subsystem, size_t bytes) : subsystem_(subsystem), bytes_(bytes) {
+        trackAllocation(subsystem_, bytes_);
+    }
+
+    ~TrackedMemory() { trackRelease(subsystem_, bytes_); }
+
+    TrackedMemory(TrackedMemory &&other) noexcept : subsystem_(other.subsystem_), bytes_(other.bytes_) {
+        other.bytes_ = 0;
+    }
+
+    TrackedMemory &operator=(TrackedMemory &&other) noexcept {
+        if (this != &other) {
+            trackRelease(subsystem_, bytes_);
+            subsystem_ = other.subsystem_;
+            bytes_ = other.bytes_;
+            other.bytes_ = 0;
+        }
+        return *this;
+    }
+
+    size_t bytes() const { return bytes_; }
+
+private:
+    MemorySubsystem subsystem_{MemorySubsystem::VideoFrames};
+    size_t bytes_{0};
+};
+
+/** Counts the capacity of standard containers against a subsystem. */
+template <typename T, MemorySubsystem Subsystem>
+struct TrackedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = TrackedAllocator<U, Subsystem>;
+    };
+
+    TrackedAllocator() = default;
+
+    template <typename U>
+    TrackedAllocator(const TrackedAllocator<U, Subsystem> &) noexcept {}
+
+    T *allocate(size_t count) {
+        T *data = std::allocator<T>().allocate(count);
+        trackAllocation(Subsystem, count * sizeof(T));
+        return data;
+    }
+
+    void deallocate(T *data, size_t count) noexcept {
+        std::allocator<T>().deallocate(data, count);
+        trackRelease(Subsystem, count * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const TrackedAllocator<U, Subsystem> &) const noexcept { return true; }
+};
+
+using FrameBuffer = std::vector<uint8_t, TrackedAllocator<uint8_t, MemorySubsystem::VideoFrames>>;
+
+/** Frees the capacity of a container, which clear() and resize() keep. */
+template <typename Container>
+void releaseBuffer(Container &buffer) {
+    Container().swap(buffer);
+}
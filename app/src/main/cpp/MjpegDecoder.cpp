@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MjpegDecoder.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+
+#define ULOGW(...) __android_log_print(ANDROID_LOG_WARN, "MjpegDecoder", __VA_ARGS__)
+
+namespace {
+
+// Truncated frames and similar recoverable problems are common on USB and not worth a log line.
+void onMessage(j_common_ptr, int) {}
+
+} // namespace
+
+void MjpegDecoder::onError(j_common_ptr info) {
+    char message[JMSG_LENGTH_MAX];
+    info->err->format_message(info, message);
+    ULOGW("Dropping frame: %s", message);
+    // The manager is the first member of ErrorManager.
+    std::longjmp(reinterpret_cast<ErrorManager *>(info->err)->jump, 1);
+}
+
+MjpegDecoder::MjpegDecoder() {
+    info_.err = jpeg_std_error(&error_.manager);
+    error_.manager.error_exit = onError;
+    error_.manager.emit_message = onMessage;
+    jpeg_create_decompress(&info_);
+}
+
+MjpegDecoder::~MjpegDecoder() {
+    jpeg_destroy_decompress(&info_);
+}
+
+bool MjpegDecoder::decode(
+        const uint8_t *jpeg,
+        size_t size,
+        uint32_t scaleDenominator,
+        FrameBuffer &dst,
+        int32_t &width,
+        int32_t &height) {
+    if (setjmp(error_.jump) != 0) {
+        jpeg_abort_decompress(&info_);
+        return false;
+    }
+    jpeg_mem_src(&info_, jpeg, size);
+    if (jpeg_read_header(&info_, TRUE) != JPEG_HEADER_OK) {
+        jpeg_abort_decompress(&info_);
+        return false;
+    }
+    // UVC MJPEG usually leaves out the Huffman tables; libjpeg-turbo falls back to the standard
+    // ones the same way libuvc's decoder inserts them.
+    info_.out_color_space = JCS_EXT_RGBA;
+    info_.scale_num = 1;
+    info_.scale_denom = scaleDenominator;
+    jpeg_start_decompress(&info_);
+
+    width = static_cast<int32_t>(info_.output_width);
+    height = static_cast<int32_t>(info_.output_height);
+    size_t stride = static_cast<size_t>(width) * 4;
+    if (dst.size() != stride * height) dst.resize(stride * height);
+    while (info_.output_scanline < info_.output_height) {
+        JSAMPROW rows[4];
+        JDIMENSION count = std::min<JDIMENSION>(info_.rec_outbuf_height, 4);
+        for (JDIMENSION i = 0; i < count; i++) {
+            JDIMENSION row = std::min(info_.output_scanline + i, info_.output_height - 1);
+            rows[i] = dst.data() + row * stride;
+        }
+        jpeg_read_scanlines(&info_, rows, count);
+    }
+    jpeg_finish_decompress(&info_);
+    return true;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <csetjmp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <jpeglib.h>
+
+#include "MemoryBudget.h"
+
+/**
+ * Decodes MJPEG frames with libjpeg-turbo straight into R, G, B, A rows, optionally scaled down
+ * by the IDCT, which skips most of the decode work instead of resampling a full size image.
+ * The decompressor is kept between frames.
+ */
+class MjpegDecoder final {
+public:
+    MjpegDecoder();
+
+    ~MjpegDecoder();
+
+    MjpegDecoder(const MjpegDecoder &) = delete;
+    MjpegDecoder &operator=(const MjpegDecoder &) = delete;
+
+    /**
+     * Decodes jpeg at 1/scaleDenominator of its size (1, 2, 4 or 8) into dst, which is resized
+     * to the output. Returns false for corrupt frames.
+     */
+    bool decode(
+            const uint8_t *jpeg,
+            size_t size,
+            uint32_t scaleDenominator,
+            FrameBuffer &dst,
+            int32_t &width,
+            int32_t &height);
+
+private:
+    struct ErrorManager {
+        jpeg_error_mgr manager;
+        jmp_buf jump;
+    };
+
+    static void onError(j_common_ptr info);
+
+    jpeg_decompress_struct info_{};
+    ErrorManager error_{};
+};
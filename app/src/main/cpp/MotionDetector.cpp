@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MotionDetector.h"
+
+#include <android/log.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+
+#include "ThreadPolicy.h"
+
+#define ULOGI(...) __android_log_print(ANDROID_LOG_INFO, "MotionDetector", __VA_ARGS__)
+
+namespace {
+
+// Pixels per side of a grid cell.
+constexpr int32_t kCell = 8;
+// Grid cells per side of a block that is compared with the background, 64 pixels.
+constexpr int32_t kBlock = 8;
+constexpr auto kAnalysisInterval = 100ms;
+// The background moves 1/16 of the way to each analysed grid, settling in about 2 s.
+constexpr int kBackgroundShift = 4;
+// Mean absolute difference of a block's cells from the background that counts as motion. The
+// 8x8 averaging already removes most sensor and compression noise.
+constexpr uint32_t kMotionThreshold = 10;
+// More of the frame than this changing at once is a light change or a camera move, after which
+// the background starts over instead of reporting the whole frame.
+constexpr float kSceneChangeFraction = 0.6f;
+constexpr auto kEventInterval = 500ms;
+
+nanoseconds threadCpuTime() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return seconds(ts.tv_sec) + nanoseconds(ts.tv_nsec);
+}
+
+#if defined(__ARM_NEON)
+
+// Sixteen luma bytes of consecutive pixels.
+template<int PixelStride>
+uint8x16_t loadLuma(const uint8_t *pixels, int32_t channel) {
+    if constexpr (PixelStride == 1) {
+        return vld1q_u8(pixels);
+    } else if constexpr (PixelStride == 2) {
+        return vld2q_u8(pixels).val[channel];
+    } else if constexpr (PixelStride == 3) {
+        return vld3q_u8(pixels).val[channel];
+    } else {
+        return vld4q_u8(pixels).val[channel];
+    }
+}
+
+// Sums of adjacent lanes, those of a followed by those of b.
+uint16x8_t pairwiseAdd(uint16x8_t a, uint16x8_t b) {
+#if defined(__aarch64__)
+    return vpaddq_u16(a, b);
+#else
+    return vcombine_u16(vpadd_u16(vget_low_u16(a), vget_high_u16(a)), vpadd_u16(vget_low_u16(b), vget_high_u16(b)));
+#endif
+}
+
+uint32_t sumLanes(uint16x8_t v) {
+#if defined(__aarch64__)
+    return vaddvq_u16(v);
+#else
+    uint64x2_t sums = vpaddlq_u32(vpaddlq_u16(v));
+    return static_cast<uint32_t>(vgetq_lane_u64(sums, 0) + vgetq_lane_u64(sums, 1));
+#endif
+}
+
+#endif
+
+// One row of cells, from the kCell pixel rows starting at rows.
+template<int PixelStride>
+void downsampleRow(const LumaPlane &plane, const uint8_t *rows, uint8_t *cells, int32_t gridWidth) {
+    int32_t x = 0;
+#if defined(__ARM_NEON)
+    // Eight cells (64 pixels) at a time: adjacent pixels are summed in pairs down the eight
+    // rows, then adjacent sums twice more, which leaves one sum of 64 pixels per cell.
+    for (; x + 8 <= gridWidth; x += 8) {
+        uint16x8_t sums[4] = {vdupq_n_u16(0), vdupq_n_u16(0), vdupq_n_u16(0), vdupq_n_u16(0)};
+        for (int32_t row = 0; row < kCell; row++) {
+            const uint8_t *pixels = rows + row * plane.rowStride + x * kCell * PixelStride;
+            for (int32_t i = 0; i < 4; i++) {
+                sums[i] = vpadalq_u8(sums[i], loadLuma<PixelStride>(pixels + i * 16 * PixelStride, plane.channel));
+            }
+        }
+        uint16x8_t cellSums = pairwiseAdd(pairwiseAdd(sums[0], sums[1]), pairwiseAdd(sums[2], sums[3]));
+        vst1_u8(cells + x, vrshrn_n_u16(cellSums, 6));
+    }
+#endif
+    for (; x < gridWidth; x++) {
+        uint32_t sum = 0;
+        for (int32_t row = 0; row < kCell; row++) {
+            const uint8_t *pixels = rows + row * plane.rowStride + x * kCell * PixelStride + plane.channel;
+            for (int32_t i = 0; i < kCell; i++) sum += pixels[i * PixelStride];
+        }
+        cells[x] = static_cast<uint8_t>((sum + kCell * kCell / 2) / (kCell * kCell));
+    }
+}
+
+template<int PixelStride>
+void downsamplePlane(const LumaPlane &plane, uint8_t *grid, int32_t gridWidth, int32_t gridHeight) {
+    for (int32_t y = 0; y < gridHeight; y++) {
+        downsampleRow<PixelStride>(plane, plane.data + y * kCell * plane.rowStride, grid + y * gridWidth, gridWidth);
+    }
+}
+
+// Sum of absolute differences between the cells of a block and the background.
+uint32_t blockDifference(
+        const uint8_t *grid, const uint16_t *background, int32_t gridWidth, int32_t width, int32_t height) {
+    uint32_t sum = 0;
+#if defined(__ARM_NEON)
+    if (width == kBlock) {
+        uint16x8_t sums = vdupq_n_u16(0);
+        for (int32_t row = 0; row < height; row++) {
+            uint8x8_t cells = vld1_u8(grid + row * gridWidth);
+            uint8x8_t reference = vshrn_n_u16(vld1q_u16(background + row * gridWidth), 8);
+            sums = vabal_u8(sums, cells, reference);
+        }
+        return sumLanes(sums);
+    }
+#endif
+    for (int32_t row = 0; row < height; row++) {
+        for (int32_t x = 0; x < width; x++) {
+            int32_t reference = background[row * gridWidth + x] >> 8;
+            sum += std::abs(grid[row * gridWidth + x] - reference);
+        }
+    }
+    return sum;
+}
+
+} // namespace
+
+void MotionStats::recordAnalysis(nanoseconds downsample, nanoseconds analysis, bool event) {
+    analyses++;
+    downsampleTime += downsample;
+    analysisTime += analysis;
+    if (event) events++;
+
+    auto now = steady_clock::now();
+    if (now - t0 < 10s) return;
+    nanoseconds cpuTime = threadCpuTime();
+    ULOGI("Motion detection: %u analyses, downsample avg %.2f ms, analysis avg %.2f ms, %u events, %.2f%% of a core",
+          analyses,
+          duration<float, std::milli>(downsampleTime).count() / static_cast<float>(analyses),
+          duration<float, std::milli>(analysisTime).count() / static_cast<float>(analyses),
+          events,
+          100.0f * duration<float>(cpuTime - cpuTime0).count() / duration<float>(now - t0).count());
+    *this = {};
+    t0 = now;
+    cpuTime0 = cpuTime;
+}
+
+MotionDetector::MotionDetector(Listener listener) : listener_(std::move(listener)) {
+    thread_ = std::thread(&MotionDetector::run, this);
+}
+
+MotionDetector::~MotionDetector() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopRequested_ = true;
+    }
+    wakeUp_.notify_one();
+    if (thread_.joinable()) thread_.join();
+}
+
+void MotionDetector::setSource(UsbVideoStreamer *source) {
+    std::lock_guard<std::mutex> sourceLock(sourceMutex_);
+    source_ = source;
+    hasBackground_ = false;
+}
+
+void MotionDetector::downsample(const LumaPlane &plane, uint8_t *grid, int32_t gridWidth, int32_t gridHeight) {
+    switch (plane.pixelStride) {
+        case 1:
+            downsamplePlane<1>(plane, grid, gridWidth, gridHeight);
+            break;
+        case 2:
+            downsamplePlane<2>(plane, grid, gridWidth, gridHeight);
+            break;
+        case 3:
+            downsamplePlane<3>(plane, grid, gridWidth, gridHeight);
+            break;
+        default:
+            downsamplePlane<4>(plane, grid, gridWidth, gridHeight);
+            break;
+    }
+}
+
+void MotionDetector::run() {
+    applyThreadPolicy(ThreadRole::Motion);
+    ULOGI("Motion detection started");
+    stats_ = {};
+    stats_.cpuTime0 = threadCpuTime();
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopRequested_) {
+        wakeUp_.wait_for(lock, kAnalysisInterval);
+        if (stopRequested_) break;
+        lock.unlock();
+
+        auto start = steady_clock::now();
+        nanoseconds downsampleTime{0ns};
+        float activity = 0.0f;
+        std::vector<MotionRegion> regions;
+        bool analyzed = analyze(regions, activity, downsampleTime);
+        auto end = steady_clock::now();
+        bool event = !regions.empty() && end - lastEvent_ >= kEventInterval;
+        if (event) {
+            lastEvent_ = end;
+            listener_(regions, activity);
+        }
+        if (analyzed) stats_.recordAnalysis(downsampleTime, end - start, event);
+
+        lock.lock();
+    }
+    ULOGI("Motion detection stopped");
+}
+
+bool MotionDetector::analyze(std::vector<MotionRegion> &regions, float &activity, nanoseconds &downsampleTime) {
+    {
+        std::lock_guard<std::mutex> sourceLock(sourceMutex_);
+        if (source_ == nullptr) return false;
+        auto start = steady_clock::now();
+        bool read = source_->readLuma(sequence_, [this](const LumaPlane &plane) {
+            if (plane.width != frameWidth_ || plane.height != frameHeight_) {
+                frameWidth_ = plane.width;
+                frameHeight_ = plane.height;
+                gridWidth_ = plane.width / kCell;
+                gridHeight_ = plane.height / kCell;
+                grid_.assign(static_cast<size_t>(gridWidth_) * gridHeight_, 0);
+                hasBackground_ = false;
+            }
+            downsample(plane, grid_.data(), gridWidth_, gridHeight_);
+        });
+        if (!read) return false;
+        downsampleTime = steady_clock::now() - start;
+    }
+    if (grid_.empty()) return true;
+
+    int32_t blockColumns = (gridWidth_ + kBlock - 1) / kBlock;
+    int32_t blockRows = (gridHeight_ + kBlock - 1) / kBlock;
+    size_t blocks = static_cast<size_t>(blockColumns) * blockRows;
+    if (!hasBackground_) {
+        background_.resize(grid_.size());
+        std::transform(grid_.begin(), grid_.end(), background_.begin(), [](uint8_t cell) {
+            return static_cast<uint16_t>(cell << 8);
+        });
+        movedBefore_.assign(blocks, 0);
+        hasBackground_ = true;
+        return true;
+    }
+
+    // A block only counts when it also differed in the previous analysis, which drops single
+    // frame glitches such as MJPEG artifacts.
+    std::vector<uint8_t> moving(blocks, 0);
+    uint32_t differing = 0;
+    uint32_t movingBlocks = 0;
+    for (int32_t by = 0; by < blockRows; by++) {
+        for (int32_t bx = 0; bx < blockColumns; bx++) {
+            int32_t width = std::min(kBlock, gridWidth_ - bx * kBlock);
+            int32_t height = std::min(kBlock, gridHeight_ - by * kBlock);
+            size_t offset = static_cast<size_t>(by) * kBlock * gridWidth_ + bx * kBlock;
+            uint32_t difference = blockDifference(
+                    grid_.data() + offset, background_.data() + offset, gridWidth_, width, height);
+            size_t block = static_cast<size_t>(by) * blockColumns + bx;
+            bool differs = difference > kMotionThreshold * static_cast<uint32_t>(width * height);
+            moving[block] = differs && movedBefore_[block] != 0;
+            movedBefore_[block] = differs;
+            differing += differs;
+            movingBlocks += moving[block];
+        }
+    }
+    if (static_cast<float>(differing) > kSceneChangeFraction * static_cast<float>(blocks)) {
+        ULOGI("Scene changed (%u of %zu blocks), background reset", differing, blocks);
+        hasBackground_ = false;
+        return true;
+    }
+    updateBackground();
+    activity = static_cast<float>(movingBlocks) / static_cast<float>(blocks);
+
+    // 8-connected groups of moving blocks become regions.
+    std::vector<int32_t> pending;
+    for (size_t start = 0; start < blocks; start++) {
+        if (moving[start] == 0) continue;
+        moving[start] = 0;
+        pending.push_back(static_cast<int32_t>(start));
+        int32_t left = blockColumns, top = blockRows, right = -1, bottom = -1;
+        while (!pending.empty()) {
+            int32_t block = pending.back();
+            pending.pop_back();
+            int32_t bx = block % blockColumns;
+            int32_t by = block / blockColumns;
+            left = std::min(left, bx);
+            right = std::max(right, bx);
+            top = std::min(top, by);
+            bottom = std::max(bottom, by);
+            for (int32_t ny = std::max(by - 1, 0); ny <= std::min(by + 1, blockRows - 1); ny++) {
+                for (int32_t nx = std::max(bx - 1, 0); nx <= std::min(bx + 1, blockColumns - 1); nx++) {
+                    int32_t neighbour = ny * blockColumns + nx;
+                    if (moving[neighbour] == 0) continue;
+                    moving[neighbour] = 0;
+                    pending.push_back(neighbour);
+                }
+            }
+        }
+        constexpr float kBlockPixels = kBlock * kCell;
+        auto width = static_cast<float>(frameWidth_);
+        auto height = static_cast<float>(frameHeight_);
+        regions.push_back({
+                left * kBlockPixels / width,
+                top * kBlockPixels / height,
+                std::min((right + 1) * kBlockPixels / width, 1.0f),
+                std::min((bottom + 1) * kBlockPixels / height, 1.0f),
+        });
+    }
+    return true;
+}
+
+void MotionDetector::updateBackground() {
+    for (size_t i = 0; i < grid_.size(); i++) {
+        int32_t target = grid_[i] << 8;
+        background_[i] = static_cast<uint16_t>(background_[i] + ((target - background_[i]) >> kBackgroundShift));
+    }
+}
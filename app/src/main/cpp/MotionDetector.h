@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "UsbVideoStreamer.h"
+
+using namespace std::chrono;
+
+// A moving area, in fractions of the frame size.
+struct MotionRegion {
+    float left;
+    float top;
+    float right;
+    float bottom;
+};
+
+struct MotionStats {
+    uint32_t analyses = 0;
+    uint32_t events = 0;
+    nanoseconds downsampleTime{0ns};
+    nanoseconds analysisTime{0ns};
+    nanoseconds cpuTime0{0ns};
+    steady_clock::time_point t0{steady_clock::now()};
+
+    void recordAnalysis(nanoseconds downsample, nanoseconds analysis, bool event);
+};
+
+/**
+ * Detects motion for unattended monitoring. A few times a second the luma of the latest frame is
+ * averaged down to a grid of 8x8 pixel cells (with NEON where available), compared block by
+ * block against a slowly updated background with sums of absolute differences, and blocks that
+ * keep differing are grouped into regions and reported to the listener.
+ *
+ * Runs on its own low priority thread and reads the frame under the streamer's frame lock, so
+ * the capture path does no extra work. H.264/HEVC frames only exist on the GPU and are skipped.
+ */
+class MotionDetector final {
+public:
+    /** Called on the detector thread, at most twice a second while something moves. */
+    using Listener = std::function<void(const std::vector<MotionRegion> &regions, float activity)>;
+
+    explicit MotionDetector(Listener listener);
+
+    ~MotionDetector();
+
+    MotionDetector(const MotionDetector &) = delete;
+    MotionDetector &operator=(const MotionDetector &) = delete;
+
+    /** Switches the frame source; blocks until an analysis of the old one is done. */
+    void setSource(UsbVideoStreamer *source);
+
+    /** Averages plane down to one byte per whole 8x8 cell into grid. */
+    static void downsample(const LumaPlane &plane, uint8_t *grid, int32_t gridWidth, int32_t gridHeight);
+
+private:
+    void run();
+    // Compares the latest frame with the background. Returns false when there was no new frame
+    // to analyse; regions receives what moved and activity the moving fraction of the frame.
+    bool analyze(std::vector<MotionRegion> &regions, float &activity, nanoseconds &downsampleTime);
+    void updateBackground();
+
+    Listener listener_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wakeUp_;
+    bool stopRequested_{false};
+
+    // Held while reading a frame so the source can't be destroyed under the detector thread.
+    std::mutex sourceMutex_;
+    UsbVideoStreamer *source_{nullptr};
+    uint32_t sequence_{0};
+
+    int32_t frameWidth_{};
+    int32_t frameHeight_{};
+    int32_t gridWidth_{};
+    int32_t gridHeight_{};
+    std::vector<uint8_t> grid_;
+    // Running average of the grid in 8.8 fixed point.
+    std::vector<uint16_t> background_;
+    bool hasBackground_{false};
+    // Blocks that differed from the background in the previous analysis.
+    std::vector<uint8_t> movedBefore_;
+    steady_clock::time_point lastEvent_{};
+    MotionStats stats_{};
+};
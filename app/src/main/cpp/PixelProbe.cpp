@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PixelProbe.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "UsbVideoStreamer.h"
+
+#define ULOGW(...) __android_log_print(ANDROID_LOG_WARN, "PixelProbe", __VA_ARGS__)
+
+namespace {
+
+// Pixels from fraction begin to fraction end of size, at least one.
+std::pair<int32_t, int32_t> pixelSpan(float begin, float end, int32_t size) {
+    int32_t first = std::clamp(static_cast<int32_t>(std::floor(std::min(begin, end) * size)), 0, size - 1);
+    int32_t last = std::clamp(static_cast<int32_t>(std::ceil(std::max(begin, end) * size)), first + 1, size);
+    return {first, last - first};
+}
+
+// The kMaxReadSize pixels around the centre of a longer span.
+std::pair<int32_t, int32_t> readSpan(int32_t first, int32_t length) {
+    if (length <= PixelProbe::kMaxReadSize) return {first, length};
+    return {first + (length - PixelProbe::kMaxReadSize) / 2, PixelProbe::kMaxReadSize};
+}
+
+} // namespace
+
+void PixelProbe::init() {
+    queued_.clear();
+    reads_ = {};
+    for (Read &read : reads_) {
+        glGenBuffers(1, &read.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, read.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, kMaxReadSize * kMaxReadSize * 4, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+bool PixelProbe::reading() const {
+    return std::any_of(reads_.begin(), reads_.end(), [](const Read &read) { return read.fence != nullptr; });
+}
+
+void PixelProbe::schedule(const RenderTarget &frame, UsbVideoStreamer &streamer) {
+    if (frame.width <= 0 || frame.height <= 0) return;
+    uint32_t sequence = streamer.boundFrameStamp().sequence;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, frame.framebuffer);
+    for (Read &read : reads_) {
+        if (queued_.empty()) break;
+        if (read.fence != nullptr) continue;
+        ProbeRequest request = queued_.front();
+        queued_.pop_front();
+
+        auto [x, width] = pixelSpan(request.left, request.right, frame.width);
+        auto [y, height] = pixelSpan(request.top, request.bottom, frame.height);
+        auto [readX, readWidth] = readSpan(x, width);
+        auto [readY, readHeight] = readSpan(y, height);
+        read.result = {request.id, sequence, x, y, width, height, {}, std::nullopt};
+        read.result.yuv = streamer.regionYuv(sequence, x, y, width, height);
+        read.readWidth = readWidth;
+        read.readHeight = readHeight;
+
+        // Render targets hold image row 0 in texture row 0, so frame rows need no flipping.
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, read.buffer);
+        glReadPixels(readX, readY, readWidth, readHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        read.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+void PixelProbe::collect(const std::function<void(const ProbeResult &)> &onResult) {
+    for (Read &read : reads_) {
+        if (read.fence == nullptr) continue;
+        // A timeout of zero only polls the fence.
+        GLenum status = glClientWaitSync(read.fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) continue;
+        glDeleteSync(read.fence);
+        read.fence = nullptr;
+        if (status == GL_WAIT_FAILED) {
+            ULOGW("Probe %d: waiting for the read failed 0x%x", read.result.id, glGetError());
+            continue;
+        }
+
+        size_t pixels = static_cast<size_t>(read.readWidth) * read.readHeight;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, read.buffer);
+        auto data = static_cast<const uint8_t *>(
+                glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(pixels * 4), GL_MAP_READ_BIT));
+        if (data == nullptr) {
+            ULOGW("Probe %d: mapping the read failed 0x%x", read.result.id, glGetError());
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            continue;
+        }
+        std::array<uint64_t, 3> sums{};
+        for (size_t i = 0; i < pixels; i++) {
+            for (size_t c = 0; c < 3; c++) sums[c] += data[i * 4 + c];
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        for (size_t c = 0; c < 3; c++) {
+            read.result.rgb[c] = static_cast<float>(sums[c]) / static_cast<float>(pixels);
+        }
+        onResult(read.result);
+    }
+}
+
+void PixelProbe::reset() {
+    queued_.clear();
+    for (Read &read : reads_) {
+        if (read.fence != nullptr) glDeleteSync(read.fence);
+        read.fence = nullptr;
+    }
+}
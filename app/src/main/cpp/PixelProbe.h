@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+
+#include "RenderTarget.h"
+
+class UsbVideoStreamer;
+
+// A point or region to probe, in fractions of the frame with the origin at the top left. A
+// region smaller than a pixel probes the pixel it falls in.
+struct ProbeRequest {
+    int32_t id;
+    float left;
+    float top;
+    float right;
+    float bottom;
+};
+
+struct ProbeResult {
+    int32_t id;
+    // Sequence number of the probed frame, as in FrameStamp.
+    uint32_t frameSequence;
+    // The probed region in frame pixels.
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+    // Mean R, G and B (0 to 255) of the converted frame as it is shown, before scaling and
+    // overlays, over at most kMaxReadSize x kMaxReadSize pixels around the region's centre.
+    std::array<float, 3> rgb;
+    // Mean Y, Cb and Cr code values of the whole region in the source planes, on an 8-bit scale.
+    std::optional<std::array<float, 3>> yuv;
+};
+
+/**
+ * Reads pixel values back from the GPU without stalling it. Each probe copies its region of the
+ * converted frame into a pixel pack buffer with glReadPixels and sets a fence; the buffer is only
+ * mapped once the fence has signalled, a frame or so later. The Y'CbCr means are computed on the
+ * CPU from the planes of the same frame when the streamer still holds them.
+ *
+ * Must be used on the GL thread; GL objects are not deleted, as in VideoRenderer.
+ */
+class PixelProbe final {
+public:
+    static constexpr int32_t kMaxReadSize = 64;
+
+    void init();
+
+    void request(const ProbeRequest &request) { queued_.push_back(request); }
+
+    /** Whether requests wait for the next frame, which then needs to be converted. */
+    bool hasQueued() const { return !queued_.empty(); }
+
+    /** Whether reads wait for the GPU, so collect() has to be called again. */
+    bool reading() const;
+
+    /** Starts a read for every queued request that a pixel pack buffer is free for. */
+    void schedule(const RenderTarget &frame, UsbVideoStreamer &streamer);
+
+    /** Reports the reads whose fences have signalled. */
+    void collect(const std::function<void(const ProbeResult &)> &onResult);
+
+    /** Drops queued requests and pending reads, for example when the source goes away. */
+    void reset();
+
+private:
+    struct Read {
+        GLuint buffer{};
+        GLsync fence{};
+        ProbeResult result{};
+        int32_t readWidth{};
+        int32_t readHeight{};
+    };
+
+    static constexpr size_t kReads = 4;
+
+    std::deque<ProbeRequest> queued_;
+    std::array<Read, kReads> reads_{};
+};
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ProgramCache.h"
+
+#include <android/log.h>
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <vector>
+
+#define ULOGW(...) __android_log_print(ANDROID_LOG_WARN, "ProgramCache", __VA_ARGS__)
+#define ULOGE(...) __android_log_print(ANDROID_LOG_ERROR, "ProgramCache", __VA_ARGS__)
+
+namespace {
+
+constexpr uint32_t kCacheFileMagic = 0x55565042; // "UVPB"
+
+uint64_t fnv1a(const std::string &data, uint64_t hash = 0xcbf29ce484222325ULL) {
+    for (unsigned char c: data) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+bool isLinked(GLuint program) {
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    return status == GL_TRUE;
+}
+
+GLuint compileShader(GLenum type, const std::string &source) {
+    GLuint shader = glCreateShader(type);
+    const char *src = source.c_str();
+    glShaderSource(shader, 1, &src, nullptr);
+    glCompileShader(shader);
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        char log[512]{};
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        ULOGE("Shader compile failed: %s", log);
+    }
+    return shader;
+}
+
+GLuint compileAndLink(const std::string &vSource, const std::string &fSource) {
+    GLuint vShader = compileShader(GL_VERTEX_SHADER, vSource);
+    GLuint fShader = compileShader(GL_FRAGMENT_SHADER, fSource);
+    GLuint program = glCreateProgram();
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(program, vShader);
+    glAttachShader(program, fShader);
+    glLinkProgram(program);
+    glDetachShader(program, vShader);
+    glDetachShader(program, fShader);
+    glDeleteShader(vShader);
+    glDeleteShader(fShader);
+    if (!isLinked(program)) {
+        char log[512]{};
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        ULOGE("Program link failed: %s", log);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+template<typename T>
+bool readValue(std::ifstream &in, T &value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+template<typename T>
+void writeValue(std::ofstream &out, const T &value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+} // namespace
+
+ProgramCache::ProgramCache(AAssetManager *assetManager, std::string cacheDir) :
+        assetManager_(assetManager),
+        cacheDir_(std::move(cacheDir)) {
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    supportsProgramBinaries_ = formats > 0 && !cacheDir_.empty();
+    for (GLenum name: {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        auto value = reinterpret_cast<const char *>(glGetString(name));
+        driverFingerprint_ += value != nullptr ? value : "";
+        driverFingerprint_ += '|';
+    }
+    if (supportsProgramBinaries_) {
+        mkdir(cacheDir_.c_str(), 0700);
+    }
+}
+
+std::string ProgramCache::readAsset(const char *name) const {
+    AAsset *asset = AAssetManager_open(assetManager_, name, AASSET_MODE_BUFFER);
+    if (asset == nullptr) {
+        ULOGE("Missing shader asset %s", name);
+        return {};
+    }
+    std::string source(
+            static_cast<const char *>(AAsset_getBuffer(asset)),
+            static_cast<size_t>(AAsset_getLength(asset)));
+    AAsset_close(asset);
+    return source;
+}
+
+GLuint ProgramCache::getOrCreateProgram(const char *vertexAsset, const char *fragmentAsset, const char *defines) {
+    std::string vSource = readAsset(vertexAsset);
+    std::string fSource = readAsset(fragmentAsset);
+    if (*defines != '\0') {
+        size_t versionEnd = fSource.find('\n');
+        fSource.insert(versionEnd == std::string::npos ? fSource.size() : versionEnd + 1, defines);
+    }
+    if (!supportsProgramBinaries_) {
+        misses_++;
+        return compileAndLink(vSource, fSource);
+    }
+
+    // The full key is stored inside the file as well, so a hash collision is just a miss.
+    std::string fingerprint = driverFingerprint_ + vSource + '\0' + fSource;
+    std::string path = std::format("{}/{:016x}.bin", cacheDir_, fnv1a(fingerprint));
+    GLuint program = loadProgramBinary(path, fingerprint);
+    if (program != 0) {
+        hits_++;
+        return program;
+    }
+    misses_++;
+    program = compileAndLink(vSource, fSource);
+    if (program != 0) {
+        storeProgramBinary(program, path, fingerprint);
+    }
+    return program;
+}
+
+GLuint ProgramCache::loadProgramBinary(const std::string &path, const std::string &fingerprint) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return 0;
+
+    uint32_t magic = 0;
+    uint32_t fingerprintSize = 0;
+    if (!readValue(in, magic) || magic != kCacheFileMagic ||
+        !readValue(in, fingerprintSize) || fingerprintSize != fingerprint.size()) {
+        return 0;
+    }
+    std::string storedFingerprint(fingerprintSize, '\0');
+    if (!in.read(storedFingerprint.data(), fingerprintSize) || storedFingerprint != fingerprint) {
+        return 0;
+    }
+    GLenum binaryFormat = 0;
+    uint32_t length = 0;
+    if (!readValue(in, binaryFormat) || !readValue(in, length)) return 0;
+    std::vector<char> binary(length);
+    if (!in.read(binary.data(), length)) return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, binaryFormat, binary.data(), static_cast<GLsizei>(length));
+    if (!isLinked(program)) {
+        ULOGW("Driver rejected program binary %s, recompiling", path.c_str());
+        glDeleteProgram(program);
+        std::remove(path.c_str());
+        return 0;
+    }
+    return program;
+}
+
+void ProgramCache::storeProgramBinary(GLuint program, const std::string &path, const std::string &fingerprint) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLsizei writtenLength = 0;
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(program, length, &writtenLength, &binaryFormat, binary.data());
+    if (writtenLength <= 0) return;
+
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        writeValue(out, kCacheFileMagic);
+        writeValue(out, static_cast<uint32_t>(fingerprint.size()));
+        out.write(fingerprint.data(), static_cast<std::streamsize>(fingerprint.size()));
+        writeValue(out, binaryFormat);
+        writeValue(out, static_cast<uint32_t>(writtenLength));
+        out.write(binary.data(), writtenLength);
+        if (!out) {
+            ULOGW("Could not store program binary %s", path.c_str());
+            std::remove(tmpPath.c_str());
+            return;
+        }
+    }
+    std::rename(tmpPath.c_str(), path.c_str());
+}
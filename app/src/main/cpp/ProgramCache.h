@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android/asset_manager.h>
+#include <GLES3/gl3.h>
+#include <cstdint>
+#include <string>
+
+/**
+ * Builds GL programs from shader assets and caches the linked result as a driver specific binary
+ * (glGetProgramBinary) in the app code cache directory, so a new GL context does not have to
+ * compile and link GLSL again.
+ *
+ * Entries are keyed by the GL vendor, renderer and version strings (which carry the driver build)
+ * and the shader sources; a driver update or a shader edit misses the cache. The code cache
+ * directory is cleared by the system on app and platform updates. Must be used on a thread with a
+ * current GLES 3 context.
+ */
+class ProgramCache final {
+public:
+    ProgramCache(AAssetManager *assetManager, std::string cacheDir);
+
+    /**
+     * The lines in defines are inserted after the #version line of the fragment shader, so one asset can be
+     * built into several variants.
+     */
+    GLuint getOrCreateProgram(const char *vertexAsset, const char *fragmentAsset, const char *defines = "");
+
+    uint32_t hits() const { return hits_; }
+
+    uint32_t misses() const { return misses_; }
+
+private:
+    std::string readAsset(const char *name) const;
+    GLuint loadProgramBinary(const std::string &path, const std::string &fingerprint);
+    void storeProgramBinary(GLuint program, const std::string &path, const std::string &fingerprint);
+
+    AAssetManager *assetManager_;
+    std::string cacheDir_;
+    std::string driverFingerprint_;
+    bool supportsProgramBinaries_{false};
+    uint32_t hits_{0};
+    uint32_t misses_{0};
+};
@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "QualityGovernor.h"
+
+#include <android/log.h>
+#include <dlfcn.h>
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+
+#include "ThreadPolicy.h"
+
+#define ULOGI(...) __android_log_print(ANDROID_LOG_INFO, "QualityGovernor", __VA_ARGS__)
+#define ULOGW(...) __android_log_print(ANDROID_LOG_WARN, "QualityGovernor", __VA_ARGS__)
+
+namespace {
+
+constexpr auto kWindow = 1s;
+// Consecutive overloaded windows before stepping down; SEVERE and above step down at once.
+constexpr uint32_t kOverloadedWindows = 2;
+// Time given to a new step to settle before the next transition.
+constexpr auto kMinDwell = 5s;
+constexpr seconds kInitialClimbHold = 30s;
+constexpr seconds kMaxClimbHold = 300s;
+// A step down this soon after a climb doubles the climb hold.
+constexpr auto kClimbBackoffWindow = 60s;
+// Capture and upload together may use this much of the frame interval.
+constexpr float kStageBudget = 0.75f;
+constexpr int32_t kMinFps = 15;
+constexpr int kHeadroomForecastSeconds = 10;
+// AThermal_getThermalHeadroom() is 1.0 at the point where SEVERE throttling starts.
+constexpr float kHotHeadroom = 0.95f;
+constexpr float kClimbHeadroom = 0.75f;
+constexpr int32_t kLowBatteryPercent = 15;
+
+int32_t area(const StreamMode &mode) {
+    return mode.width * mode.height;
+}
+
+bool isSameMode(const StreamMode &a, const StreamMode &b) {
+    return a.fourcc == b.fourcc && a.width == b.width && a.height == b.height && a.fps == b.fps;
+}
+
+std::string stepLabel(const QualityStep &step) {
+    std::string label = std::format("{} {}x{} @{}", step.mode.fourcc, step.mode.width, step.mode.height, step.mode.fps);
+    if (step.decodeScale > 1) label += std::format(" decoded at 1/{}", step.decodeScale);
+    return label;
+}
+
+} // namespace
+
+QualityGovernor::QualityGovernor() {
+    thermalManager_ = AThermal_acquireManager();
+    if (thermalManager_ != nullptr) {
+        // API 31, while the app runs from API 30.
+        getThermalHeadroom_ = reinterpret_cast<decltype(getThermalHeadroom_)>(
+                dlsym(RTLD_DEFAULT, "AThermal_getThermalHeadroom"));
+        thermalStatus_ = AThermal_getCurrentThermalStatus(thermalManager_);
+        AThermal_registerThermalStatusListener(thermalManager_, onThermalStatus, this);
+    } else {
+        ULOGW("No thermal service, governing by stage timings only");
+    }
+    thread_ = std::thread(&QualityGovernor::run, this);
+}
+
+QualityGovernor::~QualityGovernor() {
+    if (thermalManager_ != nullptr) {
+        AThermal_unregisterThermalStatusListener(thermalManager_, onThermalStatus, this);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopRequested_ = true;
+    }
+    wakeUp_.notify_one();
+    if (thread_.joinable()) thread_.join();
+    if (thermalManager_ != nullptr) AThermal_releaseManager(thermalManager_);
+}
+
+void QualityGovernor::onThermalStatus(void *data, AThermalStatus status) {
+    auto *self = static_cast<QualityGovernor *>(data);
+    {
+        std::lock_guard<std::mutex> lock(self->mutex_);
+        self->thermalStatus_ = status;
+    }
+    ULOGI("Thermal status %d", status);
+    // Reacts before the end of the window.
+    self->wakeUp_.notify_one();
+}
+
+void QualityGovernor::setSource(UsbVideoStreamer *source) {
+    std::lock_guard<std::mutex> sourceLock(sourceMutex_);
+    source_ = source;
+    ladder_.clear();
+    step_ = 0;
+    reason_ = "";
+    overloadedWindows_ = 0;
+    relievedWindows_ = 0;
+    climbHold_ = kInitialClimbHold;
+    lastTransition_ = steady_clock::now();
+    if (source_ == nullptr) return;
+
+    source_->setDecodeScale(1);
+    source_->takeStageCounters();
+    ladder_ = buildLadder(source_->currentMode(), source_->supportedModes());
+    for (size_t i = 0; i < ladder_.size(); i++) {
+        ULOGI("Quality step %zu: %s", i, stepLabel(ladder_[i]).c_str());
+    }
+}
+
+void QualityGovernor::setBatteryState(int32_t levelPercent, bool charging, bool powerSave) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    batteryLow_ = powerSave || (!charging && levelPercent <= kLowBatteryPercent);
+}
+
+std::string QualityGovernor::summaryString() {
+    std::lock_guard<std::mutex> sourceLock(sourceMutex_);
+    if (step_ == 0 || ladder_.empty()) return "";
+    return std::format("reduced to {} ({})", stepLabel(ladder_[step_]), reason_);
+}
+
+std::vector<QualityStep> QualityGovernor::buildLadder(const StreamMode &base, const std::vector<StreamMode> &modes) {
+    std::vector<QualityStep> ladder{{base, 1}};
+    bool mjpeg = base.uvcFrameFormat == UVC_FRAME_FORMAT_MJPEG;
+
+    // Less work per frame at the same rate: MJPEG is decoded at half size by the IDCT, other
+    // formats drop to the next smaller size the device offers.
+    if (mjpeg) {
+        ladder.push_back({base, 2});
+    } else {
+        const StreamMode *smaller = nullptr;
+        for (const StreamMode &mode: modes) {
+            if (mode.fourcc != base.fourcc || mode.fps != base.fps || area(mode) >= area(base)) continue;
+            if (smaller == nullptr || area(mode) > area(*smaller)) smaller = &mode;
+        }
+        if (smaller != nullptr) ladder.push_back({*smaller, 1});
+    }
+
+    // Fewer frames.
+    QualityStep current = ladder.back();
+    const StreamMode *slower = nullptr;
+    for (const StreamMode &mode: modes) {
+        if (mode.fourcc != current.mode.fourcc || mode.width != current.mode.width ||
+            mode.height != current.mode.height || mode.fps >= current.mode.fps || mode.fps < kMinFps) {
+            continue;
+        }
+        if (slower == nullptr || mode.fps > slower->fps) slower = &mode;
+    }
+    if (slower != nullptr) ladder.push_back({*slower, current.decodeScale});
+
+    // No decode at all: the largest uncompressed mode that still keeps the reduced rate.
+    if (mjpeg) {
+        int32_t fps = ladder.back().mode.fps;
+        const StreamMode *uncompressed = nullptr;
+        for (const StreamMode &mode: modes) {
+            if (mode.uvcFrameFormat == UVC_FRAME_FORMAT_MJPEG || mode.fps < fps || mode.fps > base.fps ||
+                area(mode) > area(base)) {
+                continue;
+            }
+            bool better = uncompressed == nullptr ||
+                          area(mode) > area(*uncompressed) ||
+                          (area(mode) == area(*uncompressed) && mode.fps < uncompressed->fps) ||
+                          (area(mode) == area(*uncompressed) && mode.fps == uncompressed->fps &&
+                           mode.uvcFrameFormat == UVC_FRAME_FORMAT_NV12);
+            if (better) uncompressed = &mode;
+        }
+        if (uncompressed != nullptr) ladder.push_back({*uncompressed, 1});
+    }
+    return ladder;
+}
+
+bool QualityGovernor::pipelineBehind(const StageCounters &counters, int32_t fps) {
+    uint32_t processed = counters.frames - counters.skipped - counters.unchanged;
+    if (processed == 0) return false;
+    float frameBudgetMs = 1000.0f / static_cast<float>(std::max(fps, 1));
+    float stageMs = duration<float, std::milli>(counters.capture + counters.upload).count() / processed;
+    return stageMs > kStageBudget * frameBudgetMs || counters.dropped * 10 > processed;
+}
+
+void QualityGovernor::run() {
+    applyThreadPolicy(ThreadRole::Governor);
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopRequested_) {
+        wakeUp_.wait_for(lock, kWindow);
+        if (stopRequested_) break;
+        lock.unlock();
+        evaluate();
+        reportThreadCpuTimes();
+        lock.lock();
+    }
+}
+
+void QualityGovernor::evaluate() {
+    std::lock_guard<std::mutex> sourceLock(sourceMutex_);
+    if (source_ == nullptr || ladder_.size() < 2) return;
+
+    AThermalStatus thermalStatus;
+    bool batteryLow;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        thermalStatus = thermalStatus_;
+        batteryLow = batteryLow_;
+    }
+    float headroom = NAN;
+    if (getThermalHeadroom_ != nullptr) headroom = getThermalHeadroom_(thermalManager_, kHeadroomForecastSeconds);
+
+    StageCounters counters = source_->takeStageCounters();
+    // Stopped, a reconfigure is still settling, or frames are skipped because the source is down
+    // or the picture is unchanged.
+    uint32_t processed = counters.frames - counters.skipped - counters.unchanged;
+    if (processed == 0) return;
+
+    const QualityStep &current = ladder_[step_];
+    float frameBudgetMs = 1000.0f / static_cast<float>(std::max(current.mode.fps, 1));
+    float stageMs = duration<float, std::milli>(counters.capture + counters.upload).count() / processed;
+    bool behind = pipelineBehind(counters, current.mode.fps);
+    bool hot = thermalStatus >= ATHERMAL_STATUS_SEVERE || headroom >= kHotHeadroom;
+    bool overloaded = hot || behind;
+    bool relieved = thermalStatus <= ATHERMAL_STATUS_LIGHT && !(headroom >= kClimbHeadroom) && !behind;
+    overloadedWindows_ = overloaded ? overloadedWindows_ + 1 : 0;
+    relievedWindows_ = relieved ? relievedWindows_ + 1 : 0;
+
+    size_t floor = std::min<size_t>(batteryLow ? 1 : 0, ladder_.size() - 1);
+    auto now = steady_clock::now();
+    bool settled = now - lastTransition_ >= kMinDwell;
+    size_t target = step_;
+    const char *reason = reason_;
+    if (step_ < floor) {
+        target = floor;
+        reason = "battery";
+    } else if (overloaded && step_ + 1 < ladder_.size() && settled &&
+               (thermalStatus >= ATHERMAL_STATUS_SEVERE || overloadedWindows_ >= kOverloadedWindows)) {
+        target = step_ + 1;
+        reason = hot ? "thermal" : "pipeline behind";
+    } else if (relieved && step_ > floor && settled && relievedWindows_ * kWindow >= climbHold_) {
+        target = step_ - 1;
+    }
+
+    if (now - lastTransition_ >= kMaxClimbHold) climbHold_ = kInitialClimbHold;
+    if (target == step_) return;
+
+    if (target > step_ && now - lastClimb_ < kClimbBackoffWindow) {
+        climbHold_ = std::min(climbHold_ * 2, kMaxClimbHold);
+    }
+    ULOGI(
+            "Quality step %zu -> %zu (%s): thermal %d, headroom %.2f, stages %.2f of %.2f ms, dropped %u/%u, battery %s",
+            step_, target, target > step_ ? reason : "headroom", thermalStatus, headroom, stageMs, frameBudgetMs,
+            counters.dropped, processed, batteryLow ? "low" : "ok");
+    if (!applyStep(target)) return;
+    if (target < step_) lastClimb_ = now;
+    step_ = target;
+    reason_ = reason;
+    lastTransition_ = now;
+    overloadedWindows_ = 0;
+    relievedWindows_ = 0;
+}
+
+bool QualityGovernor::applyStep(size_t step) {
+    const QualityStep &from = ladder_[step_];
+    const QualityStep &to = ladder_[step];
+    if (!isSameMode(from.mode, to.mode) && !source_->reconfigure(to.mode)) {
+        ULOGW("Reconfigure to %s failed, staying at %s", stepLabel(to).c_str(), stepLabel(from).c_str());
+        source_->reconfigure(from.mode);
+        // A rung the device refuses is not offered again for this source.
+        if (step > step_) ladder_.erase(ladder_.begin() + static_cast<ptrdiff_t>(step), ladder_.end());
+        return false;
+    }
+    source_->setDecodeScale(to.decodeScale);
+    source_->takeStageCounters();
+    return true;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android/thermal.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "UsbVideoStreamer.h"
+
+using namespace std::chrono;
+
+// One rung of the quality ladder; rung 0 is the mode the app negotiated.
+struct QualityStep {
+    StreamMode mode;
+    uint32_t decodeScale;
+};
+
+/**
+ * Watches thermal status (AThermal), the streamer's stage timings and dropped frames, and the
+ * battery state pushed from Java, and walks the stream down a ladder of cheaper configurations:
+ * downscaled MJPEG decode (or a smaller size), a lower frame rate, then an uncompressed format
+ * that needs no decode. It climbs back one rung at a time once headroom has been back for a
+ * while; the hold doubles whenever a climb is undone soon after, so it does not oscillate.
+ *
+ * Every transition goes through UsbVideoStreamer::reconfigure() or the decode scale, so the
+ * device, presenter and audio stay up.
+ */
+class QualityGovernor final {
+public:
+    QualityGovernor();
+
+    ~QualityGovernor();
+
+    QualityGovernor(const QualityGovernor &) = delete;
+    QualityGovernor &operator=(const QualityGovernor &) = delete;
+
+    /** Builds the ladder for source and starts at its top; blocks while a step is applied. */
+    void setSource(UsbVideoStreamer *source);
+
+    void setBatteryState(int32_t levelPercent, bool charging, bool powerSave);
+
+    /** Empty while the stream runs at full quality. */
+    std::string summaryString();
+
+    static std::vector<QualityStep> buildLadder(const StreamMode &base, const std::vector<StreamMode> &modes);
+
+    /**
+     * Whether a window of stage counters from a source at fps shows capture and upload falling
+     * behind: over their share of the frame interval, or dropping more than one frame in ten.
+     */
+    static bool pipelineBehind(const StageCounters &counters, int32_t fps);
+
+private:
+    static void onThermalStatus(void *data, AThermalStatus status);
+
+    void run();
+    void evaluate();
+    bool applyStep(size_t step);
+
+    AThermalManager *thermalManager_{nullptr};
+    float (*getThermalHeadroom_)(AThermalManager *, int){nullptr};
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wakeUp_;
+    bool stopRequested_{false};
+    AThermalStatus thermalStatus_{ATHERMAL_STATUS_NONE};
+    bool batteryLow_{false};
+
+    // Held while evaluating so the source can't be destroyed under the governor thread.
+    std::mutex sourceMutex_;
+    UsbVideoStreamer *source_{nullptr};
+    std::vector<QualityStep> ladder_;
+    size_t step_{0};
+    const char *reason_{""};
+    uint32_t overloadedWindows_{0};
+    uint32_t relievedWindows_{0};
+    steady_clock::time_point lastTransition_{};
+    steady_clock::time_point lastClimb_{};
+    seconds climbHold_{};
+};
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "RealFft.h"
+
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <utility>
+
+namespace {
+
+// Four float lanes, which the compiler maps to NEON or SSE registers.
+typedef float Lanes __attribute__((vector_size(16)));
+
+Lanes load(const float *p) {
+    Lanes v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+void store(float *p, Lanes v) {
+    std::memcpy(p, &v, sizeof(v));
+}
+
+} // namespace
+
+RealFft::RealFft(size_t size) : size_(size) {
+    size_t n = size / 2;
+    re_.resize(n);
+    im_.resize(n);
+    workRe_.resize(n);
+    workIm_.resize(n);
+    for (size_t length = n; length >= 4; length /= 4) {
+        size_t quarter = length / 4;
+        for (size_t k = 1; k <= 3; k++) {
+            for (size_t p = 0; p < quarter; p++) {
+                double angle = -2.0 * std::numbers::pi * static_cast<double>(k * p) / static_cast<double>(length);
+                twiddleRe_.push_back(static_cast<float>(std::cos(angle)));
+                twiddleIm_.push_back(static_cast<float>(std::sin(angle)));
+            }
+        }
+    }
+    for (size_t k = 0; k < n; k++) {
+        double angle = -2.0 * std::numbers::pi * static_cast<double>(k) / static_cast<double>(size);
+        splitRe_.push_back(static_cast<float>(std::cos(angle)));
+        splitIm_.push_back(static_cast<float>(std::sin(angle)));
+    }
+}
+
+void RealFft::complexFft() {
+    float *xRe = re_.data();
+    float *xIm = im_.data();
+    float *yRe = workRe_.data();
+    float *yIm = workIm_.data();
+    const float *twiddleRe = twiddleRe_.data();
+    const float *twiddleIm = twiddleIm_.data();
+    size_t stride = 1;
+    for (size_t length = re_.size(); length >= 4; length /= 4) {
+        size_t quarter = length / 4;
+        const float *w1Re = twiddleRe;
+        const float *w1Im = twiddleIm;
+        const float *w2Re = twiddleRe + quarter;
+        const float *w2Im = twiddleIm + quarter;
+        const float *w3Re = twiddleRe + 2 * quarter;
+        const float *w3Im = twiddleIm + 2 * quarter;
+        for (size_t p = 0; p < quarter; p++) {
+            const size_t in[4] = {
+                    stride * p, stride * (p + quarter), stride * (p + 2 * quarter), stride * (p + 3 * quarter)};
+            const size_t out = stride * 4 * p;
+            size_t q = 0;
+            if (stride >= 4) {
+                Lanes c1 = {w1Re[p], w1Re[p], w1Re[p], w1Re[p]};
+                Lanes s1 = {w1Im[p], w1Im[p], w1Im[p], w1Im[p]};
+                Lanes c2 = {w2Re[p], w2Re[p], w2Re[p], w2Re[p]};
+                Lanes s2 = {w2Im[p], w2Im[p], w2Im[p], w2Im[p]};
+                Lanes c3 = {w3Re[p], w3Re[p], w3Re[p], w3Re[p]};
+                Lanes s3 = {w3Im[p], w3Im[p], w3Im[p], w3Im[p]};
+                for (; q < stride; q += 4) {
+                    Lanes aRe = load(xRe + in[0] + q), aIm = load(xIm + in[0] + q);
+                    Lanes bRe = load(xRe + in[1] + q), bIm = load(xIm + in[1] + q);
+                    Lanes cRe = load(xRe + in[2] + q), cIm = load(xIm + in[2] + q);
+                    Lanes dRe = load(xRe + in[3] + q), dIm = load(xIm + in[3] + q);
+                    Lanes apcRe = aRe + cRe, apcIm = aIm + cIm;
+                    Lanes amcRe = aRe - cRe, amcIm = aIm - cIm;
+                    Lanes bpdRe = bRe + dRe, bpdIm = bIm + dIm;
+                    // i * (b - d)
+                    Lanes jbmdRe = dIm - bIm, jbmdIm = bRe - dRe;
+                    store(yRe + out + q, apcRe + bpdRe);
+                    store(yIm + out + q, apcIm + bpdIm);
+                    Lanes tRe = amcRe - jbmdRe, tIm = amcIm - jbmdIm;
+                    store(yRe + out + stride + q, tRe * c1 - tIm * s1);
+                    store(yIm + out + stride + q, tRe * s1 + tIm * c1);
+                    tRe = apcRe - bpdRe;
+                    tIm = apcIm - bpdIm;
+                    store(yRe + out + 2 * stride + q, tRe * c2 - tIm * s2);
+                    store(yIm + out + 2 * stride + q, tRe * s2 + tIm * c2);
+                    tRe = amcRe + jbmdRe;
+                    tIm = amcIm + jbmdIm;
+                    store(yRe + out + 3 * stride + q, tRe * c3 - tIm * s3);
+                    store(yIm + out + 3 * stride + q, tRe * s3 + tIm * c3);
+                }
+            }
+            // The first stage, with a stride of 1.
+            for (; q < stride; q++) {
+                float aRe = xRe[in[0] + q], aIm = xIm[in[0] + q];
+                float bRe = xRe[in[1] + q], bIm = xIm[in[1] + q];
+                float cRe = xRe[in[2] + q], cIm = xIm[in[2] + q];
+                float dRe = xRe[in[3] + q], dIm = xIm[in[3] + q];
+                float apcRe = aRe + cRe, apcIm = aIm + cIm;
+                float amcRe = aRe - cRe, amcIm = aIm - cIm;
+                float bpdRe = bRe + dRe, bpdIm = bIm + dIm;
+                float jbmdRe = dIm - bIm, jbmdIm = bRe - dRe;
+                yRe[out + q] = apcRe + bpdRe;
+                yIm[out + q] = apcIm + bpdIm;
+                float tRe = amcRe - jbmdRe, tIm = amcIm - jbmdIm;
+                yRe[out + stride + q] = tRe * w1Re[p] - tIm * w1Im[p];
+                yIm[out + stride + q] = tRe * w1Im[p] + tIm * w1Re[p];
+                tRe = apcRe - bpdRe;
+                tIm = apcIm - bpdIm;
+                yRe[out + 2 * stride + q] = tRe * w2Re[p] - tIm * w2Im[p];
+                yIm[out + 2 * stride + q] = tRe * w2Im[p] + tIm * w2Re[p];
+                tRe = amcRe + jbmdRe;
+                tIm = amcIm + jbmdIm;
+                yRe[out + 3 * stride + q] = tRe * w3Re[p] - tIm * w3Im[p];
+                yIm[out + 3 * stride + q] = tRe * w3Im[p] + tIm * w3Re[p];
+            }
+        }
+        twiddleRe += 3 * quarter;
+        twiddleIm += 3 * quarter;
+        stride *= 4;
+        std::swap(xRe, yRe);
+        std::swap(xIm, yIm);
+    }
+    if (xRe != re_.data()) {
+        std::memcpy(re_.data(), xRe, re_.size() * sizeof(float));
+        std::memcpy(im_.data(), xIm, im_.size() * sizeof(float));
+    }
+}
+
+void RealFft::powerSpectrum(const float *input, float *power) {
+    size_t n = size_ / 2;
+    for (size_t k = 0; k < n; k++) {
+        re_[k] = input[2 * k];
+        im_[k] = input[2 * k + 1];
+    }
+    complexFft();
+    // X[k] = (Z[k] + conj(Z[n - k])) / 2 - i / 2 * w^k * (Z[k] - conj(Z[n - k]))
+    for (size_t k = 0; k < n; k++) {
+        size_t mirror = k == 0 ? 0 : n - k;
+        float evenRe = 0.5f * (re_[k] + re_[mirror]);
+        float evenIm = 0.5f * (im_[k] - im_[mirror]);
+        float oddRe = 0.5f * (im_[k] + im_[mirror]);
+        float oddIm = -0.5f * (re_[k] - re_[mirror]);
+        float xRe = evenRe + oddRe * splitRe_[k] - oddIm * splitIm_[k];
+        float xIm = evenIm + oddRe * splitIm_[k] + oddIm * splitRe_[k];
+        power[k] = xRe * xRe + xIm * xIm;
+    }
+}
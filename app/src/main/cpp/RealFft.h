@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Forward FFT of real input, computed as a complex FFT of half the size with even samples as
+ * the real and odd samples as the imaginary part. The complex FFT is a radix-4 Stockham
+ * transform on split real and imaginary arrays, which needs no bit reversal and whose butterflies
+ * run on four lanes (NEON or SSE through the compiler's vector types) from the second stage on.
+ */
+class RealFft final {
+public:
+    /** size must be twice a power of 4, like 512, 2048 or 8192. */
+    explicit RealFft(size_t size);
+
+    size_t size() const { return size_; }
+
+    /** Squared magnitudes of bins 0 to size / 2 - 1 of input, which holds size samples. */
+    void powerSpectrum(const float *input, float *power);
+
+private:
+    void complexFft();
+
+    size_t size_;
+    // Twiddles of every stage: w^p, w^2p and w^3p for p below a quarter of the stage length.
+    std::vector<float> twiddleRe_;
+    std::vector<float> twiddleIm_;
+    // Twiddles of the split that turns the half size complex result into the real one.
+    std::vector<float> splitRe_;
+    std::vector<float> splitIm_;
+    std::vector<float> re_;
+    std::vector<float> im_;
+    std::vector<float> workRe_;
+    std::vector<float> workIm_;
+};
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <cstdint>
+
+/**
+ * An RGBA8 texture and the framebuffer that renders into it, for the passes that run between
+ * the format programs and the window. Targets are drawn with image row 0 in texture row 0,
+ * which is upside down compared to the window.
+ *
+ * GL objects are not deleted, for the same reason as in VideoRenderer.
+ */
+struct RenderTarget {
+    GLuint texture{};
+    GLuint framebuffer{};
+    int32_t width{};
+    int32_t height{};
+
+    /** Creates the target, or reallocates its texture when the size changed. */
+    void ensureSize(int32_t targetWidth, int32_t targetHeight);
+
+    /** Binds the framebuffer and covers it with the viewport. */
+    void bind() const;
+};
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ReplayCache.h"
+
+#include <android/log.h>
+#include <lz4.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+#include "ThreadPolicy.h"
+
+#define ULOGI(...) __android_log_print(ANDROID_LOG_INFO, "ReplayCache", __VA_ARGS__)
+#define ULOGE(...) __android_log_print(ANDROID_LOG_ERROR, "ReplayCache", __VA_ARGS__)
+
+namespace {
+
+// How often the source is checked for a new frame, which catches every frame up to 120 fps.
+constexpr auto kPollInterval = 8ms;
+// LZ4 acceleration; higher is faster with less compression.
+constexpr int kAcceleration = 2;
+// Scratch of UsbVideoStreamer::scaleFrameToNV12 per frame pixel, at most.
+constexpr size_t kScratchBytesPerPixel = 7;
+
+nanoseconds threadCpuTime() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return seconds(ts.tv_sec) + nanoseconds(ts.tv_nsec);
+}
+
+} // namespace
+
+void ReplayCacheStats::recordFrame(
+        nanoseconds scale, nanoseconds compress, size_t raw, size_t stored, size_t arenaUsed, size_t arenaSize,
+        nanoseconds held) {
+    frames++;
+    rawBytes += raw;
+    storedBytes += stored;
+    scaleTime += scale;
+    compressTime += compress;
+
+    auto now = steady_clock::now();
+    if (now - t0 < 10s) return;
+    nanoseconds cpuTime = threadCpuTime();
+    ULOGI("Replay cache: %u frames, scale avg %.2f ms, compress avg %.2f ms, ratio %.2f, "
+          "%.1f of %.1f MB for %.1f s, %.2f%% of a core",
+          frames,
+          duration<float, std::milli>(scaleTime).count() / static_cast<float>(frames),
+          duration<float, std::milli>(compressTime).count() / static_cast<float>(frames),
+          static_cast<float>(rawBytes) / static_cast<float>(std::max<uint64_t>(storedBytes, 1)),
+          static_cast<float>(arenaUsed) / (1024.0f * 1024.0f),
+          static_cast<float>(arenaSize) / (1024.0f * 1024.0f),
+          duration<float>(held).count(),
+          100.0f * duration<float>(cpuTime - cpuTime0).count() / duration<float>(now - t0).count());
+    *this = {};
+    t0 = now;
+    cpuTime0 = cpuTime;
+}
+
+ReplayCache::ReplayCache(milliseconds duration, size_t memoryCap, bool compress) :
+        duration_(duration),
+        compress_(compress) {
+    // The working buffers are only allocated once the budget leaves room for a frame in the arena.
+    size_t compressedBytes = compress_ ? LZ4_compressBound(static_cast<int>(kMaxFrameBytes)) : 0;
+    size_t scratchBytes = static_cast<size_t>(kMaxWidth) * kMaxHeight * kScratchBytesPerPixel;
+    size_t workingBytes = kMaxFrameBytes + compressedBytes + scratchBytes;
+    size_t granted = grantMemory(memoryCap);
+    if (granted < memoryCap) ULOGI("Memory budget leaves %zu of %zu bytes for replay", granted, memoryCap);
+    size_t arenaSize = granted > workingBytes ? granted - workingBytes : 0;
+    if (arenaSize < kMaxFrameBytes) {
+        ULOGE("%zu bytes of memory hold no replay frame", granted);
+        return;
+    }
+
+    frame_.resize(kMaxFrameBytes);
+    compressed_.resize(compressedBytes);
+    scratch_.reserve(scratchBytes);
+    arenaSize_ = arenaSize;
+    // Left uninitialized; pages are only committed as the ring first fills them.
+    arena_.reset(new uint8_t[arenaSize_]);
+    memory_ = TrackedMemory(MemorySubsystem::Replay, arenaSize_ + workingBytes);
+    ULOGI("Replay cache: %lld ms of up to %dx%d NV12%s in %.1f MB",
+          static_cast<long long>(duration_.count()), kMaxWidth, kMaxHeight, compress_ ? " with LZ4" : "",
+          static_cast<float>(arenaSize_) / (1024.0f * 1024.0f));
+    thread_ = std::thread(&ReplayCache::run, this);
+}
+
+ReplayCache::~ReplayCache() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopRequested_ = true;
+    }
+    wakeUp_.notify_one();
+    if (thread_.joinable()) thread_.join();
+}
+
+void ReplayCache::setSource(UsbVideoStreamer *source) {
+    std::lock_guard<std::mutex> sourceLock(sourceMutex_);
+    source_ = source;
+    stamp_ = {};
+}
+
+std::optional<std::pair<steady_clock::time_point, steady_clock::time_point>> ReplayCache::span() {
+    std::lock_guard<std::mutex> lock(arenaMutex_);
+    if (records_.empty()) return std::nullopt;
+    return std::make_pair(records_.front().frame.stamp.captured, records_.back().frame.stamp.captured);
+}
+
+size_t ReplayCache::recordAt(steady_clock::time_point time) const {
+    auto after = std::upper_bound(records_.begin(), records_.end(), time, [](auto time, const Record &record) {
+        return time < record.frame.stamp.captured;
+    });
+    return after == records_.begin() ? 0 : static_cast<size_t>(after - records_.begin()) - 1;
+}
+
+std::optional<steady_clock::time_point> ReplayCache::nextChange(steady_clock::time_point time, bool forwards) {
+    std::lock_guard<std::mutex> lock(arenaMutex_);
+    if (records_.empty()) return std::nullopt;
+    size_t index = recordAt(time);
+    if (forwards) {
+        if (index + 1 >= records_.size()) return std::nullopt;
+        return records_[index + 1].frame.stamp.captured;
+    }
+    // Backwards the shown frame changes once time drops below its capture time.
+    if (index == 0) return std::nullopt;
+    return records_[index].frame.stamp.captured;
+}
+
+bool ReplayCache::read(steady_clock::time_point time, ReplayFrame &frame, uint8_t *nv12) {
+    std::lock_guard<std::mutex> lock(arenaMutex_);
+    if (records_.empty()) return false;
+    const Record &record = records_[recordAt(time)];
+    if (record.frame.serial == frame.serial) return false;
+
+    auto rawSize = static_cast<int>(static_cast<size_t>(record.frame.width) * record.frame.height * 3 / 2);
+    const uint8_t *data = arena_.get() + record.offset;
+    if (!record.compressed) {
+        std::memcpy(nv12, data, rawSize);
+    } else if (LZ4_decompress_safe(
+                       reinterpret_cast<const char *>(data), reinterpret_cast<char *>(nv12),
+                       static_cast<int>(record.size), static_cast<int>(kMaxFrameBytes)) != rawSize) {
+        ULOGE("Frame %llu does not decompress", static_cast<unsigned long long>(record.frame.serial));
+        return false;
+    }
+    frame = record.frame;
+    return true;
+}
+
+void ReplayCache::run() {
+    applyThreadPolicy(ThreadRole::Replay);
+    stats_ = {};
+    stats_.cpuTime0 = threadCpuTime();
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopRequested_) {
+        wakeUp_.wait_for(lock, kPollInterval);
+        if (stopRequested_) break;
+        lock.unlock();
+        addFrame();
+        lock.lock();
+    }
+}
+
+bool ReplayCache::addFrame() {
+    int32_t width = 0;
+    int32_t height = 0;
+    nanoseconds scaleTime{0ns};
+    {
+        std::lock_guard<std::mutex> sourceLock(sourceMutex_);
+        if (source_ == nullptr) return false;
+        int32_t sourceWidth = 0;
+        int32_t sourceHeight = 0;
+        source_->getFrameSize(sourceWidth, sourceHeight);
+        if (sourceWidth <= 0 || sourceHeight <= 0) return false;
+        float scale = std::min({
+                1.0f,
+                static_cast<float>(kMaxWidth) / static_cast<float>(sourceWidth),
+                static_cast<float>(kMaxHeight) / static_cast<float>(sourceHeight)});
+        // NV12 needs even sizes.
+        width = static_cast<int32_t>(static_cast<float>(sourceWidth) * scale) & ~1;
+        height = static_cast<int32_t>(static_cast<float>(sourceHeight) * scale) & ~1;
+        if (width < 2 || height < 2) return false;
+        auto start = steady_clock::now();
+        if (!source_->scaleFrameToNV12(stamp_, frame_.data(), width, height, scratch_)) return false;
+        scaleTime = steady_clock::now() - start;
+    }
+
+    size_t rawSize = static_cast<size_t>(width) * height * 3 / 2;
+    const uint8_t *data = frame_.data();
+    size_t size = rawSize;
+    bool compressed = false;
+    auto compressStart = steady_clock::now();
+    if (compress_) {
+        int packed = LZ4_compress_fast(
+                reinterpret_cast<const char *>(frame_.data()), reinterpret_cast<char *>(compressed_.data()),
+                static_cast<int>(rawSize), static_cast<int>(compressed_.size()), kAcceleration);
+        // Frames that do not compress, such as noise, are stored as they are.
+        if (packed > 0 && static_cast<size_t>(packed) < rawSize) {
+            data = compressed_.data();
+            size = packed;
+            compressed = true;
+        }
+    }
+    nanoseconds compressTime = steady_clock::now() - compressStart;
+
+    std::lock_guard<std::mutex> lock(arenaMutex_);
+    if (writeOffset_ + size > arenaSize_) {
+        // The records past the write offset are the oldest; they go before the ring starts over.
+        while (!records_.empty() && records_.front().offset >= writeOffset_) records_.pop_front();
+        writeOffset_ = 0;
+    }
+    while (!records_.empty()) {
+        const Record &oldest = records_.front();
+        bool overlaps = oldest.offset < writeOffset_ + size && writeOffset_ < oldest.offset + oldest.size;
+        bool expired = stamp_.captured - oldest.frame.stamp.captured > duration_;
+        if (!overlaps && !expired) break;
+        records_.pop_front();
+    }
+    std::memcpy(arena_.get() + writeOffset_, data, size);
+    records_.push_back({writeOffset_, size, compressed, {stamp_, ++serial_, width, height}});
+    writeOffset_ += size;
+
+    size_t arenaUsed = 0;
+    for (const Record &record : records_) arenaUsed += record.size;
+    stats_.recordFrame(
+            scaleTime, compressTime, rawSize, size, arenaUsed, arenaSize_,
+            records_.back().frame.stamp.captured - records_.front().frame.stamp.captured);
+    return true;
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "MemoryBudget.h"
+#include "UsbVideoStreamer.h"
+
+using namespace std::chrono;
+
+struct ReplayCacheStats {
+    uint32_t frames = 0;
+    uint64_t rawBytes = 0;
+    uint64_t storedBytes = 0;
+    nanoseconds scaleTime{0ns};
+    nanoseconds compressTime{0ns};
+    nanoseconds cpuTime0{0ns};
+    steady_clock::time_point t0{steady_clock::now()};
+
+    // arenaUsed bytes of the arena hold the frames of the last held duration.
+    void recordFrame(
+            nanoseconds scale, nanoseconds compress, size_t raw, size_t stored, size_t arenaUsed, size_t arenaSize,
+            nanoseconds held);
+};
+
+// A frame held by the cache.
+struct ReplayFrame {
+    FrameStamp stamp;
+    // Counts the frames added to the cache, so that frames skipped in between can be told.
+    uint64_t serial;
+    int32_t width;
+    int32_t height;
+};
+
+/**
+ * Keeps the last seconds of video at preview quality for instant replay, without an encoder.
+ * The cache's own low priority thread scales each new frame down to NV12 with libyuv, outside
+ * the capture callback, optionally compresses it with LZ4 and appends it to a ring of records
+ * in an arena that is allocated once from the memory cap. Records older than the duration, and
+ * those the next record would overlap, are dropped, so the cache holds less than the duration
+ * when frames do not compress well enough to fit.
+ *
+ * Frames are read back by capture time, which lets the presenter replay them at any speed while
+ * new ones keep arriving. 10 and 16-bit, RGB and H.264/HEVC sources are not cached.
+ */
+class ReplayCache final {
+public:
+    // Frames are scaled to fit this size at the source's aspect ratio.
+    static constexpr int32_t kMaxWidth = 480;
+    static constexpr int32_t kMaxHeight = 270;
+    static constexpr size_t kMaxFrameBytes = static_cast<size_t>(kMaxWidth) * kMaxHeight * 3 / 2;
+
+    /**
+     * memoryCap bounds the arena together with the working buffers, in bytes; less is taken when
+     * the memory budget has less left.
+     */
+    ReplayCache(milliseconds duration, size_t memoryCap, bool compress);
+
+    ~ReplayCache();
+
+    ReplayCache(const ReplayCache &) = delete;
+    ReplayCache &operator=(const ReplayCache &) = delete;
+
+    /** Switches the frame source; blocks until a frame of the old one is cached. */
+    void setSource(UsbVideoStreamer *source);
+
+    /** Capture times of the oldest and the newest frame, or nothing while the cache is empty. */
+    std::optional<std::pair<steady_clock::time_point, steady_clock::time_point>> span();
+
+    /**
+     * Capture time of the frame shown after the one shown at time when playing forwards, or
+     * before it when playing backwards.
+     */
+    std::optional<steady_clock::time_point> nextChange(steady_clock::time_point time, bool forwards);
+
+    /**
+     * Decodes the newest frame captured at or before time, or the oldest frame, into nv12 (at
+     * most kMaxFrameBytes), unless frame already holds it. Returns whether frame and nv12 were
+     * replaced.
+     */
+    bool read(steady_clock::time_point time, ReplayFrame &frame, uint8_t *nv12);
+
+private:
+    struct Record {
+        size_t offset;
+        size_t size;
+        bool compressed;
+        ReplayFrame frame;
+    };
+
+    void run();
+    // Adds the latest frame; returns false when there was no new frame.
+    bool addFrame();
+    // Index of the record shown at time. Called with arenaMutex_ held and records_ not empty.
+    size_t recordAt(steady_clock::time_point time) const;
+
+    milliseconds duration_;
+    bool compress_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wakeUp_;
+    bool stopRequested_{false};
+
+    // Held while scaling a frame so the source can't be destroyed under the cache thread.
+    std::mutex sourceMutex_;
+    UsbVideoStreamer *source_{nullptr};
+    FrameStamp stamp_{};
+    std::vector<uint8_t> frame_;
+    std::vector<uint8_t> compressed_;
+    std::vector<uint8_t> scratch_;
+
+    // Guards the records, oldest first, and the arena they are stored in from offset 0 up to
+    // writeOffset_ and on past it, in the order they were added.
+    std::mutex arenaMutex_;
+    size_t arenaSize_{0};
+    std::unique_ptr<uint8_t[]> arena_;
+    std::deque<Record> records_;
+    size_t writeOffset_{0};
+    uint64_t serial_{0};
+    TrackedMemory memory_;
+    ReplayCacheStats stats_{};
+};
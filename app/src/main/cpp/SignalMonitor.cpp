@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SignalMonitor.h"
+
+#include "Crc32c.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+#include <cstring>
+
+#define ULOGI(...) __android_log_print(ANDROID_LOG_INFO, "SignalMonitor", __VA_ARGS__)
+
+namespace {
+
+// Words of 8 bytes hashed from evenly spaced points of the payload.
+constexpr size_t kHashSamples = 512;
+// Luma samples across and down the frame.
+constexpr int32_t kLumaColumns = 48;
+constexpr int32_t kLumaRows = 27;
+// Limited range black is 16; noisy black from a card without input stays below these.
+constexpr uint32_t kBlackMean = 24;
+constexpr uint32_t kBlackMax = 48;
+
+constexpr auto kFrozenAfter = 2s;
+// How often a raw payload whose samples stopped changing is hashed in full.
+constexpr auto kFullHashInterval = 1s;
+constexpr auto kNoSignalAfter = 1s;
+// Black frames decoded while the signal is down, to notice it coming back.
+constexpr auto kProbeInterval = 500ms;
+
+} // namespace
+
+uint64_t SignalMonitor::sampleHash(const uint8_t *payload, size_t size) {
+    // FNV-1a over 8-byte words.
+    uint64_t hash = 0xcbf29ce484222325ULL ^ size;
+    if (size < sizeof(uint64_t)) return hash;
+    size_t step = std::max<size_t>((size - sizeof(uint64_t)) / kHashSamples, 1);
+    for (size_t offset = 0; offset + sizeof(uint64_t) <= size; offset += step) {
+        uint64_t word;
+        std::memcpy(&word, payload + offset, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+const char *signalStateName(SignalState state) {
+    switch (state) {
+        case SignalState::FROZEN:
+            return "frozen";
+        case SignalState::NO_SIGNAL:
+            return "no signal";
+        default:
+            return "live";
+    }
+}
+
+void SignalMonitor::reset() {
+    state_ = SignalState::LIVE;
+    lastHash_.reset();
+    lastFullHash_.reset();
+    lastFullHashAt_.reset();
+    fullHashMatched_ = false;
+    blackSince_.reset();
+    stateSince_ = steady_clock::now();
+    skipped_ = 0;
+}
+
+void SignalMonitor::setState(SignalState state, steady_clock::time_point now) {
+    if (state == state_) return;
+    ULOGI("Signal %s after %.1f s %s, %u frames skipped",
+          signalStateName(state),
+          duration<float>(now - stateSince_).count(),
+          signalStateName(state_),
+          skipped_);
+    state_ = state;
+    stateSince_ = now;
+    skipped_ = 0;
+}
+
+bool SignalMonitor::skipFrame(
+        const uint8_t *payload, size_t size, uint64_t payloadHash, bool hashedInFull,
+        steady_clock::time_point now) {
+    bool changed = payloadHash != lastHash_;
+    lastHash_ = payloadHash;
+    if (changed) {
+        lastFullHash_.reset();
+        lastFullHashAt_.reset();
+        fullHashMatched_ = false;
+    } else if (!hashedInFull && now - lastChange_ >= kFrozenAfter &&
+               (!lastFullHashAt_.has_value() || now - *lastFullHashAt_ >= kFullHashInterval)) {
+        // The samples miss small changes such as a cursor or a clock on a static desktop, so the
+        // whole payload is hashed once in a while, and the source only counts as frozen while
+        // these hashes match. The verdict holds in between.
+        uint64_t fullHash = static_cast<uint64_t>(size) << 32 | crc32c(payload, size);
+        changed = lastFullHash_.has_value() && fullHash != *lastFullHash_;
+        fullHashMatched_ = lastFullHash_.has_value() && !changed;
+        lastFullHash_ = fullHash;
+        lastFullHashAt_ = now;
+    }
+    if (changed) {
+        lastChange_ = now;
+        if (state_ == SignalState::FROZEN) setState(SignalState::LIVE, now);
+    } else if (state_ == SignalState::LIVE && now - lastChange_ >= kFrozenAfter &&
+               (hashedInFull || fullHashMatched_)) {
+        setState(SignalState::FROZEN, now);
+    }
+
+    bool skip = false;
+    if (skipWhileDown_) {
+        if (state_ == SignalState::FROZEN) {
+            skip = true;
+        } else if (state_ == SignalState::NO_SIGNAL) {
+            skip = now - lastProbe_ < kProbeInterval;
+            if (!skip) lastProbe_ = now;
+        }
+    }
+    if (skip) skipped_++;
+    return skip;
+}
+
+void SignalMonitor::analyzeLuma(
+        const uint8_t *luma, int32_t width, int32_t height, int32_t pixelStride, int32_t rowStride,
+        steady_clock::time_point now) {
+    if (width < kLumaColumns || height < kLumaRows) return;
+    uint32_t sum = 0;
+    uint32_t max = 0;
+    for (int32_t row = 0; row < kLumaRows; row++) {
+        const uint8_t *line = luma + static_cast<size_t>((2 * row + 1) * height / (2 * kLumaRows)) * rowStride;
+        for (int32_t column = 0; column < kLumaColumns; column++) {
+            uint32_t value = line[static_cast<size_t>((2 * column + 1) * width / (2 * kLumaColumns)) * pixelStride];
+            sum += value;
+            max = std::max(max, value);
+        }
+    }
+    bool black = max <= kBlackMax && sum <= kBlackMean * kLumaColumns * kLumaRows;
+    if (!black) {
+        blackSince_.reset();
+        if (state_ == SignalState::NO_SIGNAL) setState(SignalState::LIVE, now);
+        return;
+    }
+    if (!blackSince_.has_value()) blackSince_ = now;
+    if (now - *blackSince_ >= kNoSignalAfter) setState(SignalState::NO_SIGNAL, now);
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+using namespace std::chrono;
+
+// Must be kept in sync with SignalState in UsbVideoNativeLibrary.kt.
+enum class SignalState : int32_t {
+    LIVE = 0,
+    // The same payload over and over, typically the last frame before the source went away.
+    FROZEN = 1,
+    // Black frames, which most capture cards send without an input.
+    NO_SIGNAL = 2,
+};
+
+const char *signalStateName(SignalState state);
+
+/**
+ * Tells live video from what capture cards send when their HDMI source is gone: a frozen frame
+ * (found from payload hashes) or black (found from sparse luma samples). A sampled hash that stops
+ * changing is confirmed with a CRC-32C of the whole payload, taken once a second, so a static
+ * desktop with a moving cursor stays live.
+ *
+ * Only reports the state by default. With setSkipWhileDown(true), frames are skipped before they
+ * are decoded and uploaded while the signal is down: a frozen payload until it changes, black
+ * frames except for a probe every half second that notices the source coming back.
+ *
+ * Used on the capture thread; state() may be read from any thread.
+ */
+class SignalMonitor final {
+public:
+    /** Hash of a sample of the payload, for formats that are not hashed in full. */
+    static uint64_t sampleHash(const uint8_t *payload, size_t size);
+
+    /**
+     * Returns whether the frame should be dropped without decoding it. payloadHash is either a hash
+     * of the whole payload (hashedInFull) or a sampleHash() of it.
+     */
+    bool skipFrame(
+            const uint8_t *payload, size_t size, uint64_t payloadHash, bool hashedInFull,
+            steady_clock::time_point now);
+
+    /** Samples the 8-bit luma of a kept frame, pixelStride bytes apart within rows of rowStride bytes. */
+    void analyzeLuma(
+            const uint8_t *luma, int32_t width, int32_t height, int32_t pixelStride, int32_t rowStride,
+            steady_clock::time_point now);
+
+    SignalState state() const { return state_; }
+
+    void setSkipWhileDown(bool skip) { skipWhileDown_ = skip; }
+
+    void reset();
+
+private:
+    void setState(SignalState state, steady_clock::time_point now);
+
+    std::atomic<SignalState> state_{SignalState::LIVE};
+    std::atomic<bool> skipWhileDown_{false};
+    std::optional<uint64_t> lastHash_;
+    // Full hash of a sampled payload that has not changed for a while, when it was taken, and
+    // whether it matched the one before.
+    std::optional<uint64_t> lastFullHash_;
+    std::optional<steady_clock::time_point> lastFullHashAt_;
+    bool fullHashMatched_{false};
+    steady_clock::time_point lastChange_{};
+    std::optional<steady_clock::time_point> blackSince_;
+    steady_clock::time_point lastProbe_{};
+    steady_clock::time_point stateSince_{steady_clock::now()};
+    uint32_t skipped_{0};
+};
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TemporalDenoiser.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+
+#include "ProgramCache.h"
+#include "Trace.h"
+
+#define ULOGI(...) __android_log_print(ANDROID_LOG_INFO, "TemporalDenoiser", __VA_ARGS__)
+#define ULOGE(...) __android_log_print(ANDROID_LOG_ERROR, "TemporalDenoiser", __VA_ARGS__)
+
+namespace {
+
+// GPU time budget of one pass, set for 1080p.
+constexpr nanoseconds kDenoiseBudget = 1500us;
+
+// Weight of the history at full strength; the current frame always keeps some weight so a
+// static picture still converges on it.
+constexpr float kMaxHistoryWeight = 0.85f;
+
+} // namespace
+
+void DenoiserStats::recordPass(int32_t width, int32_t height, nanoseconds passGpuTime) {
+    passes++;
+    gpuTime += passGpuTime;
+    maxGpuTime = std::max(maxGpuTime, passGpuTime);
+    if (passGpuTime > kDenoiseBudget) overBudget++;
+
+    auto now = steady_clock::now();
+    if (now - t0 < 10s) return;
+    ULOGI("GPU denoise time at %dx%d: %u passes, avg %.2f ms, max %.2f ms, %u over %.1f ms",
+          width, height, passes,
+          duration<float, std::milli>(gpuTime).count() / static_cast<float>(passes),
+          duration<float, std::milli>(maxGpuTime).count(),
+          overBudget,
+          duration<float, std::milli>(kDenoiseBudget).count());
+    *this = {};
+    t0 = now;
+}
+
+bool TemporalDenoiser::init(ProgramCache &programCache, GLuint targetVao) {
+    program_ = programCache.getOrCreateProgram("shaders/video_v.glsl", "shaders/denoise_f.glsl");
+    if (program_ == 0) {
+        ULOGE("No denoise program");
+        return false;
+    }
+    glUseProgram(program_);
+    glUniform1i(glGetUniformLocation(program_, "uCurrent"), 0);
+    glUniform1i(glGetUniformLocation(program_, "uHistory"), 1);
+    strengthLocation_ = glGetUniformLocation(program_, "uStrength");
+    glUseProgram(0);
+    targetVao_ = targetVao;
+    history_ = {};
+    hasHistory_ = false;
+    gpuTimer_.init();
+    stats_ = {};
+    return true;
+}
+
+const RenderTarget &TemporalDenoiser::apply(const RenderTarget &source, bool newImage, float strength) {
+    const RenderTarget &previous = history_[current_];
+    bool sameSize = previous.width == source.width && previous.height == source.height;
+    if (!newImage && hasHistory_ && sameSize) return previous;
+
+    TRACE_SECTION("denoise");
+    gpuTimer_.collect([this, &source](uint32_t, nanoseconds gpuTime) {
+        stats_.recordPass(source.width, source.height, gpuTime);
+    });
+    if (!hasHistory_ || !sameSize) {
+        ULOGI("Denoising %dx%d at strength %.2f", source.width, source.height, strength);
+    }
+    // Without a history the frame is blended with itself, which copies it.
+    bool seeded = hasHistory_ && sameSize;
+    current_ ^= 1;
+    RenderTarget &output = history_[current_];
+    output.ensureSize(source.width, source.height);
+
+    gpuTimer_.begin(0);
+    output.bind();
+    glUseProgram(program_);
+    glUniform1f(strengthLocation_, seeded ? strength * kMaxHistoryWeight : 0.0f);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, source.texture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, seeded ? previous.texture : source.texture);
+    glBindVertexArray(targetVao_);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    gpuTimer_.end();
+    hasHistory_ = true;
+    return output;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include "GpuTimer.h"
+#include "RenderTarget.h"
+
+using namespace std::chrono;
+
+class ProgramCache;
+
+struct DenoiserStats {
+    uint32_t passes = 0;
+    // Passes that took longer than kDenoiseBudget
+    uint32_t overBudget = 0;
+    nanoseconds gpuTime{0ns};
+    nanoseconds maxGpuTime{0ns};
+    steady_clock::time_point t0{steady_clock::now()};
+
+    void recordPass(int32_t width, int32_t height, nanoseconds passGpuTime);
+};
+
+/**
+ * Recursive temporal noise filter: every frame is blended with the previous output, weighted by
+ * how much each pixel changed, and the result becomes the history of the next frame. The output
+ * is the frame being shown, so no latency is added.
+ */
+class TemporalDenoiser final {
+public:
+    bool init(ProgramCache &programCache, GLuint targetVao);
+
+    /**
+     * Blends source into the history at the given strength (0 to 1) and returns the result.
+     * When newImage is false the source was already blended in and the last result is returned.
+     */
+    const RenderTarget &apply(const RenderTarget &source, bool newImage, float strength);
+
+    /** Drops the history, for example when the source switches or the filter is turned off. */
+    void reset() { hasHistory_ = false; }
+
+private:
+    GLuint program_{};
+    GLint strengthLocation_{-1};
+    GLuint targetVao_{};
+    // The last result and the one being rendered.
+    std::array<RenderTarget, 2> history_{};
+    size_t current_{0};
+    bool hasHistory_{false};
+    GpuTimer gpuTimer_{};
+    DenoiserStats stats_{};
+};
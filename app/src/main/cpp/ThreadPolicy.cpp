@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ThreadPolicy.h"
+
+#include <android/log.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define ULOGI(...) __android_log_print(ANDROID_LOG_INFO, "ThreadPolicy", __VA_ARGS__)
+
+using namespace std::chrono;
+
+namespace {
+
+enum class Cores {
+    Any,
+    Big,
+    Little,
+};
+
+struct RolePolicy {
+    ThreadRole role;
+    // Empty for threads named by their owner.
+    const char *name;
+    Cores cores;
+    // SCHED_FIFO priority, tried first when non zero; apps usually lack the permission.
+    int fifoPriority;
+    // Used when SCHED_FIFO is not granted; ignored for threads whose owner sets the priority.
+    int nice;
+    bool setPriority;
+};
+
+// Indexed by ThreadRole.
+constexpr RolePolicy kRolePolicies[] = {
+        {ThreadRole::UsbEvents, "uvc-usb-events", Cores::Big, 2, -16, true},
+        {ThreadRole::Capture, "uvc-capture", Cores::Big, 0, -10, true},
+        {ThreadRole::Render, "video-render", Cores::Big, 0, -8, true},
+        {ThreadRole::Audio, "", Cores::Any, 0, 0, false},
+        {ThreadRole::Governor, "quality-governor", Cores::Little, 0, 10, true},
+        {ThreadRole::Motion, "motion-detect", Cores::Little, 0, 15, true},
+        {ThreadRole::Spectrum, "audio-spectrum", Cores::Little, 0, 10, true},
+        {ThreadRole::Thumbnails, "thumbnails", Cores::Little, 0, 15, true},
+        {ThreadRole::Replay, "replay-cache", Cores::Little, 0, 10, true},
+        {ThreadRole::Background, "replay-load", Cores::Any, 0, 0, true},
+};
+
+const char *roleName(ThreadRole role) {
+    switch (role) {
+        case ThreadRole::UsbEvents:
+            return "usb-events";
+        case ThreadRole::Capture:
+            return "capture";
+        case ThreadRole::Render:
+            return "render";
+        case ThreadRole::Audio:
+            return "audio";
+        case ThreadRole::Governor:
+            return "governor";
+        case ThreadRole::Motion:
+            return "motion";
+        case ThreadRole::Spectrum:
+            return "spectrum";
+        case ThreadRole::Thumbnails:
+            return "thumbnails";
+        case ThreadRole::Replay:
+            return "replay";
+        case ThreadRole::Background:
+            return "background";
+    }
+    return "?";
+}
+
+long maxFrequency(int cpu) {
+    char path[96];
+    std::snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+    FILE *file = std::fopen(path, "r");
+    if (file == nullptr) return 0;
+    long frequency = 0;
+    if (std::fscanf(file, "%ld", &frequency) != 1) frequency = 0;
+    std::fclose(file);
+    return frequency;
+}
+
+struct CoreSets {
+    cpu_set_t big;
+    cpu_set_t little;
+    // False on symmetric or unreadable topologies, where nothing is pinned.
+    bool heterogeneous{false};
+};
+
+// Big cores are the ones with the highest maximum frequency, little cores all others.
+const CoreSets &coreSets() {
+    static const CoreSets sets = [] {
+        CoreSets result{};
+        CPU_ZERO(&result.big);
+        CPU_ZERO(&result.little);
+        int count = static_cast<int>(sysconf(_SC_NPROCESSORS_CONF));
+        std::vector<long> frequencies;
+        for (int cpu = 0; cpu < count && cpu < CPU_SETSIZE; cpu++) frequencies.push_back(maxFrequency(cpu));
+        if (frequencies.empty()) return result;
+        auto [lowest, highest] = std::minmax_element(frequencies.begin(), frequencies.end());
+        if (*lowest == *highest || *lowest == 0) return result;
+        for (size_t cpu = 0; cpu < frequencies.size(); cpu++) {
+            CPU_SET(cpu, frequencies[cpu] == *highest ? &result.big : &result.little);
+        }
+        result.heterogeneous = true;
+        ULOGI("%d big of %zu cores", CPU_COUNT(&result.big), frequencies.size());
+        return result;
+    }();
+    return sets;
+}
+
+struct ThreadEntry {
+    pid_t tid;
+    ThreadRole role;
+    clockid_t clock;
+    nanoseconds lastCpuTime;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadEntry> threads;
+    steady_clock::time_point lastReport{steady_clock::now()};
+};
+
+Registry &registry() {
+    static Registry instance;
+    return instance;
+}
+
+nanoseconds cpuTime(clockid_t clock) {
+    timespec ts{};
+    if (clock_gettime(clock, &ts) != 0) return 0ns;
+    return seconds(ts.tv_sec) + nanoseconds(ts.tv_nsec);
+}
+
+// Removes the thread from the registry when it exits, while its CPU clock is still valid.
+struct Registration {
+    pid_t tid{0};
+
+    ~Registration() {
+        if (tid == 0) return;
+        Registry &instance = registry();
+        std::lock_guard<std::mutex> lock(instance.mutex);
+        std::erase_if(instance.threads, [this](const ThreadEntry &entry) { return entry.tid == tid; });
+    }
+};
+
+thread_local Registration registration;
+
+} // namespace
+
+void applyThreadPolicy(ThreadRole role) {
+    if (registration.tid != 0) return;
+    const RolePolicy &policy = kRolePolicies[static_cast<size_t>(role)];
+    pid_t tid = gettid();
+    registration.tid = tid;
+
+    if (policy.name[0] != '\0') prctl(PR_SET_NAME, policy.name);
+
+    const CoreSets &sets = coreSets();
+    bool pinned = false;
+    if (sets.heterogeneous && policy.cores != Cores::Any) {
+        const cpu_set_t &cores = policy.cores == Cores::Big ? sets.big : sets.little;
+        pinned = sched_setaffinity(tid, sizeof(cpu_set_t), &cores) == 0;
+    }
+
+    const char *priority = "unchanged";
+    if (policy.setPriority) {
+        sched_param param{.sched_priority = policy.fifoPriority};
+        if (policy.fifoPriority > 0 && sched_setscheduler(tid, SCHED_FIFO, &param) == 0) {
+            priority = "SCHED_FIFO";
+        } else if (setpriority(PRIO_PROCESS, tid, policy.nice) == 0) {
+            priority = "nice";
+        } else {
+            priority = "denied";
+        }
+    }
+    ULOGI(
+            "Thread %d %s: %s cores, priority %s (nice %d)",
+            tid,
+            roleName(role),
+            pinned ? (policy.cores == Cores::Big ? "big" : "little") : "all",
+            priority,
+            getpriority(PRIO_PROCESS, tid));
+
+    clockid_t clock;
+    if (pthread_getcpuclockid(pthread_self(), &clock) != 0) return;
+    Registry &instance = registry();
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    instance.threads.push_back({tid, role, clock, cpuTime(clock)});
+}
+
+void reportThreadCpuTimes() {
+    Registry &instance = registry();
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    auto now = steady_clock::now();
+    auto elapsed = now - instance.lastReport;
+    if (elapsed < 10s || instance.threads.empty()) return;
+    instance.lastReport = now;
+
+    std::string report;
+    float elapsedMs = duration<float, std::milli>(elapsed).count();
+    for (ThreadEntry &entry: instance.threads) {
+        nanoseconds total = cpuTime(entry.clock);
+        float busyMs = duration<float, std::milli>(total - entry.lastCpuTime).count();
+        entry.lastCpuTime = total;
+        char line[64];
+        std::snprintf(line, sizeof(line), "%s%s/%d %.1f%%", report.empty() ? "" : ", ", roleName(entry.role), entry.tid,
+                      100.0f * busyMs / elapsedMs);
+        report += line;
+    }
+    ULOGI("Thread CPU: %s", report.c_str());
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// Placement and priority of the native pipeline threads. Each thread calls applyThreadPolicy()
+// once for its role; it is idempotent per thread, so callbacks running on threads owned by a
+// library (libuvc, AAudio) can call it on every invocation.
+
+enum class ThreadRole {
+    // libusb event handling for the video interface; iso transfers must be reaped on time.
+    UsbEvents,
+    // libuvc frame callback, which copies or decodes every frame.
+    Capture,
+    Render,
+    // Owned and scheduled by AAudio; only registered for CPU time reporting.
+    Audio,
+    Governor,
+    // Motion detection for unattended monitoring, which may lag.
+    Motion,
+    // Audio spectrum analysis for display, fed by a copy of the USB audio stream.
+    Spectrum,
+    // Thumbnails of the video for the timeline, which may lag.
+    Thumbnails,
+    // Scales and compresses frames into the instant replay cache, which may lag.
+    Replay,
+    // Synthetic load used by the replay benchmark.
+    Background,
+};
+
+void applyThreadPolicy(ThreadRole role);
+
+/** Logs the CPU time of every registered thread over the last 10 s, at most every 10 s. */
+void reportThreadCpuTimes();
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ThumbnailTimeline.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "ThreadPolicy.h"
+
+#define ULOGI(...) __android_log_print(ANDROID_LOG_INFO, "ThumbnailTimeline", __VA_ARGS__)
+
+namespace {
+
+// Scratch of UsbVideoStreamer::scaleFrameToRGBA per thumbnail pixel, at most.
+constexpr size_t kScratchBytesPerPixel = 12;
+
+} // namespace
+
+void ThumbnailStats::recordThumbnail(nanoseconds scale, size_t stored) {
+    thumbnails++;
+    scaleTime += scale;
+    maxScaleTime = std::max(maxScaleTime, scale);
+
+    auto now = steady_clock::now();
+    if (now - t0 < 10s) return;
+    ULOGI("Thumbnails: %u added, scale avg %.2f ms, max %.2f ms, %zu stored",
+          thumbnails,
+          duration<float, std::milli>(scaleTime).count() / static_cast<float>(thumbnails),
+          duration<float, std::milli>(maxScaleTime).count(),
+          stored);
+    *this = {};
+    t0 = now;
+}
+
+ThumbnailTimeline::ThumbnailTimeline(milliseconds interval, size_t memoryCap) : interval_(interval) {
+    constexpr size_t kPixels = static_cast<size_t>(kWidth) * kHeight;
+    constexpr size_t kWorkingBytes = kThumbnailBytes + kPixels * kScratchBytesPerPixel;
+    constexpr size_t kSlotBytes = kThumbnailBytes + sizeof(steady_clock::time_point);
+    size_t granted = grantMemory(memoryCap);
+    if (granted < memoryCap) ULOGI("Memory budget leaves %zu of %zu bytes for thumbnails", granted, memoryCap);
+    capacity_ = granted > kWorkingBytes ? (granted - kWorkingBytes) / kSlotBytes : 0;
+    // Left uninitialized; pages are only committed as the ring first fills them.
+    arena_.reset(new uint8_t[capacity_ * kThumbnailBytes]);
+    times_.resize(capacity_);
+    staging_.resize(kThumbnailBytes);
+    scratch_.reserve(kPixels * kScratchBytesPerPixel);
+    memory_ = TrackedMemory(MemorySubsystem::Thumbnails, capacity_ * kSlotBytes + kWorkingBytes);
+    ULOGI("Thumbnail timeline: %zu thumbnails of %dx%d every %lld ms, %.1f s in %.1f MB",
+          capacity_, kWidth, kHeight, static_cast<long long>(interval_.count()),
+          duration<float>(interval_ * capacity_).count(),
+          static_cast<float>(capacity_ * kSlotBytes + kWorkingBytes) / (1024.0f * 1024.0f));
+    if (capacity_ > 0) thread_ = std::thread(&ThumbnailTimeline::run, this);
+}
+
+ThumbnailTimeline::~ThumbnailTimeline() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopRequested_ = true;
+    }
+    wakeUp_.notify_one();
+    if (thread_.joinable()) thread_.join();
+}
+
+void ThumbnailTimeline::setSource(UsbVideoStreamer *source) {
+    std::lock_guard<std::mutex> sourceLock(sourceMutex_);
+    source_ = source;
+    stamp_ = {};
+}
+
+std::vector<steady_clock::time_point> ThumbnailTimeline::times() {
+    std::lock_guard<std::mutex> lock(arenaMutex_);
+    std::vector<steady_clock::time_point> result(count_);
+    for (size_t i = 0; i < count_; i++) result[i] = times_[(first_ + i) % capacity_];
+    return result;
+}
+
+bool ThumbnailTimeline::copyThumbnail(steady_clock::time_point time, uint8_t *dst, int32_t dstStride) {
+    std::lock_guard<std::mutex> lock(arenaMutex_);
+    if (count_ == 0) return false;
+    // Times only grow around the ring, so the first one past time or the one before is closest.
+    size_t closest = count_ - 1;
+    for (size_t i = 0; i < count_; i++) {
+        if (times_[(first_ + i) % capacity_] < time) continue;
+        closest = i;
+        if (i > 0 && time - times_[(first_ + i - 1) % capacity_] < times_[(first_ + i) % capacity_] - time) {
+            closest = i - 1;
+        }
+        break;
+    }
+    const uint8_t *thumbnail = arena_.get() + ((first_ + closest) % capacity_) * kThumbnailBytes;
+    for (int32_t row = 0; row < kHeight; row++) {
+        std::memcpy(dst + static_cast<size_t>(row) * dstStride, thumbnail + row * kWidth * 4, kWidth * 4);
+    }
+    return true;
+}
+
+void ThumbnailTimeline::run() {
+    applyThreadPolicy(ThreadRole::Thumbnails);
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopRequested_) {
+        wakeUp_.wait_for(lock, interval_);
+        if (stopRequested_) break;
+        lock.unlock();
+
+        nanoseconds scaleTime{0ns};
+        if (addThumbnail(scaleTime)) {
+            std::lock_guard<std::mutex> arenaLock(arenaMutex_);
+            stats_.recordThumbnail(scaleTime, count_);
+        }
+
+        lock.lock();
+    }
+}
+
+bool ThumbnailTimeline::addThumbnail(nanoseconds &scaleTime) {
+    {
+        std::lock_guard<std::mutex> sourceLock(sourceMutex_);
+        if (source_ == nullptr) return false;
+        auto start = steady_clock::now();
+        if (!source_->scaleFrameToRGBA(stamp_, staging_.data(), kWidth * 4, kWidth, kHeight, scratch_)) return false;
+        scaleTime = steady_clock::now() - start;
+    }
+    std::lock_guard<std::mutex> lock(arenaMutex_);
+    size_t slot = (first_ + count_) % capacity_;
+    if (count_ == capacity_) {
+        first_ = (first_ + 1) % capacity_;
+    } else {
+        count_++;
+    }
+    std::memcpy(arena_.get() + slot * kThumbnailBytes, staging_.data(), kThumbnailBytes);
+    times_[slot] = stamp_.captured;
+    return true;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "MemoryBudget.h"
+#include "UsbVideoStreamer.h"
+
+using namespace std::chrono;
+
+struct ThumbnailStats {
+    uint32_t thumbnails = 0;
+    nanoseconds scaleTime{0ns};
+    nanoseconds maxScaleTime{0ns};
+    steady_clock::time_point t0{steady_clock::now()};
+
+    void recordThumbnail(nanoseconds scale, size_t stored);
+};
+
+/**
+ * A rolling timeline of small thumbnails of the video, for scrubbing back through the last
+ * minutes. At a fixed interval the latest frame is scaled down with libyuv on the timeline's own
+ * low priority thread, under the streamer's frame lock but outside the capture callback.
+ *
+ * Thumbnails are kept in one arena that is sized from the memory cap when the timeline is
+ * created. Once it is full each thumbnail replaces the oldest, so memory does not grow with the
+ * length of the session. H.264/HEVC frames only exist on the GPU and are skipped.
+ */
+class ThumbnailTimeline final {
+public:
+    static constexpr int32_t kWidth = 160;
+    static constexpr int32_t kHeight = 90;
+
+    /**
+     * memoryCap bounds the arena together with the working buffers, in bytes; less is taken when
+     * the memory budget has less left.
+     */
+    ThumbnailTimeline(milliseconds interval, size_t memoryCap);
+
+    ~ThumbnailTimeline();
+
+    ThumbnailTimeline(const ThumbnailTimeline &) = delete;
+    ThumbnailTimeline &operator=(const ThumbnailTimeline &) = delete;
+
+    /** Switches the frame source; blocks until a thumbnail of the old one is done. */
+    void setSource(UsbVideoStreamer *source);
+
+    /** Capture times of the stored thumbnails, oldest first. */
+    std::vector<steady_clock::time_point> times();
+
+    /**
+     * Copies the thumbnail captured closest to time into dst, kWidth x kHeight RGBA pixels
+     * (R, G, B, X byte order). Returns false while there is none.
+     */
+    bool copyThumbnail(steady_clock::time_point time, uint8_t *dst, int32_t dstStride);
+
+private:
+    static constexpr size_t kThumbnailBytes = static_cast<size_t>(kWidth) * kHeight * 4;
+
+    void run();
+    // Adds a thumbnail of the latest frame; returns false when there was no new frame.
+    bool addThumbnail(nanoseconds &scaleTime);
+
+    milliseconds interval_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wakeUp_;
+    bool stopRequested_{false};
+
+    // Held while scaling a frame so the source can't be destroyed under the timeline thread.
+    std::mutex sourceMutex_;
+    UsbVideoStreamer *source_{nullptr};
+    FrameStamp stamp_{};
+    std::vector<uint8_t> staging_;
+    std::vector<uint8_t> scratch_;
+
+    // Guards the ring of thumbnails in arena_, which starts at first_ and holds count_ of them.
+    std::mutex arenaMutex_;
+    size_t capacity_{0};
+    std::unique_ptr<uint8_t[]> arena_;
+    std::vector<steady_clock::time_point> times_;
+    TrackedMemory memory_;
+    size_t first_{0};
+    size_t count_{0};
+    ThumbnailStats stats_{};
+};
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+/**
+ * ATrace sections, counters and per frame async slices for Perfetto and systrace. The macros
+ * expand to nothing unless the library is built with USB_VIDEO_TRACING, so release builds pay
+ * nothing for them.
+ *
+ * Async slices share a track per name and are keyed by a cookie, which is how a frame is
+ * followed across threads: a "frame" slice runs from the capture callback until the frame is
+ * uploaded or overwritten, keyed by the UVC frame sequence number.
+ */
+#if USB_VIDEO_TRACING
+
+#include <android/trace.h>
+
+class TraceSection final {
+public:
+    explicit TraceSection(const char *name) { ATrace_beginSection(name); }
+
+    ~TraceSection() { ATrace_endSection(); }
+
+    TraceSection(const TraceSection &) = delete;
+    TraceSection &operator=(const TraceSection &) = delete;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+/** Traces the enclosing scope. */
+#define TRACE_SECTION(name) TraceSection TRACE_CONCAT(traceSection, __LINE__)(name)
+#define TRACE_COUNTER(name, value) ATrace_setCounter(name, static_cast<int64_t>(value))
+#define TRACE_ASYNC_BEGIN(name, cookie) ATrace_beginAsyncSection(name, static_cast<int32_t>(cookie))
+#define TRACE_ASYNC_END(name, cookie) ATrace_endAsyncSection(name, static_cast<int32_t>(cookie))
+
+#else
+
+#define TRACE_SECTION(name) ((void) 0)
+#define TRACE_COUNTER(name, value) ((void) 0)
+#define TRACE_ASYNC_BEGIN(name, cookie) ((void) 0)
+#define TRACE_ASYNC_END(name, cookie) ((void) 0)
+
+#endif
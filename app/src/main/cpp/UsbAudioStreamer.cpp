@@ -23,6 +23,8 @@
 #include <format>
 #include <memory>
 #include "RingBuffer.h"
+#include "ThreadPolicy.h"
+#include "Trace.h"
 #include "aaudio_type_conversion.h"
 
 #define ULOGD(...) __android_log_print(ANDROID_LOG_DEBUG, "UsbAudioStreamer", __VA_ARGS__)
@@ -180,6 +182,9 @@ UsbAudioStreamer::UsbAudioStreamer(
           samplingFrequency_,
           channelCount_,
           framesPerBurst_);
+  if (subFrameSize_ == 2) {
+    spectrum_ = std::make_unique<AudioSpectrum>(samplingFrequency_, channelCount_);
+  }
   int errcode = libusb_set_option(nullptr, LIBUSB_OPTION_NO_DEVICE_DISCOVERY);
   if (errcode != LIBUSB_SUCCESS) {
     ULOGE("libusb setting no discovery option failed %s", libusb_error_name(errcode));
@@ -348,6 +353,7 @@ void UsbAudioStreamer::allocateTransferRequests() {
 
   if (ringBuffer_->capacity() != ring_buffer_capacity) {
     ringBuffer_ = std::make_unique<RingBufferPcm>(ring_buffer_capacity);
+    ringBufferMemory_ = TrackedMemory(MemorySubsystem::AudioRing, ring_buffer_capacity * sizeof(uint16_t));
   }
 
   for (auto i = 0; i < num_transfers; i++) {
@@ -361,7 +367,7 @@ void UsbAudioStreamer::allocateTransferRequests() {
             transfer->status,
             this,
             maxPacketSize_);
-    transfers_.emplace_back(std::make_unique<TransferUserData>(transfer, this, false));
+    transfers_.emplace_back(std::make_unique<TransferUserData>(transfer, this, false, buffer_size));
     TransferUserData* transferUserData = transfers_.back().get();
     libusb_fill_iso_transfer(
             transfer,
@@ -420,6 +426,8 @@ aaudio_data_callback_result_t UsbAudioStreamer::audioPlaybackCallback(
         void* userData,
         void* audioData,
         int32_t numFrames) {
+  applyThreadPolicy(ThreadRole::Audio);
+  TRACE_SECTION("audioPlaybackCallback");
   UsbAudioStreamer* streamer = reinterpret_cast<UsbAudioStreamer*>(userData);
   auto sizeToRead = streamer->channelCount_ * numFrames;
   auto bytesToRead = streamer->bytesInAudioFrames(numFrames);
@@ -432,6 +440,7 @@ aaudio_data_callback_result_t UsbAudioStreamer::audioPlaybackCallback(
   streamer->streamerStats_.player_cb_counter++;
 
   auto available = streamer->ringBuffer_->size();
+  TRACE_COUNTER("audio.ringBufferSamples", available);
 
   if (available < sizeToRead) {
     memset(audioData, 0, bytesToRead);
@@ -470,6 +479,7 @@ bool UsbAudioStreamer::stopAudioPlayer() {
 }
 
 void UsbAudioStreamer::transferCallback(libusb_transfer* transfer) {
+  TRACE_SECTION("transferCallback");
   if (transfer == nullptr) {
     ULOGE("transferCallback transfer is null.");
     return;
@@ -521,6 +531,9 @@ void UsbAudioStreamer::transferCallback(libusb_transfer* transfer) {
     if (result != dataSize) {
       ULOGE("Write error result = %d to write = %d", result, pack->actual_length);
     }
+    if (streamer->spectrum_ != nullptr) {
+      streamer->spectrum_->push(reinterpret_cast<const int16_t*>(data), dataSize);
+    }
 
     len += pack->actual_length;
   }
@@ -528,6 +541,7 @@ void UsbAudioStreamer::transferCallback(libusb_transfer* transfer) {
   /* update stats */
   UsbAudioStreamerStats& stats = streamer->streamerStats_;
 
+  TRACE_COUNTER("audio.transferBytes", len);
   if (len > 0) {
     stats.recordSamples(streamer->samplesFromByteCount(len));
   }
@@ -29,6 +29,8 @@
 #include <iterator>
 #include <mutex>
 
+#include "AudioSpectrum.h"
+#include "MemoryBudget.h"
 #include "RingBuffer.h"
 
 using namespace std::chrono;
@@ -70,14 +72,17 @@ class UsbAudioStreamer;
 
 struct TransferUserData {
 
-  TransferUserData(libusb_transfer* transfer_, UsbAudioStreamer* streamer_, bool isSubmitted_):
+  TransferUserData(libusb_transfer* transfer_, UsbAudioStreamer* streamer_, bool isSubmitted_, size_t bufferSize):
   transfer(transfer_),
   streamer(streamer_),
-  isSubmitted(isSubmitted_) {
+  isSubmitted(isSubmitted_),
+  bufferMemory(MemorySubsystem::UsbTransfers, bufferSize) {
   }
   libusb_transfer* transfer;
   UsbAudioStreamer* streamer;
   bool isSubmitted;
+  // The buffer is freed together with the transfer.
+  TrackedMemory bufferMemory;
 
   ~TransferUserData() {
 
@@ -143,6 +148,11 @@ class UsbAudioStreamer final {
   std::string statsSummaryString() const;
   bool ensureTransferRequests();
 
+  // Null unless the stream carries 16-bit samples.
+  AudioSpectrum* spectrum() {
+    return spectrum_.get();
+  }
+
  private:
   libusb_context* context_;
   libusb_device_handle* deviceHandle_{};
@@ -161,6 +171,9 @@ class UsbAudioStreamer final {
   const struct libusb_init_option libusbOptions = {.option = LIBUSB_OPTION_NO_DEVICE_DISCOVERY};
   timeval libusbEventsTimeout_{0, 100}; // 100 microseconds
   std::unique_ptr<RingBufferPcm> ringBuffer_{std::make_unique<RingBufferPcm>(3072)};
+  TrackedMemory ringBufferMemory_{MemorySubsystem::AudioRing, 3072 * sizeof(uint16_t)};
+  // Fed from transferCallback next to ringBuffer_, without sharing it with the AAudio callback.
+  std::unique_ptr<AudioSpectrum> spectrum_;
   std::atomic<StreamerState> state_{StreamerState::INITIAL};
   std::mutex mutex_;
   std::condition_variable stateChange_;
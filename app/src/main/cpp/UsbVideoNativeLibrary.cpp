@@ -14,22 +14,103 @@
  * limitations under the License.
  */
 
+#include <android/asset_manager_jni.h>
+#include <android/bitmap.h>
 #include <android/native_window.h>
 #include <android/native_window_jni.h>
 #include <jni.h>
+#include <algorithm>
+#include <array>
+#include <format>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
+#include "BitstreamReplay.h"
+#include "MemoryBudget.h"
+#include "MotionDetector.h"
+#include "QualityGovernor.h"
+#include "ReplayCache.h"
+#include "ThumbnailTimeline.h"
 #include "UsbAudioStreamer.h"
 #include "UsbVideoStreamer.h"
+#include "VideoPresenter.h"
 #include "clog.h"
 
 static std::unique_ptr<UsbAudioStreamer> streamer_{};
 static std::unique_ptr<UsbVideoStreamer> uvcStreamer_{};
+static std::unique_ptr<VideoPresenter> presenter_{};
+static std::unique_ptr<QualityGovernor> governor_{};
+static std::unique_ptr<MotionDetector> motionDetector_{};
+static std::unique_ptr<ThumbnailTimeline> thumbnailTimeline_{};
+static std::unique_ptr<ReplayCache> replayCache_{};
+static jobject assetManagerRef_{};
+static jobject motionListenerRef_{};
+// Guards probeListenerRef_, which the render thread calls.
+static std::mutex probeListenerMutex_;
+static jobject probeListenerRef_{};
+static jmethodID onProbe_{};
+static JavaVM *javaVm_{};
+static bool skipWhileSignalDown_{false};
+static bool audioSpectrumEnabled_{false};
+
+namespace {
+
+// Attaches native threads that call into Java once, and detaches them when they exit.
+struct JvmAttachment {
+    JNIEnv *env{};
+
+    ~JvmAttachment() {
+        if (env != nullptr) javaVm_->DetachCurrentThread();
+    }
+};
+
+JNIEnv *attachCurrentThread() {
+    thread_local JvmAttachment attachment;
+    if (attachment.env == nullptr && javaVm_->AttachCurrentThread(&attachment.env, nullptr) != JNI_OK) {
+        attachment.env = nullptr;
+    }
+    return attachment.env;
+}
+
+PresenterMode presenterModeFromJava(jint mode) {
+    return mode == static_cast<jint>(PresenterMode::CPU_BLIT) ? PresenterMode::CPU_BLIT : PresenterMode::GL;
+}
+
+void deliverProbeResult(const ProbeResult &result) {
+    std::lock_guard<std::mutex> lock(probeListenerMutex_);
+    if (probeListenerRef_ == nullptr) return;
+    JNIEnv *env = attachCurrentThread();
+    if (env == nullptr) return;
+    jint region[] = {result.x, result.y, result.width, result.height};
+    jintArray regionArray = env->NewIntArray(4);
+    env->SetIntArrayRegion(regionArray, 0, 4, region);
+    jfloatArray rgb = env->NewFloatArray(3);
+    env->SetFloatArrayRegion(rgb, 0, 3, result.rgb.data());
+    jfloatArray yuv = nullptr;
+    if (result.yuv.has_value()) {
+        yuv = env->NewFloatArray(3);
+        env->SetFloatArrayRegion(yuv, 0, 3, result.yuv->data());
+    }
+    env->CallVoidMethod(
+            probeListenerRef_, onProbe_, result.id, static_cast<jlong>(result.frameSequence), regionArray, rgb, yuv);
+    if (env->ExceptionCheck()) {
+        CLOGE("Probe listener threw");
+        env->ExceptionClear();
+    }
+    env->DeleteLocalRef(regionArray);
+    env->DeleteLocalRef(rgb);
+    if (yuv != nullptr) env->DeleteLocalRef(yuv);
+}
+
+} // namespace
 
 extern "C" {
 
 JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *jvm, void *reserved) {
+    javaVm_ = jvm;
+    governor_ = std::make_unique<QualityGovernor>();
     return JNI_VERSION_1_6;
 }
 
@@ -49,11 +130,21 @@ Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_connectUsbVideoStre
         jint width,
         jint height,
         jint fps,
-        jint libuvcFrameFormat) {
+        jint libuvcFrameFormat,
+        jstring fourccFormat) {
     if (uvcStreamer_ == nullptr) {
+        const char *fourcc = env->GetStringUTFChars(fourccFormat, nullptr);
         uvcStreamer_ = std::make_unique<UsbVideoStreamer>(
-                (intptr_t) deviceFd, width, height, fps, static_cast<uvc_frame_format>(libuvcFrameFormat));
-        return uvcStreamer_->configureOutput();
+                (intptr_t) deviceFd, width, height, fps, static_cast<uvc_frame_format>(libuvcFrameFormat), fourcc);
+        env->ReleaseStringUTFChars(fourccFormat, fourcc);
+        uvcStreamer_->setSkipWhileSignalDown(skipWhileSignalDown_);
+        if (presenter_) presenter_->setSource(uvcStreamer_.get());
+        if (!uvcStreamer_->configureOutput()) return false;
+        governor_->setSource(uvcStreamer_.get());
+        if (motionDetector_) motionDetector_->setSource(uvcStreamer_.get());
+        if (thumbnailTimeline_) thumbnailTimeline_->setSource(uvcStreamer_.get());
+        if (replayCache_) replayCache_->setSource(uvcStreamer_.get());
+        return true;
     }
     return false;
 }
@@ -79,6 +170,11 @@ JNIEXPORT void JNICALL Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibr
 JNIEXPORT void JNICALL Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_disconnectUsbVideoStreamingNative(
         JNIEnv *env,
         jobject self) {
+    if (presenter_) presenter_->setSource(nullptr);
+    governor_->setSource(nullptr);
+    if (motionDetector_) motionDetector_->setSource(nullptr);
+    if (thumbnailTimeline_) thumbnailTimeline_->setSource(nullptr);
+    if (replayCache_) replayCache_->setSource(nullptr);
     uvcStreamer_ = nullptr;
 }
 
@@ -88,25 +184,409 @@ JNIEXPORT jstring JNICALL Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeL
     std::string result = "";
     if (uvcStreamer_ != nullptr) {
         result = uvcStreamer_->statsSummaryString();
+        std::string quality = governor_->summaryString();
+        if (!quality.empty()) result += ", " + quality;
+        result += std::format(
+                ", native {:.1f} MB", static_cast<float>(totalMemoryUsage().current) / (1024.0f * 1024.0f));
     }
     return env->NewStringUTF(result.c_str());
 }
 
 
+JNIEXPORT jint JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_getSignalStateNative(
+        JNIEnv *env,
+        jobject self) {
+    if (uvcStreamer_ != nullptr) {
+        return static_cast<jint>(uvcStreamer_->signalState());
+    }
+    return static_cast<jint>(SignalState::LIVE);
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_setSkipWhileSignalDownNative(
+        JNIEnv *env,
+        jobject self,
+        jboolean skip) {
+    skipWhileSignalDown_ = skip;
+    if (uvcStreamer_ != nullptr) {
+        uvcStreamer_->setSkipWhileSignalDown(skip);
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_attachSurfaceNative(
+        JNIEnv *env,
+        jobject self,
+        jobject surface,
+        jobject assetManager,
+        jstring programCacheDir,
+        jint mode) {
+    presenter_ = nullptr;
+    ANativeWindow *window = ANativeWindow_fromSurface(env, surface);
+    if (window == nullptr) return;
+
+    // AAssetManager is only valid while its Java object is reachable.
+    if (assetManagerRef_ == nullptr) assetManagerRef_ = env->NewGlobalRef(assetManager);
+    const char *cacheDir = env->GetStringUTFChars(programCacheDir, nullptr);
+    presenter_ = std::make_unique<VideoPresenter>(window, AAssetManager_fromJava(env, assetManagerRef_), cacheDir);
+    env->ReleaseStringUTFChars(programCacheDir, cacheDir);
+    ANativeWindow_release(window);
+
+    presenter_->setSource(uvcStreamer_.get());
+    presenter_->setProbeListener(deliverProbeResult);
+    presenter_->setReplaySource(replayCache_.get());
+    // Set before the render thread starts, so a CPU blit presenter never brings up EGL.
+    presenter_->setMode(presenterModeFromJava(mode));
+    presenter_->start();
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_surfaceChangedNative(
+        JNIEnv *env,
+        jobject self) {
+    if (presenter_) {
+        presenter_->onSurfaceChanged();
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_detachSurfaceNative(
+        JNIEnv *env,
+        jobject self) {
+    presenter_ = nullptr;
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_setZebraVisibleNative(
+        JNIEnv *env,
+        jobject self,
+        jboolean visible) {
+    if (presenter_) {
+        presenter_->setShowZebra(visible);
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_setHdrModeNative(
+        JNIEnv *env,
+        jobject self,
+        jint transfer,
+        jboolean toneMap) {
+    if (presenter_ && transfer >= 0 && transfer <= static_cast<jint>(HdrTransfer::HLG)) {
+        presenter_->setHdrMode(static_cast<HdrTransfer>(transfer), toneMap);
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_setDeinterlaceModeNative(
+        JNIEnv *env,
+        jobject self,
+        jint mode) {
+    if (presenter_ && mode >= 0 && mode <= static_cast<jint>(DeinterlaceMode::MOTION_ADAPTIVE)) {
+        presenter_->setDeinterlaceMode(static_cast<DeinterlaceMode>(mode));
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_setScalerNative(
+        JNIEnv *env,
+        jobject self,
+        jint filter,
+        jfloat sharpness) {
+    if (presenter_ && filter >= 0 && filter <= static_cast<jint>(ScaleFilter::LANCZOS)) {
+        presenter_->setScaler(static_cast<ScaleFilter>(filter), std::clamp(sharpness, 0.0f, 1.0f));
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_setDenoiseNative(
+        JNIEnv *env,
+        jobject self,
+        jfloat strength) {
+    if (presenter_) {
+        presenter_->setDenoise(std::clamp(strength, 0.0f, 1.0f));
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_setFrameMarkerVisibleNative(
+        JNIEnv *env,
+        jobject self,
+        jboolean visible) {
+    if (presenter_) {
+        presenter_->setFrameMarker(visible);
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_setVectorscopeVisibleNative(
+        JNIEnv *env,
+        jobject self,
+        jboolean visible) {
+    if (presenter_) {
+        presenter_->setVectorscope(visible);
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_setDisplayRefreshRatesNative(
+        JNIEnv *env,
+        jobject self,
+        jfloatArray rates) {
+    if (presenter_) {
+        std::vector<float> refreshRates(env->GetArrayLength(rates));
+        env->GetFloatArrayRegion(rates, 0, static_cast<jsize>(refreshRates.size()), refreshRates.data());
+        presenter_->setDisplayRefreshRates(std::move(refreshRates));
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_setMotionListenerNative(
+        JNIEnv *env,
+        jobject self,
+        jobject listener) {
+    // Joins the detector thread before the listener it calls is released.
+    motionDetector_ = nullptr;
+    if (motionListenerRef_ != nullptr) {
+        env->DeleteGlobalRef(motionListenerRef_);
+        motionListenerRef_ = nullptr;
+    }
+    if (listener == nullptr) return;
+
+    motionListenerRef_ = env->NewGlobalRef(listener);
+    jmethodID onMotion = env->GetMethodID(env->GetObjectClass(listener), "onMotion", "([FF)V");
+    motionDetector_ = std::make_unique<MotionDetector>(
+            [onMotion](const std::vector<MotionRegion> &regions, float activity) {
+                JNIEnv *threadEnv = attachCurrentThread();
+                if (threadEnv == nullptr) return;
+                static_assert(sizeof(MotionRegion) == 4 * sizeof(jfloat));
+                auto length = static_cast<jint>(regions.size() * 4);
+                jfloatArray boxes = threadEnv->NewFloatArray(length);
+                threadEnv->SetFloatArrayRegion(boxes, 0, length, reinterpret_cast<const jfloat *>(regions.data()));
+                threadEnv->CallVoidMethod(motionListenerRef_, onMotion, boxes, activity);
+                if (threadEnv->ExceptionCheck()) {
+                    CLOGE("Motion listener threw");
+                    threadEnv->ExceptionClear();
+                }
+                threadEnv->DeleteLocalRef(boxes);
+            });
+    motionDetector_->setSource(uvcStreamer_.get());
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_setThumbnailTimelineNative(
+        JNIEnv *env,
+        jobject self,
+        jint intervalMillis,
+        jlong memoryCapBytes) {
+    // Joins the timeline thread and frees the arena before a new one is allocated.
+    thumbnailTimeline_ = nullptr;
+    if (intervalMillis <= 0 || memoryCapBytes <= 0) return;
+    thumbnailTimeline_ = std::make_unique<ThumbnailTimeline>(
+            std::chrono::milliseconds(intervalMillis), static_cast<size_t>(memoryCapBytes));
+    thumbnailTimeline_->setSource(uvcStreamer_.get());
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_getThumbnailTimesNative(
+        JNIEnv *env,
+        jobject self) {
+    std::vector<jlong> millis;
+    if (thumbnailTimeline_) {
+        for (auto time : thumbnailTimeline_->times()) {
+            millis.push_back(duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count());
+        }
+    }
+    jlongArray result = env->NewLongArray(static_cast<jsize>(millis.size()));
+    env->SetLongArrayRegion(result, 0, static_cast<jsize>(millis.size()), millis.data());
+    return result;
+}
+
 JNIEXPORT jboolean JNICALL
-Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_updateTextures(JNIEnv *env, jobject self, jint texY, jint texUV) {
-    if (uvcStreamer_) {
-        return uvcStreamer_->bindFrameToTextures(texY, texUV);
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_getThumbnailNative(
+        JNIEnv *env,
+        jobject self,
+        jlong timeMillis,
+        jobject bitmap) {
+    if (!thumbnailTimeline_) return false;
+    AndroidBitmapInfo info{};
+    if (AndroidBitmap_getInfo(env, bitmap, &info) != ANDROID_BITMAP_RESULT_SUCCESS ||
+        info.format != ANDROID_BITMAP_FORMAT_RGBA_8888 ||
+        info.width != ThumbnailTimeline::kWidth || info.height != ThumbnailTimeline::kHeight) {
+        CLOGE("Thumbnails need a %dx%d RGBA_8888 bitmap", ThumbnailTimeline::kWidth, ThumbnailTimeline::kHeight);
+        return false;
+    }
+    void *pixels = nullptr;
+    if (AndroidBitmap_lockPixels(env, bitmap, &pixels) != ANDROID_BITMAP_RESULT_SUCCESS) return false;
+    // steady_clock is CLOCK_MONOTONIC, the clock of SystemClock.uptimeMillis().
+    bool copied = thumbnailTimeline_->copyThumbnail(
+            steady_clock::time_point(std::chrono::milliseconds(timeMillis)), static_cast<uint8_t *>(pixels),
+            static_cast<int32_t>(info.stride));
+    AndroidBitmap_unlockPixels(env, bitmap);
+    return copied;
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_setPixelProbeListenerNative(
+        JNIEnv *env,
+        jobject self,
+        jobject listener) {
+    std::lock_guard<std::mutex> lock(probeListenerMutex_);
+    if (probeListenerRef_ != nullptr) {
+        env->DeleteGlobalRef(probeListenerRef_);
+        probeListenerRef_ = nullptr;
+    }
+    if (listener == nullptr) return;
+    probeListenerRef_ = env->NewGlobalRef(listener);
+    onProbe_ = env->GetMethodID(env->GetObjectClass(listener), "onProbe", "(IJ[I[F[F)V");
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_requestPixelProbeNative(
+        JNIEnv *env,
+        jobject self,
+        jint id,
+        jfloat left,
+        jfloat top,
+        jfloat right,
+        jfloat bottom) {
+    if (presenter_) {
+        presenter_->requestProbe({id, left, top, right, bottom});
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_setReplayCacheNative(
+        JNIEnv *env,
+        jobject self,
+        jint durationMillis,
+        jlong memoryCapBytes,
+        jboolean compress) {
+    // The presenter lets go of the cache, which joins its thread and frees the arena, before a
+    // new one is allocated.
+    if (presenter_) {
+        presenter_->stopReplay();
+        presenter_->setReplaySource(nullptr);
+    }
+    replayCache_ = nullptr;
+    if (durationMillis <= 0 || memoryCapBytes <= 0) return;
+    replayCache_ = std::make_unique<ReplayCache>(
+            std::chrono::milliseconds(durationMillis), static_cast<size_t>(memoryCapBytes), compress);
+    replayCache_->setSource(uvcStreamer_.get());
+    if (presenter_) presenter_->setReplaySource(replayCache_.get());
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_startReplayNative(
+        JNIEnv *env,
+        jobject self,
+        jint backMillis,
+        jfloat speed) {
+    if (presenter_) {
+        presenter_->startReplay(std::chrono::milliseconds(std::max(backMillis, 0)), speed);
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_setReplaySpeedNative(
+        JNIEnv *env,
+        jobject self,
+        jfloat speed) {
+    if (presenter_) {
+        presenter_->setReplaySpeed(speed);
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_stopReplayNative(
+        JNIEnv *env,
+        jobject self) {
+    if (presenter_) {
+        presenter_->stopReplay();
+    }
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_isReplayingNative(
+        JNIEnv *env,
+        jobject self) {
+    return presenter_ && presenter_->replaying();
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_setMemoryBudgetNative(
+        JNIEnv *env,
+        jobject self,
+        jlong bytes) {
+    setMemoryBudget(static_cast<size_t>(std::max<jlong>(bytes, 0)));
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_getMemoryUsageNative(
+        JNIEnv *env,
+        jobject self) {
+    // Current and peak bytes of each subsystem, followed by those of the total.
+    std::vector<jlong> usage;
+    for (int32_t i = 0; i <= static_cast<int32_t>(MemorySubsystem::COUNT); i++) {
+        auto subsystem = static_cast<MemorySubsystem>(i);
+        MemoryUsage bytes = subsystem == MemorySubsystem::COUNT ? totalMemoryUsage() : memoryUsage(subsystem);
+        usage.push_back(static_cast<jlong>(bytes.current));
+        usage.push_back(static_cast<jlong>(bytes.peak));
+    }
+    jlongArray result = env->NewLongArray(static_cast<jsize>(usage.size()));
+    env->SetLongArrayRegion(result, 0, static_cast<jsize>(usage.size()), usage.data());
+    return result;
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_setPresenterModeNative(
+        JNIEnv *env,
+        jobject self,
+        jint mode) {
+    if (presenter_) {
+        presenter_->setMode(presenterModeFromJava(mode));
     }
-    return false;
 }
 
 JNIEXPORT jint JNICALL
-Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_getVideoFormat(JNIEnv *env, jobject self) {
-    if (uvcStreamer_) {
-        return uvcStreamer_->getFormat();
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_getPresenterModeNative(
+        JNIEnv *env,
+        jobject self) {
+    if (presenter_) {
+        return static_cast<jint>(presenter_->mode());
     }
-    return 0;
+    return -1;
+}
+
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_setBatteryStateNative(
+        JNIEnv *env,
+        jobject self,
+        jint levelPercent,
+        jboolean charging,
+        jboolean powerSave) {
+    governor_->setBatteryState(levelPercent, charging, powerSave);
+}
+
+JNIEXPORT jstring JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_replayVideoBitstreamNative(
+        JNIEnv *env,
+        jobject self,
+        jstring path,
+        jboolean hevc,
+        jint width,
+        jint height,
+        jint fps,
+        jboolean useMediaCodec,
+        jint backgroundLoadThreads) {
+    const char *pathChars = env->GetStringUTFChars(path, nullptr);
+    BitstreamReplay replay{
+            hevc ? VideoCodec::HEVC : VideoCodec::H264, width, height, fps, useMediaCodec == JNI_TRUE,
+            backgroundLoadThreads};
+    std::string result = replay.run(pathChars);
+    env->ReleaseStringUTFChars(path, pathChars);
+    return env->NewStringUTF(result.c_str());
 }
 
 JNIEXPORT jboolean JNICALL
@@ -129,6 +609,7 @@ Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_connectUsbAudioStre
             channelCount,
             jAudioPerfMode,
             outputFramesPerBuffer);
+    if (audioSpectrumEnabled_ && streamer_->spectrum() != nullptr) streamer_->spectrum()->setEnabled(true);
     return streamer_ != nullptr;
 }
 
@@ -150,4 +631,28 @@ JNIEXPORT void JNICALL Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibr
     if (streamer_ != nullptr) streamer_->stop();
 }
 
+JNIEXPORT void JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_setAudioSpectrumEnabledNative(
+        JNIEnv *env,
+        jobject self,
+        jboolean enabled) {
+    audioSpectrumEnabled_ = enabled == JNI_TRUE;
+    if (streamer_ != nullptr && streamer_->spectrum() != nullptr) {
+        streamer_->spectrum()->setEnabled(audioSpectrumEnabled_);
+    }
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_nano71_cameramonitor_core_usb_UsbVideoNativeLibrary_getAudioSpectrumNative(
+        JNIEnv *env,
+        jobject self,
+        jfloatArray bands) {
+    if (streamer_ == nullptr || streamer_->spectrum() == nullptr) return JNI_FALSE;
+    std::array<float, AudioSpectrum::kBands> levels{};
+    if (!streamer_->spectrum()->readBands(levels.data(), levels.size())) return JNI_FALSE;
+    auto length = std::min<jsize>(env->GetArrayLength(bands), static_cast<jsize>(levels.size()));
+    env->SetFloatArrayRegion(bands, 0, length, levels.data());
+    return JNI_TRUE;
+}
+
 } // extern "C"
@@ -23,39 +23,226 @@
 #include <jni.h>
 #include <libusb.h>
 #include <libuvc/libuvc.h>
+// For uvc_streaming_interface, the parent of a format descriptor
+#include <libuvc/libuvc_internal.h>
 #include <libyuv.h>
 #include <libyuv/convert_argb.h>
 #include <libyuv/convert_from_argb.h>
 #include <libyuv/planar_functions.h>
 
+#include <algorithm>
 #include <chrono>
 #include <format>
 #include <memory.h>
 #include <sys/prctl.h>
 #include <unistd.h>
 #include <cstring>
+#include <utility>
+
+#include "Crc32c.h"
+#include "ThreadPolicy.h"
+#include "Trace.h"
 
 #define ULOGD(...) __android_log_print(ANDROID_LOG_DEBUG, "UsbVideoStreamer", __VA_ARGS__)
 #define ULOGI(...) __android_log_print(ANDROID_LOG_INFO, "UsbVideoStreamer", __VA_ARGS__)
 #define ULOGW(...) __android_log_print(ANDROID_LOG_WARN, "UsbVideoStreamer", __VA_ARGS__)
 #define ULOGE(...) __android_log_print(ANDROID_LOG_ERROR, "UsbVideoStreamer", __VA_ARGS__)
 
+namespace {
+
+// bmInterlaceFlags of the UVC format descriptors
+constexpr uint8_t kInterlacedStream = 0x01;
+constexpr uint8_t kOneFieldPerFrame = 0x02;
+constexpr uint8_t kField1First = 0x04;
+
+// Frames between two checks for combing; a check samples 1/8 of the luma.
+constexpr uint32_t kCombCheckInterval = 30;
+
+// Above this fraction of changed tiles, one upload of the whole frame is cheaper than many small
+// ones.
+constexpr float kMaxTileUploadFraction = 0.5f;
+
+void setTextureFilter(GLint filter) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+}
+
+// Uploads the runs of dirty tiles of a packed plane of texelWidth x texelHeight texels into the
+// bound texture, in which a tile covers tileTexels x tileRows texels. Returns the bytes uploaded.
+uint64_t uploadDirtyTiles(
+        const DirtyTiles &tiles, const uint8_t *data, int32_t texelWidth, int32_t texelHeight,
+        int32_t bytesPerTexel, int32_t tileTexels, int32_t tileRows, GLenum format) {
+    uint64_t bytes = 0;
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, texelWidth);
+    tiles.forEachRun([&](int32_t column, int32_t row, int32_t length) {
+        int32_t x = column * tileTexels;
+        int32_t y = row * tileRows;
+        if (x >= texelWidth || y >= texelHeight) return;
+        int32_t width = std::min(length * tileTexels, texelWidth - x);
+        int32_t height = std::min(tileRows, texelHeight - y);
+        glTexSubImage2D(
+                GL_TEXTURE_2D, 0, x, y, width, height, format, GL_UNSIGNED_BYTE,
+                data + (static_cast<size_t>(y) * texelWidth + x) * bytesPerTexel);
+        bytes += static_cast<uint64_t>(width) * height * bytesPerTexel;
+    });
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    return bytes;
+}
+
+VideoPixelFormat pixelFormatFor(uvc_frame_format uvcFrameFormat, const std::string &fourcc) {
+    switch (uvcFrameFormat) {
+        case UVC_FRAME_FORMAT_NV12:
+            return VideoPixelFormat::NV12;
+        case UVC_FRAME_FORMAT_YUYV:
+            return VideoPixelFormat::YUYV;
+        case UVC_FRAME_FORMAT_P010:
+            return VideoPixelFormat::P010;
+        case UVC_FRAME_FORMAT_UYVY:
+            return VideoPixelFormat::UYVY;
+        case UVC_FRAME_FORMAT_BGR:
+            return VideoPixelFormat::BGR24;
+        case UVC_FRAME_FORMAT_GRAY8:
+            return VideoPixelFormat::GRAY8;
+        case UVC_FRAME_FORMAT_GRAY16:
+            return VideoPixelFormat::Y16;
+        case UVC_FRAME_FORMAT_H264:
+            return VideoPixelFormat::H264;
+        default:
+            break;
+    }
+    if (fourcc == "I420") return VideoPixelFormat::I420;
+    if (fourcc == "YV12") return VideoPixelFormat::YV12;
+    if (fourcc == "RGB3") return VideoPixelFormat::RGB24;
+    if (fourcc == "HEVC" || fourcc == "H265") return VideoPixelFormat::HEVC;
+    return VideoPixelFormat::RGBA;
+}
+
+// Size of one frame as it arrives from the device, or 0 when it is not stored as is.
+size_t payloadSize(VideoPixelFormat format, int32_t width, int32_t height) {
+    size_t pixels = static_cast<size_t>(width) * height;
+    switch (format) {
+        case VideoPixelFormat::I420:
+        case VideoPixelFormat::YV12:
+            return pixels * 3 / 2;
+        case VideoPixelFormat::GRAY8:
+            return pixels;
+        case VideoPixelFormat::YUYV:
+        case VideoPixelFormat::UYVY:
+        case VideoPixelFormat::Y16:
+            return pixels * 2;
+        case VideoPixelFormat::RGB24:
+        case VideoPixelFormat::BGR24:
+            return pixels * 3;
+        default:
+            return 0;
+    }
+}
+
+// Mean of the samples of a region of a plane, whose pixels are pixelStride bytes apart.
+template <typename Sample>
+float planeMean(const uint8_t *plane, size_t rowStride, size_t pixelStride, int32_t x, int32_t y, int32_t width,
+                int32_t height) {
+    uint64_t sum = 0;
+    for (int32_t row = y; row < y + height; row++) {
+        const uint8_t *samples = plane + row * rowStride + x * pixelStride;
+        for (int32_t i = 0; i < width; i++) {
+            Sample sample;
+            std::memcpy(&sample, samples + i * pixelStride, sizeof(sample));
+            sum += sample;
+        }
+    }
+    return static_cast<float>(sum) / static_cast<float>(static_cast<int64_t>(width) * height);
+}
+
+// Source index of the centre of destination index i of count, when size is scaled to count.
+int32_t nearestSample(int32_t i, int32_t count, int32_t size) {
+    return static_cast<int32_t>((2 * static_cast<int64_t>(i) + 1) * size / (2 * count));
+}
+
+} // namespace
+
+const char *videoPixelFormatName(VideoPixelFormat format) {
+    switch (format) {
+        case VideoPixelFormat::RGBA:
+            return "RGBA";
+        case VideoPixelFormat::NV12:
+            return "NV12";
+        case VideoPixelFormat::YUYV:
+            return "YUYV";
+        case VideoPixelFormat::P010:
+            return "P010";
+        case VideoPixelFormat::UYVY:
+            return "UYVY";
+        case VideoPixelFormat::I420:
+            return "I420";
+        case VideoPixelFormat::YV12:
+            return "YV12";
+        case VideoPixelFormat::RGB24:
+            return "RGB24";
+        case VideoPixelFormat::BGR24:
+            return "BGR24";
+        case VideoPixelFormat::GRAY8:
+            return "GRAY8";
+        case VideoPixelFormat::Y16:
+            return "Y16";
+        case VideoPixelFormat::H264:
+            return "H264";
+        case VideoPixelFormat::HEVC:
+            return "HEVC";
+        default:
+            return "?";
+    }
+}
+
+void TextureUploadStats::recordUpload(
+        const char *format, uint64_t uploadBytes, uint64_t frameSize, bool tiled, nanoseconds uploadTime) {
+    uploads++;
+    if (tiled) tileUploads++;
+    bytes += uploadBytes;
+    frameBytes += frameSize;
+    uploadTime_ += uploadTime;
+
+    auto now = high_resolution_clock::now();
+    if (now - t0 < 10s) return;
+    float uploadMs = duration<float, std::milli>(uploadTime_).count();
+    ULOGI(
+            "Texture upload (%s): %u frames, %u by tiles, avg %.3f ms, %.1f MB/s, %.0f%% of frame bytes",
+            format,
+            uploads,
+            tileUploads,
+            uploadMs / uploads,
+            uploadMs > 0.0f ? static_cast<float>(bytes) / 1000.0f / uploadMs : 0.0f,
+            frameBytes > 0 ? 100.0f * static_cast<float>(bytes) / static_cast<float>(frameBytes) : 0.0f);
+    *this = {};
+    t0 = now;
+}
+
 UsbVideoStreamer::UsbVideoStreamer(
         intptr_t deviceFD,
         int32_t width,
         int32_t height,
         int32_t fps,
-        uvc_frame_format uvcFrameFormat) :
+        uvc_frame_format uvcFrameFormat,
+        std::string fourcc) :
         deviceFD_(deviceFD),
         width_(width),
         height_(height),
         fps_(fps),
-        uvcFrameFormat_(uvcFrameFormat) {
+        uvcFrameFormat_(uvcFrameFormat),
+        fourcc_(std::move(fourcc)),
+        pixelFormat_(pixelFormatFor(uvcFrameFormat, fourcc_)) {
     if (libusb_set_option(nullptr, LIBUSB_OPTION_WEAK_AUTHORITY) != LIBUSB_SUCCESS) {
         ULOGE("libusb setting no discovery option failed");
     }
 
-    uvc_error_t res = uvc_init(&uvcContext_, nullptr);
+    if (libusb_init(&usbContext_) != LIBUSB_SUCCESS) {
+        ULOGE("libusb_init failed");
+        usbContext_ = nullptr;
+        return;
+    }
+    usbEventThread_ = std::thread(&UsbVideoStreamer::handleUsbEvents, this);
+
+    uvc_error_t res = uvc_init(&uvcContext_, usbContext_);
     if (res != UVC_SUCCESS) {
         ULOGE("uvc_init failed %s", uvc_strerror(res));
         return;
@@ -67,146 +254,949 @@ UsbVideoStreamer::UsbVideoStreamer(
         return;
     }
 
-    res = uvc_get_stream_ctrl_format_size(
-            deviceHandle_,
-            &streamCtrl_,
-            uvcFrameFormat_,
-            width,
-            height,
-            fps);
+    negotiate();
+}
+
+void UsbVideoStreamer::negotiate() {
+    int32_t width = width_;
+    int32_t height = height_;
+    int32_t fps = fps_;
+    uvc_error_t res;
+    if (uvcFrameFormat_ == UVC_FRAME_FORMAT_ANY) {
+        res = negotiateByFourcc(width, height, fps);
+    } else {
+        res = uvc_get_stream_ctrl_format_size(
+                deviceHandle_,
+                &streamCtrl_,
+                uvcFrameFormat_,
+                width,
+                height,
+                fps);
+    }
     if (res == UVC_SUCCESS) {
         captureFrameWidth_ = width;
         captureFrameHeight_ = height;
         captureFrameFps_ = fps;
         captureFrameFormat_ = uvcFrameFormat_;
         isStreamControlNegotiated_ = true;
+        nominalFrameInterval_ = fps > 0 ? duration_cast<nanoseconds>(1s).count() / fps : 0;
+        negotiations_++;
+        interlaceFlags_ = 0;
+        for (const uvc_format_desc_t *format = uvc_get_format_descs(deviceHandle_); format != nullptr; format = format->next) {
+            if (format->bFormatIndex == streamCtrl_.bFormatIndex) interlaceFlags_ = format->bmInterlaceFlags;
+        }
+        combDetector_.reset();
+        framesSinceCombCheck_ = 0;
+        signalMonitor_.reset();
+        lastMjpegHash_.reset();
 
-        if (uvcFrameFormat_ == UVC_FRAME_FORMAT_NV12) {
-            plane0_.resize(width * height);
-            plane1_.resize(width * height / 2);
-        } else if (uvcFrameFormat_ == UVC_FRAME_FORMAT_YUYV) {
-            plane0_.resize(width * height * 2);
+        // Buffers are sized exactly for the new format and those it does not use are freed, so a
+        // switch from 4K down to 720p or from MJPEG to NV12 gives the memory back.
+        auto fit = [](FrameBuffer &buffer, size_t size) {
+            buffer.resize(size);
+            buffer.shrink_to_fit();
+        };
+        if (pixelFormat_ != VideoPixelFormat::RGBA) releaseBuffer(rgbaBuffer_);
+        if (pixelFormat_ != VideoPixelFormat::NV12 && pixelFormat_ != VideoPixelFormat::P010) releaseBuffer(plane1_);
+        if (pixelFormat_ == VideoPixelFormat::NV12) {
+            fit(plane0_, width * height);
+            fit(plane1_, width * height / 2);
+        } else if (pixelFormat_ == VideoPixelFormat::P010) {
+            fit(plane0_, width * height * 2);
+            fit(plane1_, width * height);
         } else if (uvcFrameFormat_ == UVC_FRAME_FORMAT_MJPEG) {
-            plane0_.resize(width * height * 4);
+            // Decoded straight into rgbaBuffer_, at the size of the decode scale.
+            releaseBuffer(plane0_);
+        } else if (pixelFormat_ == VideoPixelFormat::H264 || pixelFormat_ == VideoPixelFormat::HEVC) {
+            // Frames only exist in the decoder's output surface.
+            releaseBuffer(plane0_);
+            decoder_ = std::make_unique<VideoDecoder>(
+                    pixelFormat_ == VideoPixelFormat::H264 ? VideoCodec::H264 : VideoCodec::HEVC,
+                    width, height, fps);
+            decoder_->setFrameListener([this] {
+                std::lock_guard<std::mutex> lock(frameMutex_);
+                frameSequence_++;
+                frameCaptureTime_ = steady_clock::now();
+                frameUpdated_ = true;
+                if (frameListener_) frameListener_();
+            });
+        } else {
+            fit(plane0_, payloadSize(pixelFormat_, width, height));
         }
+        ULOGI("Negotiated %s %dx%d @%d, interlace flags 0x%02x",
+              videoPixelFormatName(pixelFormat_), width, height, fps, interlaceFlags_);
     } else {
         isStreamControlNegotiated_ = false;
-        ULOGE("uvc_get_stream_ctrl_format_size failed %s", uvc_strerror(res));
+        ULOGE("Stream negotiation for %s failed %s", fourcc_.c_str(), uvc_strerror(res));
     }
 }
 
+uvc_error_t UsbVideoStreamer::negotiateByFourcc(int32_t width, int32_t height, int32_t fps) {
+    if (fourcc_.size() != 4) return UVC_ERROR_INVALID_PARAM;
+    for (const uvc_format_desc_t *format = uvc_get_format_descs(deviceHandle_); format != nullptr; format = format->next) {
+        bool uncompressed = format->bDescriptorSubtype == UVC_VS_FORMAT_UNCOMPRESSED;
+        bool frameBased = format->bDescriptorSubtype == UVC_VS_FORMAT_FRAME_BASED;
+        if ((!uncompressed && !frameBased) ||
+            std::memcmp(format->fourccFormat, fourcc_.data(), 4) != 0) {
+            continue;
+        }
+        for (const uvc_frame_desc_t *frame = format->frame_descs; frame != nullptr; frame = frame->next) {
+            if (frame->wWidth != width || frame->wHeight != height) continue;
+
+            // Same interval matching as uvc_get_stream_ctrl_format_size.
+            uint32_t frameInterval = 0;
+            if (frame->intervals != nullptr) {
+                for (const uint32_t *interval = frame->intervals; *interval != 0; interval++) {
+                    if (10000000 / *interval == static_cast<uint32_t>(fps) || fps == 0) {
+                        frameInterval = *interval;
+                        break;
+                    }
+                }
+            } else if (fps > 0) {
+                uint32_t interval = 10000000 / fps;
+                if (interval >= frame->dwMinFrameInterval && interval <= frame->dwMaxFrameInterval) {
+                    frameInterval = interval;
+                }
+            }
+            if (frameInterval == 0) continue;
+
+            streamCtrl_ = {};
+            streamCtrl_.bmHint = 1 << 0; // keep dwFrameInterval
+            streamCtrl_.bFormatIndex = format->bFormatIndex;
+            streamCtrl_.bFrameIndex = frame->bFrameIndex;
+            streamCtrl_.dwFrameInterval = frameInterval;
+            streamCtrl_.bInterfaceNumber = format->parent->bInterfaceNumber;
+            return uvc_probe_stream_ctrl(deviceHandle_, &streamCtrl_);
+        }
+    }
+    return UVC_ERROR_INVALID_MODE;
+}
+
 bool UsbVideoStreamer::configureOutput() {
+    std::lock_guard<std::mutex> lock(controlMutex_);
+    return openStream();
+}
+
+bool UsbVideoStreamer::openStream() {
     if (!isStreamControlNegotiated_) return false;
+    if (decoder_ != nullptr && !decoder_->start()) return false;
     uvc_error_t ret = uvc_stream_open_ctrl(deviceHandle_, &streamHandle_, &streamCtrl_);
-    return ret == UVC_SUCCESS;
+    if (ret != UVC_SUCCESS) return false;
+    uvcFrameBuffers_ = TrackedMemory(MemorySubsystem::UsbTransfers, 2 * size_t{streamCtrl_.dwMaxVideoFrameSize});
+    return true;
 }
 
 bool UsbVideoStreamer::start() {
+    std::lock_guard<std::mutex> lock(controlMutex_);
     if (streamHandle_ == nullptr) return false;
     uvc_error_t ret = uvc_stream_start(streamHandle_, captureFrameCallback, this, 0);
-    return ret == UVC_SUCCESS;
+    streaming_ = ret == UVC_SUCCESS;
+    return streaming_;
 }
 
 bool UsbVideoStreamer::stop() {
+    std::lock_guard<std::mutex> lock(controlMutex_);
     if (streamHandle_ == nullptr) return false;
+    streaming_ = false;
     return uvc_stream_stop(streamHandle_) == UVC_SUCCESS;
 }
 
+bool UsbVideoStreamer::reconfigure(const StreamMode &mode) {
+    std::lock_guard<std::mutex> lock(controlMutex_);
+    if (deviceHandle_ == nullptr) return false;
+    if (streamHandle_ != nullptr) {
+        // Also stops the stream and joins the capture callback.
+        uvc_stream_close(streamHandle_);
+        streamHandle_ = nullptr;
+        uvcFrameBuffers_ = {};
+    }
+
+    std::unique_ptr<VideoDecoder> previousDecoder;
+    {
+        std::lock_guard<std::mutex> frameLock(frameMutex_);
+        width_ = mode.width;
+        height_ = mode.height;
+        fps_ = mode.fps;
+        uvcFrameFormat_ = mode.uvcFrameFormat;
+        fourcc_ = mode.fourcc;
+        pixelFormat_ = pixelFormatFor(uvcFrameFormat_, fourcc_);
+        previousDecoder = std::move(decoder_);
+        negotiate();
+        // The textures keep the last frame of the previous mode until the new one delivers.
+        frameUpdated_ = false;
+    }
+    // Destroyed outside frameMutex_, which its frame listener takes.
+    previousDecoder = nullptr;
+
+    if (!openStream()) return false;
+    if (!streaming_) return true;
+    streaming_ = uvc_stream_start(streamHandle_, captureFrameCallback, this, 0) == UVC_SUCCESS;
+    return streaming_;
+}
+
+StreamMode UsbVideoStreamer::currentMode() {
+    std::lock_guard<std::mutex> lock(controlMutex_);
+    return {captureFrameFormat_, fourcc_, captureFrameWidth_, captureFrameHeight_, captureFrameFps_};
+}
+
+std::vector<StreamMode> UsbVideoStreamer::supportedModes() {
+    std::vector<StreamMode> modes;
+    if (deviceHandle_ == nullptr) return modes;
+    for (const uvc_format_desc_t *format = uvc_get_format_descs(deviceHandle_); format != nullptr; format = format->next) {
+        StreamMode mode{};
+        if (format->bDescriptorSubtype == UVC_VS_FORMAT_MJPEG) {
+            mode.uvcFrameFormat = UVC_FRAME_FORMAT_MJPEG;
+            mode.fourcc = "MJPEG";
+        } else if (format->bDescriptorSubtype != UVC_VS_FORMAT_UNCOMPRESSED) {
+            continue;
+        } else if (std::memcmp(format->fourccFormat, "NV12", 4) == 0) {
+            mode.uvcFrameFormat = UVC_FRAME_FORMAT_NV12;
+            mode.fourcc = "NV12";
+        } else if (std::memcmp(format->fourccFormat, "YUY2", 4) == 0) {
+            mode.uvcFrameFormat = UVC_FRAME_FORMAT_YUYV;
+            mode.fourcc = "YUY2";
+        } else {
+            continue;
+        }
+        for (const uvc_frame_desc_t *frame = format->frame_descs; frame != nullptr; frame = frame->next) {
+            mode.width = frame->wWidth;
+            mode.height = frame->wHeight;
+            if (frame->intervals != nullptr) {
+                for (const uint32_t *interval = frame->intervals; *interval != 0; interval++) {
+                    mode.fps = static_cast<int32_t>(10000000 / *interval);
+                    modes.push_back(mode);
+                }
+            } else if (frame->dwDefaultFrameInterval != 0) {
+                mode.fps = static_cast<int32_t>(10000000 / frame->dwDefaultFrameInterval);
+                modes.push_back(mode);
+            }
+        }
+    }
+    return modes;
+}
+
+StageCounters UsbVideoStreamer::takeStageCounters() {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    return std::exchange(stageCounters_, {});
+}
+
 std::string UsbVideoStreamer::statsSummaryString() const {
-    return std::format("{}x{} @{} fps", captureFrameWidth_, captureFrameHeight_, stats_.fps);
+    std::string summary = std::format("{}x{} @{} fps", captureFrameWidth_, captureFrameHeight_, stats_.fps);
+    if (stats_.unchanged > 0 && stats_.fps > 0) {
+        summary += std::format(", {}% unchanged", stats_.unchanged * 100 / stats_.fps);
+    }
+    SignalState signal = signalMonitor_.state();
+    if (signal != SignalState::LIVE) summary += std::format(", {}", signalStateName(signal));
+    return summary;
 }
 
 UsbVideoStreamer::~UsbVideoStreamer() {
+    // Closing cancels the stream's transfers, which completes on the event thread.
     if (deviceHandle_ != nullptr) uvc_close(deviceHandle_);
     if (uvcContext_ != nullptr) uvc_exit(uvcContext_);
+    stopUsbEvents_ = true;
+    if (usbEventThread_.joinable()) usbEventThread_.join();
+    if (usbContext_ != nullptr) libusb_exit(usbContext_);
 }
 
-int UsbVideoStreamer::getFormat() const {
-    switch (captureFrameFormat_) {
-        case UVC_FRAME_FORMAT_NV12:
-            return 1;
-        case UVC_FRAME_FORMAT_YUYV:
-            return 2;
-        default:
-            return 0;
+void UsbVideoStreamer::handleUsbEvents() {
+    applyThreadPolicy(ThreadRole::UsbEvents);
+    timeval timeout{0, 100000};
+    while (!stopUsbEvents_) {
+        libusb_handle_events_timeout_completed(usbContext_, &timeout, nullptr);
     }
 }
 
-bool UsbVideoStreamer::bindFrameToTextures(int texY, int texUV) {
+void UsbVideoStreamer::pausePresenting() {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    presentingPaused_ = true;
+}
+
+void UsbVideoStreamer::resumePresenting() {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    presentingPaused_ = false;
+    frameUpdated_ = true;
+    dirtyTiles_.markAll();
+}
+
+bool UsbVideoStreamer::bindFrameToTextures(
+        int texY, int texUV, int texExternal, VideoPixelFormat &format, bool texturesHoldFrame) {
+    TRACE_SECTION("bindFrameToTextures");
     std::lock_guard<std::mutex> lock(frameMutex_);
     if (!frameUpdated_) return false;
+    format = pixelFormat_;
+    boundFrameStamp_ = {frameSequence_, frameCaptureTime_};
 
+    if (decoder_ != nullptr) {
+        // Decoded frames are already in GPU memory and are only attached to the texture.
+        frameUpdated_ = false;
+        return decoder_->bindLatestImage(texExternal);
+    }
+
+    auto uploadStart = high_resolution_clock::now();
+    uint64_t frameBytes = plane0_.size();
+    // Mostly static NV12 and YUY2 frames only update the tiles that changed since the textures
+    // received the previous frame.
+    bool tiled = (pixelFormat_ == VideoPixelFormat::NV12 || pixelFormat_ == VideoPixelFormat::YUYV ||
+                  pixelFormat_ == VideoPixelFormat::UYVY) &&
+                 texturesHoldFrame && uploadedFormat_ == pixelFormat_ && uploadedWidth_ == width_ &&
+                 uploadedHeight_ == height_ &&
+                 static_cast<float>(dirtyTiles_.dirtyCount()) <=
+                         kMaxTileUploadFraction * static_cast<float>(dirtyTiles_.tileCount());
+    uint64_t tileBytes = 0;
+    constexpr int32_t kTile = DirtyTiles::kTileSize;
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, texY);
 
-    if (getFormat() == 1) { // NV12
-        // In GLES 3.0, use GL_R8 and GL_RED for the Y plane
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width_, height_, 0, GL_RED, GL_UNSIGNED_BYTE, plane0_.data());
+    // Everything but NV12 and P010 is uploaded as the payload arrived, and unpacked by the
+    // fragment shader of its format.
+    switch (pixelFormat_) {
+        case VideoPixelFormat::NV12:
+            frameBytes += plane1_.size();
+            setTextureFilter(GL_LINEAR);
+            // In GLES 3.0, use GL_R8 and GL_RED for the Y plane
+            if (tiled) {
+                tileBytes += uploadDirtyTiles(dirtyTiles_, plane0_.data(), width_, height_, 1, kTile, kTile, GL_RED);
+            } else {
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width_, height_, 0, GL_RED, GL_UNSIGNED_BYTE, plane0_.data());
+            }
+
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, texUV);
+            setTextureFilter(GL_LINEAR);
+            // In GLES 3.0, use GL_RG8 and GL_RG for the UV plane
+            if (tiled) {
+                tileBytes += uploadDirtyTiles(
+                        dirtyTiles_, plane1_.data(), width_ / 2, height_ / 2, 2, kTile / 2, kTile / 2, GL_RG);
+            } else {
+                glTexImage2D(
+                        GL_TEXTURE_2D, 0, GL_RG8, width_ / 2, height_ / 2, 0, GL_RG, GL_UNSIGNED_BYTE, plane1_.data());
+            }
+            break;
+        case VideoPixelFormat::P010:
+            // The 16-bit samples are uploaded as they are and the shader drops the 6 padding bits.
+            // GLES 3.0 has no filterable 16-bit normalized format, so these are nearest sampled
+            // integer textures.
+            frameBytes += plane1_.size();
+            setTextureFilter(GL_NEAREST);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, width_, height_, 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, plane0_.data());
 
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texUV);
-        // In GLES 3.0, use GL_RG8 and GL_RG for the UV plane
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, width_ / 2, height_ / 2, 0, GL_RG, GL_UNSIGNED_BYTE, plane1_.data());
-    } else if (getFormat() == 2) { // YUYV
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_ / 2, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, plane0_.data());
-    } else { // RGBA (MJPEG)
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgbaBuffer_.data());
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, texUV);
+            setTextureFilter(GL_NEAREST);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16UI, width_ / 2, height_ / 2, 0, GL_RG_INTEGER, GL_UNSIGNED_SHORT, plane1_.data());
+            break;
+        case VideoPixelFormat::YUYV:
+        case VideoPixelFormat::UYVY:
+            // One RGBA texel per two pixels
+            setTextureFilter(GL_NEAREST);
+            if (tiled) {
+                tileBytes += uploadDirtyTiles(
+                        dirtyTiles_, plane0_.data(), width_ / 2, height_, 4, kTile / 2, kTile, GL_RGBA);
+            } else {
+                glTexImage2D(
+                        GL_TEXTURE_2D, 0, GL_RGBA8, width_ / 2, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, plane0_.data());
+            }
+            break;
+        case VideoPixelFormat::I420:
+        case VideoPixelFormat::YV12:
+            // All three planes as one single channel texture, with the chroma planes below luma.
+            setTextureFilter(GL_NEAREST);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width_, height_ * 3 / 2, 0, GL_RED, GL_UNSIGNED_BYTE, plane0_.data());
+            break;
+        case VideoPixelFormat::RGB24:
+        case VideoPixelFormat::BGR24:
+            setTextureFilter(GL_LINEAR);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width_, height_, 0, GL_RGB, GL_UNSIGNED_BYTE, plane0_.data());
+            break;
+        case VideoPixelFormat::GRAY8:
+            setTextureFilter(GL_LINEAR);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width_, height_, 0, GL_RED, GL_UNSIGNED_BYTE, plane0_.data());
+            break;
+        case VideoPixelFormat::Y16:
+            setTextureFilter(GL_NEAREST);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, width_, height_, 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, plane0_.data());
+            break;
+        default: // RGBA (MJPEG)
+            frameBytes = rgbaBuffer_.size();
+            setTextureFilter(GL_LINEAR);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgbaBuffer_.data());
+            break;
     }
 
+    auto uploadTime = high_resolution_clock::now() - uploadStart;
+    uint64_t uploadBytes = tiled ? tileBytes : frameBytes;
+    uploadStats_.recordUpload(videoPixelFormatName(pixelFormat_), uploadBytes, frameBytes, tiled, uploadTime);
+    dirtyTiles_.clear();
+    uploadedFormat_ = pixelFormat_;
+    uploadedWidth_ = width_;
+    uploadedHeight_ = height_;
+    stageCounters_.upload += uploadTime;
+    TRACE_COUNTER("video.uploadBytes", uploadBytes);
+    TRACE_ASYNC_END("frame", frameSequence_);
     frameUpdated_ = false;
     return true;
 }
 
+void UsbVideoStreamer::getFrameSize(int32_t &width, int32_t &height) {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    width = width_;
+    height = height_;
+}
+
+FrameStamp UsbVideoStreamer::boundFrameStamp() {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    return boundFrameStamp_;
+}
+
+FieldOrder UsbVideoStreamer::fieldOrder() {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    // Streams of single fields deliver half height frames, which are shown like progressive ones.
+    if ((interlaceFlags_ & kInterlacedStream) != 0 && (interlaceFlags_ & kOneFieldPerFrame) == 0) {
+        // Field 1 holds the first, top line of the frame.
+        return (interlaceFlags_ & kField1First) != 0 ? FieldOrder::TopFirst : FieldOrder::BottomFirst;
+    }
+    return combDetector_.combed() ? FieldOrder::TopFirst : FieldOrder::Progressive;
+}
+
+std::optional<LumaPlane> UsbVideoStreamer::lumaPlane() const {
+    size_t pixels = static_cast<size_t>(width_) * height_;
+    switch (pixelFormat_) {
+        case VideoPixelFormat::NV12:
+        case VideoPixelFormat::I420:
+        case VideoPixelFormat::YV12:
+        case VideoPixelFormat::GRAY8:
+            if (plane0_.size() < pixels) return std::nullopt;
+            return LumaPlane{plane0_.data(), width_, height_, 1, 0, width_};
+        case VideoPixelFormat::YUYV:
+        case VideoPixelFormat::P010: // little endian, so the high byte is the second one
+        case VideoPixelFormat::Y16:
+        case VideoPixelFormat::UYVY:
+            if (plane0_.size() < pixels * 2) return std::nullopt;
+            return LumaPlane{
+                    plane0_.data(), width_, height_, 2, pixelFormat_ == VideoPixelFormat::YUYV ? 0 : 1, width_ * 2};
+        case VideoPixelFormat::RGB24:
+        case VideoPixelFormat::BGR24:
+            // Green stands in for luma.
+            if (plane0_.size() < pixels * 3) return std::nullopt;
+            return LumaPlane{plane0_.data(), width_, height_, 3, 1, width_ * 3};
+        case VideoPixelFormat::RGBA:
+            if (rgbaBuffer_.size() < pixels * 4) return std::nullopt;
+            return LumaPlane{rgbaBuffer_.data(), width_, height_, 4, 1, width_ * 4};
+        default: // decoded frames only exist on the GPU
+            return std::nullopt;
+    }
+}
+
+void UsbVideoStreamer::detectCombing() {
+    if ((interlaceFlags_ & kInterlacedStream) != 0 || ++framesSinceCombCheck_ < kCombCheckInterval) return;
+    framesSinceCombCheck_ = 0;
+
+    if (auto plane = lumaPlane()) {
+        combDetector_.analyze(
+                plane->data + plane->channel, plane->width, plane->height, plane->pixelStride, plane->rowStride);
+    }
+}
+
+bool UsbVideoStreamer::readLuma(uint32_t &sequence, const std::function<void(const LumaPlane &)> &reader) {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    if (sequence == frameSequence_ || decoder_ != nullptr) return false;
+    auto plane = lumaPlane();
+    if (!plane.has_value()) return false;
+    sequence = frameSequence_;
+    reader(*plane);
+    return true;
+}
+
+std::optional<std::array<float, 3>> UsbVideoStreamer::regionYuv(
+        uint32_t sequence, int32_t x, int32_t y, int32_t width, int32_t height) {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    if (sequence != frameSequence_ || decoder_ != nullptr) return std::nullopt;
+    if (width <= 0 || height <= 0 || x < 0 || y < 0 || x + width > width_ || y + height > height_) {
+        return std::nullopt;
+    }
+
+    size_t pixels = static_cast<size_t>(width_) * height_;
+    size_t stride = width_;
+    // Chroma samples cover two pixels of a row, and in 4:2:0 two rows as well.
+    int32_t chromaX = x / 2;
+    int32_t chromaWidth = (x + width + 1) / 2 - chromaX;
+    int32_t chromaY = y / 2;
+    int32_t chromaHeight = (y + height + 1) / 2 - chromaY;
+    switch (pixelFormat_) {
+        case VideoPixelFormat::NV12:
+            if (plane0_.size() < pixels || plane1_.size() < pixels / 2) return std::nullopt;
+            return std::array<float, 3>{
+                    planeMean<uint8_t>(plane0_.data(), stride, 1, x, y, width, height),
+                    planeMean<uint8_t>(plane1_.data(), stride, 2, chromaX, chromaY, chromaWidth, chromaHeight),
+                    planeMean<uint8_t>(plane1_.data() + 1, stride, 2, chromaX, chromaY, chromaWidth, chromaHeight)};
+        case VideoPixelFormat::P010:
+            // The 10 bits are at the top of each 16-bit sample.
+            if (plane0_.size() < pixels * 2 || plane1_.size() < pixels) return std::nullopt;
+            return std::array<float, 3>{
+                    planeMean<uint16_t>(plane0_.data(), stride * 2, 2, x, y, width, height) / 256.0f,
+                    planeMean<uint16_t>(plane1_.data(), stride * 2, 4, chromaX, chromaY, chromaWidth, chromaHeight) /
+                            256.0f,
+                    planeMean<uint16_t>(plane1_.data() + 2, stride * 2, 4, chromaX, chromaY, chromaWidth, chromaHeight) /
+                            256.0f};
+        case VideoPixelFormat::I420:
+        case VideoPixelFormat::YV12: {
+            if (plane0_.size() < pixels * 3 / 2) return std::nullopt;
+            const uint8_t *u = plane0_.data() + pixels;
+            const uint8_t *v = u + pixels / 4;
+            if (pixelFormat_ == VideoPixelFormat::YV12) std::swap(u, v);
+            return std::array<float, 3>{
+                    planeMean<uint8_t>(plane0_.data(), stride, 1, x, y, width, height),
+                    planeMean<uint8_t>(u, stride / 2, 1, chromaX, chromaY, chromaWidth, chromaHeight),
+                    planeMean<uint8_t>(v, stride / 2, 1, chromaX, chromaY, chromaWidth, chromaHeight)};
+        }
+        case VideoPixelFormat::YUYV:
+        case VideoPixelFormat::UYVY: {
+            if (plane0_.size() < pixels * 2) return std::nullopt;
+            // Y0 U Y1 V, or U Y0 V Y1.
+            bool yuyv = pixelFormat_ == VideoPixelFormat::YUYV;
+            const uint8_t *data = plane0_.data();
+            return std::array<float, 3>{
+                    planeMean<uint8_t>(data + (yuyv ? 0 : 1), stride * 2, 2, x, y, width, height),
+                    planeMean<uint8_t>(data + (yuyv ? 1 : 0), stride * 2, 4, chromaX, y, chromaWidth, height),
+                    planeMean<uint8_t>(data + (yuyv ? 3 : 2), stride * 2, 4, chromaX, y, chromaWidth, height)};
+        }
+        case VideoPixelFormat::GRAY8:
+            if (plane0_.size() < pixels) return std::nullopt;
+            return std::array<float, 3>{planeMean<uint8_t>(plane0_.data(), stride, 1, x, y, width, height), 128.0f, 128.0f};
+        case VideoPixelFormat::Y16:
+            if (plane0_.size() < pixels * 2) return std::nullopt;
+            return std::array<float, 3>{
+                    planeMean<uint16_t>(plane0_.data(), stride * 2, 2, x, y, width, height) / 256.0f, 128.0f, 128.0f};
+        default: // RGB sources and frames that only exist on the GPU
+            return std::nullopt;
+    }
+}
+
+bool UsbVideoStreamer::convertFrameToRGBA(uint8_t *dst, int32_t dstStride, int32_t width, int32_t height) {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    if (width != width_ || height != height_ || decoder_ != nullptr) return false;
+
+    size_t pixels = static_cast<size_t>(width) * height;
+    if (plane0_.size() < payloadSize(pixelFormat_, width, height)) return false;
+    const uint8_t *payload = plane0_.data();
+    switch (pixelFormat_) {
+        case VideoPixelFormat::NV12:
+            if (plane0_.size() < pixels || plane1_.size() < pixels / 2) return false;
+            libyuv::NV12ToABGR(plane0_.data(), width, plane1_.data(), width, dst, dstStride, width, height);
+            break;
+        case VideoPixelFormat::YUYV:
+            libyuv::YUY2ToARGB(payload, width * 2, dst, dstStride, width, height);
+            libyuv::ARGBToABGR(dst, dstStride, dst, dstStride, width, height);
+            break;
+        case VideoPixelFormat::UYVY:
+            libyuv::UYVYToARGB(payload, width * 2, dst, dstStride, width, height);
+            libyuv::ARGBToABGR(dst, dstStride, dst, dstStride, width, height);
+            break;
+        case VideoPixelFormat::P010: // shown as BT.709 SDR; the HDR transfer functions are only applied by GL
+            if (plane0_.size() < pixels * 2 || plane1_.size() < pixels) return false;
+            libyuv::P010ToARGB(
+                    reinterpret_cast<const uint16_t *>(plane0_.data()), width,
+                    reinterpret_cast<const uint16_t *>(plane1_.data()), width,
+                    dst, dstStride, width, height);
+            libyuv::ARGBToABGR(dst, dstStride, dst, dstStride, width, height);
+            break;
+        case VideoPixelFormat::I420:
+        case VideoPixelFormat::YV12: {
+            const uint8_t *u = payload + pixels;
+            const uint8_t *v = u + pixels / 4;
+            if (pixelFormat_ == VideoPixelFormat::YV12) std::swap(u, v);
+            libyuv::I420ToABGR(payload, width, u, width / 2, v, width / 2, dst, dstStride, width, height);
+            break;
+        }
+        case VideoPixelFormat::RGB24:
+            // libyuv calls R, G, B byte order RAW and B, G, R byte order RGB24.
+            libyuv::RAWToARGB(payload, width * 3, dst, dstStride, width, height);
+            libyuv::ARGBToABGR(dst, dstStride, dst, dstStride, width, height);
+            break;
+        case VideoPixelFormat::BGR24:
+            libyuv::RGB24ToARGB(payload, width * 3, dst, dstStride, width, height);
+            libyuv::ARGBToABGR(dst, dstStride, dst, dstStride, width, height);
+            break;
+        case VideoPixelFormat::GRAY8:
+            libyuv::J400ToARGB(payload, width, dst, dstStride, width, height);
+            break;
+        case VideoPixelFormat::Y16:
+            for (int32_t y = 0; y < height; y++) {
+                auto src = reinterpret_cast<const uint16_t *>(payload) + static_cast<size_t>(y) * width;
+                uint8_t *row = dst + static_cast<size_t>(y) * dstStride;
+                for (int32_t x = 0; x < width; x++) {
+                    uint8_t luma = src[x] >> 8;
+                    row[x * 4] = row[x * 4 + 1] = row[x * 4 + 2] = luma;
+                    row[x * 4 + 3] = 0xff;
+                }
+            }
+            break;
+        default: // RGBA (MJPEG)
+            if (rgbaBuffer_.size() < pixels * 4) return false;
+            libyuv::ARGBCopy(rgbaBuffer_.data(), width * 4, dst, dstStride, width, height);
+            break;
+    }
+    if (frameUpdated_) TRACE_ASYNC_END("frame", frameSequence_);
+    frameUpdated_ = false;
+    return true;
+}
+
+bool UsbVideoStreamer::scaleFrameToRGBA(
+        FrameStamp &stamp, uint8_t *dst, int32_t dstStride, int32_t width, int32_t height,
+        std::vector<uint8_t> &scratch) {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    if (stamp.sequence == frameSequence_ || decoder_ != nullptr || width_ <= 0 || height_ <= 0) return false;
+
+    size_t pixels = static_cast<size_t>(width_) * height_;
+    size_t dstPixels = static_cast<size_t>(width) * height;
+    int32_t chromaWidth = (width + 1) / 2;
+    int32_t chromaHeight = (height + 1) / 2;
+    size_t chromaPixels = static_cast<size_t>(chromaWidth) * chromaHeight;
+    switch (pixelFormat_) {
+        case VideoPixelFormat::RGBA:
+            if (rgbaBuffer_.size() < pixels * 4) return false;
+            libyuv::ARGBScale(
+                    rgbaBuffer_.data(), width_ * 4, width_, height_, dst, dstStride, width, height, libyuv::kFilterBox);
+            break;
+        case VideoPixelFormat::NV12: {
+            if (plane0_.size() < pixels || plane1_.size() < pixels / 2) return false;
+            scratch.resize(dstPixels + chromaPixels * 2);
+            uint8_t *y = scratch.data();
+            uint8_t *uv = y + dstPixels;
+            libyuv::NV12Scale(
+                    plane0_.data(), width_, plane1_.data(), width_, width_, height_,
+                    y, width, uv, chromaWidth * 2, width, height, libyuv::kFilterBox);
+            libyuv::NV12ToABGR(y, width, uv, chromaWidth * 2, dst, dstStride, width, height);
+            break;
+        }
+        case VideoPixelFormat::I420:
+        case VideoPixelFormat::YV12: {
+            if (plane0_.size() < pixels * 3 / 2) return false;
+            const uint8_t *u = plane0_.data() + pixels;
+            const uint8_t *v = u + pixels / 4;
+            if (pixelFormat_ == VideoPixelFormat::YV12) std::swap(u, v);
+            scratch.resize(dstPixels + chromaPixels * 2);
+            uint8_t *y = scratch.data();
+            uint8_t *scaledU = y + dstPixels;
+            uint8_t *scaledV = scaledU + chromaPixels;
+            libyuv::I420Scale(
+                    plane0_.data(), width_, u, width_ / 2, v, width_ / 2, width_, height_,
+                    y, width, scaledU, chromaWidth, scaledV, chromaWidth, width, height, libyuv::kFilterBox);
+            libyuv::I420ToABGR(y, width, scaledU, chromaWidth, scaledV, chromaWidth, dst, dstStride, width, height);
+            break;
+        }
+        case VideoPixelFormat::YUYV:
+        case VideoPixelFormat::UYVY: {
+            if (plane0_.size() < pixels * 2) return false;
+            // Each 4:2:2 group of two pixels scales like one 4-byte pixel. Groups are scaled to
+            // twice the width that is needed, so each luma sample is still a pixel of its own,
+            // and the converted pixels are halved after.
+            scratch.resize(dstPixels * 12);
+            uint8_t *packed = scratch.data();
+            uint8_t *argb = packed + dstPixels * 4;
+            libyuv::ARGBScale(
+                    plane0_.data(), width_ * 2, width_ / 2, height_, packed, width * 4, width, height,
+                    libyuv::kFilterBox);
+            if (pixelFormat_ == VideoPixelFormat::YUYV) {
+                libyuv::YUY2ToARGB(packed, width * 4, argb, width * 8, width * 2, height);
+            } else {
+                libyuv::UYVYToARGB(packed, width * 4, argb, width * 8, width * 2, height);
+            }
+            libyuv::ARGBScale(argb, width * 8, width * 2, height, dst, dstStride, width, height, libyuv::kFilterBox);
+            libyuv::ARGBToABGR(dst, dstStride, dst, dstStride, width, height);
+            break;
+        }
+        case VideoPixelFormat::GRAY8:
+            if (plane0_.size() < pixels) return false;
+            scratch.resize(dstPixels);
+            libyuv::ScalePlane(
+                    plane0_.data(), width_, width_, height_, scratch.data(), width, width, height, libyuv::kFilterBox);
+            libyuv::J400ToARGB(scratch.data(), width, dst, dstStride, width, height);
+            break;
+        case VideoPixelFormat::P010: {
+            // libyuv has no 16-bit box scaler for biplanar frames, so samples are picked.
+            if (plane0_.size() < pixels * 2 || plane1_.size() < pixels) return false;
+            scratch.resize((dstPixels + chromaPixels * 2) * 2);
+            auto y = reinterpret_cast<uint16_t *>(scratch.data());
+            uint16_t *uv = y + dstPixels;
+            auto srcY = reinterpret_cast<const uint16_t *>(plane0_.data());
+            auto srcUV = reinterpret_cast<const uint16_t *>(plane1_.data());
+            for (int32_t row = 0; row < height; row++) {
+                const uint16_t *src = srcY + static_cast<size_t>(nearestSample(row, height, height_)) * width_;
+                for (int32_t x = 0; x < width; x++) y[row * width + x] = src[nearestSample(x, width, width_)];
+            }
+            for (int32_t row = 0; row < chromaHeight; row++) {
+                const uint16_t *src =
+                        srcUV + static_cast<size_t>(nearestSample(row, chromaHeight, height_ / 2)) * width_;
+                for (int32_t x = 0; x < chromaWidth; x++) {
+                    int32_t sx = nearestSample(x, chromaWidth, width_ / 2);
+                    uv[(row * chromaWidth + x) * 2] = src[sx * 2];
+                    uv[(row * chromaWidth + x) * 2 + 1] = src[sx * 2 + 1];
+                }
+            }
+            libyuv::P010ToARGB(y, width, uv, chromaWidth * 2, dst, dstStride, width, height);
+            libyuv::ARGBToABGR(dst, dstStride, dst, dstStride, width, height);
+            break;
+        }
+        case VideoPixelFormat::RGB24:
+        case VideoPixelFormat::BGR24:
+        case VideoPixelFormat::Y16: {
+            // Picks samples; these formats are rare enough not to need scaling on the way.
+            size_t pixelBytes = pixelFormat_ == VideoPixelFormat::Y16 ? 2 : 3;
+            if (plane0_.size() < pixels * pixelBytes) return false;
+            for (int32_t row = 0; row < height; row++) {
+                const uint8_t *src =
+                        plane0_.data() + static_cast<size_t>(nearestSample(row, height, height_)) * width_ * pixelBytes;
+                uint8_t *out = dst + static_cast<size_t>(row) * dstStride;
+                for (int32_t x = 0; x < width; x++) {
+                    const uint8_t *pixel = src + nearestSample(x, width, width_) * pixelBytes;
+                    if (pixelFormat_ == VideoPixelFormat::Y16) {
+                        out[x * 4] = out[x * 4 + 1] = out[x * 4 + 2] = pixel[1]; // high byte
+                    } else {
+                        bool bgr = pixelFormat_ == VideoPixelFormat::BGR24;
+                        out[x * 4] = pixel[bgr ? 2 : 0];
+                        out[x * 4 + 1] = pixel[1];
+                        out[x * 4 + 2] = pixel[bgr ? 0 : 2];
+                    }
+                    out[x * 4 + 3] = 0xff;
+                }
+            }
+            break;
+        }
+        default: // decoded frames only exist on the GPU
+            return false;
+    }
+    stamp = {frameSequence_, frameCaptureTime_};
+    return true;
+}
+
+bool UsbVideoStreamer::scaleFrameToNV12(
+        FrameStamp &stamp, uint8_t *dst, int32_t width, int32_t height, std::vector<uint8_t> &scratch) {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    if (stamp.sequence == frameSequence_ || decoder_ != nullptr || width_ <= 0 || height_ <= 0) return false;
+
+    size_t pixels = static_cast<size_t>(width_) * height_;
+    size_t dstPixels = static_cast<size_t>(width) * height;
+    uint8_t *y = dst;
+    uint8_t *uv = dst + dstPixels;
+    switch (pixelFormat_) {
+        case VideoPixelFormat::NV12:
+            if (plane0_.size() < pixels || plane1_.size() < pixels / 2) return false;
+            libyuv::NV12Scale(
+                    plane0_.data(), width_, plane1_.data(), width_, width_, height_,
+                    y, width, uv, width, width, height, libyuv::kFilterBox);
+            break;
+        case VideoPixelFormat::I420:
+        case VideoPixelFormat::YV12: {
+            if (plane0_.size() < pixels * 3 / 2) return false;
+            const uint8_t *u = plane0_.data() + pixels;
+            const uint8_t *v = u + pixels / 4;
+            if (pixelFormat_ == VideoPixelFormat::YV12) std::swap(u, v);
+            scratch.resize(dstPixels / 2);
+            uint8_t *scaledU = scratch.data();
+            uint8_t *scaledV = scaledU + dstPixels / 4;
+            libyuv::I420Scale(
+                    plane0_.data(), width_, u, width_ / 2, v, width_ / 2, width_, height_,
+                    y, width, scaledU, width / 2, scaledV, width / 2, width, height, libyuv::kFilterBox);
+            libyuv::MergeUVPlane(scaledU, width / 2, scaledV, width / 2, uv, width, width / 2, height / 2);
+            break;
+        }
+        case VideoPixelFormat::YUYV:
+        case VideoPixelFormat::UYVY: {
+            if (plane0_.size() < pixels * 2) return false;
+            // As in scaleFrameToRGBA, 4:2:2 groups are scaled to twice the width that is needed.
+            scratch.resize(dstPixels * 7);
+            uint8_t *packed = scratch.data();
+            uint8_t *wideY = packed + dstPixels * 4;
+            uint8_t *wideUV = wideY + dstPixels * 2;
+            libyuv::ARGBScale(
+                    plane0_.data(), width_ * 2, width_ / 2, height_, packed, width * 4, width, height,
+                    libyuv::kFilterBox);
+            if (pixelFormat_ == VideoPixelFormat::YUYV) {
+                libyuv::YUY2ToNV12(packed, width * 4, wideY, width * 2, wideUV, width * 2, width * 2, height);
+            } else {
+                libyuv::UYVYToNV12(packed, width * 4, wideY, width * 2, wideUV, width * 2, width * 2, height);
+            }
+            libyuv::NV12Scale(
+                    wideY, width * 2, wideUV, width * 2, width * 2, height,
+                    y, width, uv, width, width, height, libyuv::kFilterBox);
+            break;
+        }
+        case VideoPixelFormat::GRAY8:
+            if (plane0_.size() < pixels) return false;
+            libyuv::ScalePlane(plane0_.data(), width_, width_, height_, y, width, width, height, libyuv::kFilterBox);
+            std::memset(uv, 128, dstPixels / 2);
+            break;
+        case VideoPixelFormat::RGBA:
+            // R, G, B, X byte order, which libyuv calls ABGR.
+            if (rgbaBuffer_.size() < pixels * 4) return false;
+            scratch.resize(dstPixels * 4);
+            libyuv::ARGBScale(
+                    rgbaBuffer_.data(), width_ * 4, width_, height_, scratch.data(), width * 4, width, height,
+                    libyuv::kFilterBox);
+            libyuv::ABGRToNV12(scratch.data(), width * 4, y, width, uv, width, width, height);
+            break;
+        default: // 10 and 16-bit, RGB and frames that only exist on the GPU
+            return false;
+    }
+    stamp = {frameSequence_, frameCaptureTime_};
+    return true;
+}
+
+void UsbVideoStreamer::setFrameListener(std::function<void()> listener) {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    frameListener_ = std::move(listener);
+}
 
 void UsbVideoStreamer::captureFrameCallback(uvc_frame_t *frame, void *user_data) {
+    applyThreadPolicy(ThreadRole::Capture);
+    TRACE_SECTION("captureFrameCallback");
+    TRACE_COUNTER("uvc.frameBytes", frame->data_bytes);
     UsbVideoStreamer *self = (UsbVideoStreamer *) user_data;
     UsbVideoStreamerStats &stats = self->stats_;
 
+    if (self->decoder_ != nullptr) {
+        // The decoder's frame listener marks the frame as updated once it has been decoded.
+        self->decoder_->decode(
+                static_cast<const uint8_t *>(frame->data), frame->data_bytes,
+                duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+        std::lock_guard<std::mutex> lock(self->frameMutex_);
+        self->stageCounters_.frames++;
+        stats.recordFrame();
+        return;
+    }
+
     std::lock_guard<std::mutex> lock(self->frameMutex_);
+    auto captureStart = steady_clock::now();
+    // MJPEG payloads are hashed in full, so identical frames can skip the decode; the larger raw
+    // payloads are only sampled, and hashed in full by the signal monitor once the samples stop
+    // changing.
+    const auto *payload = static_cast<const uint8_t *>(frame->data);
+    bool mjpeg = self->pixelFormat_ == VideoPixelFormat::RGBA && frame->frame_format == UVC_FRAME_FORMAT_MJPEG;
+    uint64_t payloadHash = mjpeg
+            ? (static_cast<uint64_t>(frame->data_bytes) << 32 | crc32c(payload, frame->data_bytes))
+            : SignalMonitor::sampleHash(payload, frame->data_bytes);
+    uint32_t decodeScale = self->decodeScale_;
+    if (self->signalMonitor_.skipFrame(payload, frame->data_bytes, payloadHash, mjpeg, captureStart)) {
+        // The last frame stays on screen and the presenter is not woken.
+        self->stageCounters_.frames++;
+        self->stageCounters_.skipped++;
+        stats.recordFrame();
+        return;
+    }
+    if (mjpeg && payloadHash == self->lastMjpegHash_ && decodeScale == self->lastMjpegScale_) {
+        // Byte identical to the frame already stored or shown: nothing to decode, convert, upload
+        // or draw.
+        self->stageCounters_.frames++;
+        self->stageCounters_.unchanged++;
+        TRACE_COUNTER("video.unchangedFrames", self->stageCounters_.unchanged);
+        stats.recordFrame(true);
+        return;
+    }
     int width = frame->width;
     int height = frame->height;
-    self->width_ = width;
-    self->height_ = height;
-
-    if (self->rgbaBuffer_.size() != width * height * 4) {
-        self->rgbaBuffer_.resize(width * height * 4);
+    // A payload cut short by lost transfers would leave part of the stored frame stale or mix
+    // two frames, so it is dropped and the last complete frame stays on screen.
+    size_t pixels = static_cast<size_t>(width) * height;
+    size_t expectedBytes = payloadSize(self->pixelFormat_, width, height);
+    if (self->pixelFormat_ == VideoPixelFormat::NV12) expectedBytes = pixels * 3 / 2;
+    if (self->pixelFormat_ == VideoPixelFormat::P010) expectedBytes = pixels * 3;
+    if (frame->data_bytes < expectedBytes) {
+        self->stageCounters_.frames++;
+        stats.recordFrame();
+        return;
+    }
+    TRACE_ASYNC_BEGIN("frame", frame->sequence);
+    if (self->pixelFormat_ != VideoPixelFormat::RGBA) {
+        self->width_ = width;
+        self->height_ = height;
     }
-    uint8_t *rgbaData = self->rgbaBuffer_.data();
 
-    switch (frame->frame_format) {
-        case UVC_FRAME_FORMAT_NV12: {
+    // Formats that libuvc only knows by GUID arrive as UVC_FRAME_FORMAT_UNKNOWN, so the
+    // negotiated format is used instead of frame->frame_format.
+    switch (self->pixelFormat_) {
+        case VideoPixelFormat::NV12: {
             size_t y_size = width * height;
             size_t uv_size = y_size / 2;
             if (self->plane0_.size() != y_size) self->plane0_.resize(y_size);
             if (self->plane1_.size() != uv_size) self->plane1_.resize(uv_size);
+            // Only the tiles that differ from the stored frame are copied, and later uploaded.
+            constexpr int32_t kTile = DirtyTiles::kTileSize;
+            self->dirtyTiles_.resize(width, height);
+            self->dirtyTiles_.copyPlane(self->plane0_.data(), payload, width, height, kTile, kTile);
+            self->dirtyTiles_.copyPlane(self->plane1_.data(), payload + y_size, width, height / 2, kTile, kTile / 2);
+            break;
+        }
+        case VideoPixelFormat::P010: {
+            // 16 bits per sample: a full resolution Y plane followed by interleaved half
+            // resolution UV.
+            size_t y_size = width * height * 2;
+            size_t uv_size = y_size / 2;
+            if (self->plane0_.size() != y_size) self->plane0_.resize(y_size);
+            if (self->plane1_.size() != uv_size) self->plane1_.resize(uv_size);
             std::memcpy(self->plane0_.data(), frame->data, y_size);
             std::memcpy(self->plane1_.data(), (uint8_t *) frame->data + y_size, uv_size);
             break;
         }
-        case UVC_FRAME_FORMAT_YUYV: {
-            size_t size = width * height * 2;
-            if (self->plane0_.size() != size) self->plane0_.resize(size);
-            std::memcpy(self->plane0_.data(), frame->data, size);
+        case VideoPixelFormat::RGBA: {
+            if (frame->frame_format != UVC_FRAME_FORMAT_MJPEG) {
+                TRACE_ASYNC_END("frame", frame->sequence);
+                return;
+            }
+            int32_t decodedWidth = 0;
+            int32_t decodedHeight = 0;
+            if (!self->mjpegDecoder_.decode(
+                    payload, frame->data_bytes, decodeScale, self->rgbaBuffer_, decodedWidth, decodedHeight)) {
+                // Keeps presenting the previous frame.
+                TRACE_ASYNC_END("frame", frame->sequence);
+                self->lastMjpegHash_.reset();
+                return;
+            }
+            self->lastMjpegHash_ = payloadHash;
+            self->lastMjpegScale_ = decodeScale;
+            // Smaller than the negotiated size when the decode is scaled down.
+            self->width_ = decodedWidth;
+            self->height_ = decodedHeight;
             break;
         }
-        case UVC_FRAME_FORMAT_MJPEG: {
-            uvc_frame_t *rgb_frame = uvc_allocate_frame(width * height * 3);
-            if (rgb_frame) {
-                if (uvc_mjpeg2rgb(frame, rgb_frame) == UVC_SUCCESS) {
-                    libyuv::RAWToARGB(
-                            (uint8_t *) rgb_frame->data, rgb_frame->step,
-                            rgbaData, width * 4,
-                            width, height);
-                    libyuv::ARGBToABGR(rgbaData, width * 4, rgbaData, width * 4, width, height);
-                }
-                uvc_free_frame(rgb_frame);
-            }
+        case VideoPixelFormat::YUYV:
+        case VideoPixelFormat::UYVY: {
+            size_t size = payloadSize(self->pixelFormat_, width, height);
+            if (self->plane0_.size() != size) self->plane0_.resize(size);
+            self->dirtyTiles_.resize(width, height);
+            self->dirtyTiles_.copyPlane(
+                    self->plane0_.data(), payload, width * 2, height, DirtyTiles::kTileSize * 2, DirtyTiles::kTileSize);
             break;
         }
-        default:
+        default: {
+            size_t size = payloadSize(self->pixelFormat_, width, height);
+            if (self->plane0_.size() != size) self->plane0_.resize(size);
+            std::memcpy(self->plane0_.data(), frame->data, size);
             break;
+        }
+    }
+
+    StageCounters &counters = self->stageCounters_;
+    counters.frames++;
+    if (self->frameUpdated_) {
+        // Without a presenter, or while it replays, nothing takes the frames, which says nothing
+        // about the pipeline.
+        counters.recordReplaced(self->frameListener_ && !self->presentingPaused_);
+        TRACE_ASYNC_END("frame", self->frameSequence_);
+    }
+    self->detectCombing();
+    if (auto plane = self->lumaPlane()) {
+        self->signalMonitor_.analyzeLuma(
+                plane->data + plane->channel, plane->width, plane->height, plane->pixelStride, plane->rowStride,
+                captureStart);
     }
+    counters.capture += steady_clock::now() - captureStart;
+    TRACE_COUNTER("video.droppedFrames", counters.dropped);
 
+    self->frameSequence_ = frame->sequence;
+    self->frameCaptureTime_ = captureStart;
     self->frameUpdated_ = true;
     stats.recordFrame();
+    if (self->frameListener_) self->frameListener_();
 }
@@ -20,12 +20,24 @@
 #include <libuvc/libuvc.h>
 #include <jni.h>
 #include <GLES3/gl3.h>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <vector>
 #include <string>
 #include <mutex>
+#include <optional>
+#include <thread>
+
+#include "CombDetector.h"
+#include "DirtyTiles.h"
+#include "MemoryBudget.h"
+#include "MjpegDecoder.h"
+#include "SignalMonitor.h"
+#include "VideoDecoder.h"
 
 using namespace std::chrono;
 
@@ -36,23 +48,122 @@ struct UsbVideoStreamerStats {
     steady_clock::time_point lastFpsUpdate{0s};
     uint8_t fps = 0;
     uint8_t currentFps = 0;
+    // MJPEG frames identical to the previous one, in the last second.
+    uint8_t unchanged = 0;
+    uint8_t currentUnchanged = 0;
     steady_clock::time_point t0{high_resolution_clock::now()};
 
     steady_clock::time_point captureRenderClock_{high_resolution_clock::now()};
     nanoseconds capture_{0ns};
     nanoseconds render_{0ns};
 
-    void recordFrame() {
+    void recordFrame(bool unchangedFrame = false) {
         currentFps++;
+        if (unchangedFrame) currentUnchanged++;
         auto now = high_resolution_clock::now();
         if (now - t0 >= 1s) {
             t0 = now;
             fps = currentFps;
             currentFps = 0;
+            unchanged = currentUnchanged;
+            currentUnchanged = 0;
         }
     }
 };
 
+// Layout of the frame kept by the streamer, which selects the program that unpacks it.
+enum class VideoPixelFormat : int {
+    RGBA = 0, // MJPEG, decoded on the CPU
+    NV12,
+    YUYV,
+    P010,
+    UYVY,
+    I420,
+    YV12,
+    RGB24, // R, G, B byte order
+    BGR24, // B, G, R byte order
+    GRAY8,
+    Y16, // little endian
+    H264, // decoded by VideoDecoder into an external texture
+    HEVC,
+    COUNT,
+};
+
+const char *videoPixelFormatName(VideoPixelFormat format);
+
+struct TextureUploadStats {
+    uint32_t uploads = 0;
+    // Uploads of only the changed tiles of a frame.
+    uint32_t tileUploads = 0;
+    uint64_t bytes = 0;
+    // Size of the uploaded frames, of which bytes were sent.
+    uint64_t frameBytes = 0;
+    nanoseconds uploadTime_{0ns};
+    steady_clock::time_point t0{high_resolution_clock::now()};
+
+    void recordUpload(
+            const char *format, uint64_t uploadBytes, uint64_t frameSize, bool tiled, nanoseconds uploadTime);
+};
+
+// Per stage counters since the last UsbVideoStreamer::takeStageCounters().
+struct StageCounters {
+    uint32_t frames = 0;
+    // Frames replaced by a newer one before the attached presenter took them.
+    uint32_t dropped = 0;
+    // Frames replaced while no presenter was taking frames, detached or replaying; not drops.
+    uint32_t unpresented = 0;
+    // Frames dropped undecoded while the source showed no signal or a frozen frame.
+    uint32_t skipped = 0;
+    // MJPEG frames byte identical to the one before, which were not decoded or uploaded.
+    uint32_t unchanged = 0;
+    // Time spent in the capture callback, which includes MJPEG decode.
+    nanoseconds capture{0ns};
+    nanoseconds upload{0ns};
+
+    void recordReplaced(bool presenting) {
+        if (presenting) {
+            dropped++;
+        } else {
+            unpresented++;
+        }
+    }
+};
+
+// Order of the two fields woven into each frame of an interlaced source.
+enum class FieldOrder {
+    Progressive,
+    TopFirst,
+    BottomFirst,
+};
+
+// Luma of a stored frame, or the channel that stands in for it.
+struct LumaPlane {
+    // First byte of the first pixel; the luma is channel bytes into each pixel.
+    const uint8_t *data;
+    int32_t width;
+    int32_t height;
+    int32_t pixelStride;
+    int32_t channel;
+    int32_t rowStride;
+};
+
+// Identifies a frame for latency measurements.
+struct FrameStamp {
+    // UVC sequence number, or the count of decoded frames for H.264/HEVC.
+    uint32_t sequence;
+    // When the capture callback received the frame, or when the decoder output it.
+    steady_clock::time_point captured;
+};
+
+// A format, size and rate the device can be negotiated to.
+struct StreamMode {
+    uvc_frame_format uvcFrameFormat;
+    std::string fourcc;
+    int32_t width;
+    int32_t height;
+    int32_t fps;
+};
+
 class UsbVideoStreamer final {
 public:
     static void captureFrameCallback(uvc_frame_t *frame, void *user_data);
@@ -62,7 +173,8 @@ public:
             int32_t width,
             int32_t height,
             int32_t fps,
-            uvc_frame_format uvcFrameFormat);
+            uvc_frame_format uvcFrameFormat,
+            std::string fourcc);
 
     ~UsbVideoStreamer();
 
@@ -74,32 +186,180 @@ public:
 
     std::string statsSummaryString() const;
 
-    int getFormat() const;
-    bool bindFrameToTextures(int texY, int texUV);
+    /**
+     * Switches the device to another mode without closing it: the stream is renegotiated on the
+     * open handle and resumed if it was running. The last frame stays on screen until the new
+     * mode delivers one, so the presenter and surface are not affected.
+     */
+    bool reconfigure(const StreamMode &mode);
+
+    StreamMode currentMode();
+
+    /** Every MJPEG, NV12 and YUY2 mode the device advertises. */
+    std::vector<StreamMode> supportedModes();
+
+    /** Decodes MJPEG at 1/denominator of the negotiated size (1, 2, 4 or 8). */
+    void setDecodeScale(uint32_t denominator) { decodeScale_ = denominator; }
+
+    StageCounters takeStageCounters();
+
+    VideoPixelFormat getFormat() const { return pixelFormat_; }
+    // texExternal is a GL_TEXTURE_EXTERNAL_OES texture that receives decoded H.264/HEVC frames.
+    // format receives the layout of the bound frame, which can differ from getFormat() right
+    // after a reconfigure. texturesHoldFrame tells that texY and texUV still hold the last frame
+    // bound from this streamer, so that only the tiles changed since can be uploaded.
+    bool bindFrameToTextures(
+            int texY, int texUV, int texExternal, VideoPixelFormat &format, bool texturesHoldFrame);
+    // While the presenter shows something else, such as instant replay, it takes no frames and
+    // the ones replaced meanwhile are not counted as dropped. Resuming makes the next
+    // bindFrameToTextures() upload the whole stored frame again, since the textures no longer
+    // hold it and a static source may not send another.
+    void pausePresenting();
+    void resumePresenting();
+
+    void getFrameSize(int32_t &width, int32_t &height);
+
+    /** Frame interval of the negotiated mode, 0 when it is unknown. */
+    nanoseconds nominalFrameInterval() const { return nanoseconds(nominalFrameInterval_.load()); }
+
+    /** Counts successful negotiations, so that a reconfigure can be noticed. */
+    uint32_t negotiations() const { return negotiations_; }
+
+    /** Sequence number and capture time of the frame that was bound last. */
+    FrameStamp boundFrameStamp();
+
+    /**
+     * From the bmInterlaceFlags of the negotiated format, or TopFirst when a source that claims
+     * to be progressive shows combing.
+     */
+    FieldOrder fieldOrder();
+
+    // Converts the latest frame into an RGBA (R, G, B, X byte order) buffer of the given size.
+    // Not available for H.264/HEVC, whose frames only exist on the GPU.
+    bool convertFrameToRGBA(uint8_t *dst, int32_t dstStride, int32_t width, int32_t height);
+
+    /**
+     * Scales the latest frame down into an RGBA (R, G, B, X byte order) buffer of the given size
+     * with libyuv, unless stamp already names that frame, and then stamps it. scratch receives the
+     * intermediate planes, at most 12 bytes per destination pixel. Not available for H.264/HEVC.
+     */
+    bool scaleFrameToRGBA(
+            FrameStamp &stamp, uint8_t *dst, int32_t dstStride, int32_t width, int32_t height,
+            std::vector<uint8_t> &scratch);
+
+    /**
+     * Like scaleFrameToRGBA, into an NV12 buffer of the given even size: the Y plane followed by
+     * the interleaved UV plane. scratch receives at most 7 bytes per destination pixel. Only for
+     * 8-bit Y'CbCr, gray and MJPEG frames.
+     */
+    bool scaleFrameToNV12(
+            FrameStamp &stamp, uint8_t *dst, int32_t width, int32_t height, std::vector<uint8_t> &scratch);
+
+    /**
+     * Calls reader with the luma of the latest frame while it is locked, unless its UVC sequence
+     * number is sequence, which then becomes the frame's. Not available for H.264/HEVC.
+     */
+    bool readLuma(uint32_t &sequence, const std::function<void(const LumaPlane &)> &reader);
+
+    /**
+     * Mean Y, Cb and Cr code values, on an 8-bit scale, of a region of the frame with the given
+     * sequence number, while its planes are still stored. Gray sources have neutral chroma; RGB,
+     * MJPEG and H.264/HEVC frames have no planes to read.
+     */
+    std::optional<std::array<float, 3>> regionYuv(
+            uint32_t sequence, int32_t x, int32_t y, int32_t width, int32_t height);
+
+    /** Whether the source sends live video, a frozen frame or black; H.264/HEVC always count as live. */
+    SignalState signalState() const { return signalMonitor_.state(); }
+
+    /** Drops frozen and black frames before decode and upload while the signal is down. */
+    void setSkipWhileSignalDown(bool skip) { signalMonitor_.setSkipWhileDown(skip); }
+
+    // Invoked on the capture thread after each new frame is stored.
+    void setFrameListener(std::function<void()> listener);
 
 private:
+    // Negotiates width_, height_, fps_ and the format and sizes the frame buffers.
+    void negotiate();
+
+    bool openStream();
+
+    // libuvc only runs the libusb event loop itself for contexts it creates; this one runs on a
+    // thread with the UsbEvents policy.
+    void handleUsbEvents();
+
+    // Luma of the stored frame. Called with frameMutex_ held.
+    std::optional<LumaPlane> lumaPlane() const;
+
+    // Feeds the luma of the stored frame to combDetector_. Called with frameMutex_ held.
+    void detectCombing();
+
+    // Negotiates a format that libuvc has no uvc_frame_format for, by the fourcc at the start
+    // of its GUID.
+    uvc_error_t negotiateByFourcc(int32_t width, int32_t height, int32_t fps);
+
+    libusb_context *usbContext_{};
+    std::thread usbEventThread_;
+    std::atomic<bool> stopUsbEvents_{false};
     uvc_context_t *uvcContext_{};
     uvc_device_handle_t *deviceHandle_{};
     uvc_stream_ctrl_t streamCtrl_{};
     bool isStreamControlNegotiated_{false};
     uvc_stream_handle_t *streamHandle_{nullptr};
+    // libuvc assembles frames in two buffers of dwMaxVideoFrameSize per open stream. Its
+    // transfers are not counted.
+    TrackedMemory uvcFrameBuffers_;
+    // Serializes stream control between the app and the quality governor.
+    std::mutex controlMutex_;
+    bool streaming_{false};
 
     intptr_t deviceFD_;
     int32_t width_;
     int32_t height_;
     int32_t fps_;
     uvc_frame_format uvcFrameFormat_;
+    std::string fourcc_;
+    VideoPixelFormat pixelFormat_{VideoPixelFormat::RGBA};
 
     int32_t captureFrameWidth_{};
     int32_t captureFrameHeight_{};
     int32_t captureFrameFps_{};
+    std::atomic<int64_t> nominalFrameInterval_{0};
+    std::atomic<uint32_t> negotiations_{0};
     uvc_frame_format captureFrameFormat_{};
+    uint8_t interlaceFlags_{};
 
     UsbVideoStreamerStats stats_{};
+    TextureUploadStats uploadStats_{};
 
     std::mutex frameMutex_;
     bool frameUpdated_{false};
-    std::vector<uint8_t> plane0_;
-    std::vector<uint8_t> plane1_;
-    std::vector<uint8_t> rgbaBuffer_;
+    // UVC sequence number of the pending frame, the cookie of its "frame" trace slice, or the
+    // count of decoded frames.
+    uint32_t frameSequence_{};
+    steady_clock::time_point frameCaptureTime_{};
+    FrameStamp boundFrameStamp_{};
+    std::function<void()> frameListener_;
+    bool presentingPaused_{false};
+    // Only the planes of the negotiated format hold memory.
+    FrameBuffer plane0_;
+    FrameBuffer plane1_;
+    FrameBuffer rgbaBuffer_;
+    // Tiles of the NV12, YUYV and UYVY planes that changed since the last upload, which was of
+    // uploadedFormat_ at uploadedWidth_ x uploadedHeight_.
+    DirtyTiles dirtyTiles_;
+    VideoPixelFormat uploadedFormat_{VideoPixelFormat::COUNT};
+    int32_t uploadedWidth_{};
+    int32_t uploadedHeight_{};
+    MjpegDecoder mjpegDecoder_;
+    std::atomic<uint32_t> decodeScale_{1};
+    StageCounters stageCounters_{};
+    CombDetector combDetector_;
+    SignalMonitor signalMonitor_;
+    // CRC-32C and size of the last decoded MJPEG payload, and the scale it was decoded at.
+    std::optional<uint64_t> lastMjpegHash_;
+    uint32_t lastMjpegScale_{1};
+    uint32_t framesSinceCombCheck_{0};
+
+    std::unique_ptr<VideoDecoder> decoder_;
 };
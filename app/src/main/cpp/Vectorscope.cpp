@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "Vectorscope.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+
+#include "ProgramCache.h"
+#include "Trace.h"
+
+#define ULOGI(...) __android_log_print(ANDROID_LOG_INFO, "Vectorscope", __VA_ARGS__)
+#define ULOGE(...) __android_log_print(ANDROID_LOG_ERROR, "Vectorscope", __VA_ARGS__)
+
+namespace {
+
+// Resolution of the trace over the U/V plane.
+constexpr int32_t kTraceSize = 256;
+
+// Frame samples added to the trace per frame, about one per 6x6 pixels of 1080p.
+constexpr int32_t kGridWidth = 320;
+constexpr int32_t kGridHeight = 180;
+
+// Each frame keeps this much of the trace and then loses one step of the 8-bit texture, so
+// traces fade out within about half a second at 60 frames per second.
+constexpr float kDecay = 0.85f;
+constexpr float kFloor = 1.0f / 255.0f;
+// Added by every sample that lands on a trace texel.
+constexpr float kHitIntensity = 4.0f / 255.0f;
+
+// Side of the scope as a fraction of the shorter window side, and its margin in pixels.
+constexpr float kScopeFraction = 0.35f;
+constexpr int32_t kScopeMargin = 16;
+
+void bindOverlayBlock(GLuint program) {
+    // Shares the Overlay block binding of the format programs, see VideoRenderer.
+    GLuint blockIndex = glGetUniformBlockIndex(program, "Overlay");
+    if (blockIndex != GL_INVALID_INDEX) glUniformBlockBinding(program, blockIndex, 0);
+}
+
+} // namespace
+
+void VectorscopeStats::recordUpdate(nanoseconds updateGpuTime) {
+    updates++;
+    gpuTime += updateGpuTime;
+    maxGpuTime = std::max(maxGpuTime, updateGpuTime);
+
+    auto now = steady_clock::now();
+    if (now - t0 < 10s) return;
+    ULOGI("GPU vectorscope time: %u updates, avg %.3f ms, max %.3f ms",
+          updates,
+          duration<float, std::milli>(gpuTime).count() / static_cast<float>(updates),
+          duration<float, std::milli>(maxGpuTime).count());
+    *this = {};
+    t0 = now;
+}
+
+bool Vectorscope::init(ProgramCache &programCache, GLuint targetVao) {
+    scatterProgram_ = programCache.getOrCreateProgram(
+            "shaders/vectorscope_scatter_v.glsl", "shaders/vectorscope_fill_f.glsl");
+    fillProgram_ = programCache.getOrCreateProgram("shaders/video_v.glsl", "shaders/vectorscope_fill_f.glsl");
+    displayProgram_ = programCache.getOrCreateProgram("shaders/video_v.glsl", "shaders/vectorscope_f.glsl");
+    if (scatterProgram_ == 0 || fillProgram_ == 0 || displayProgram_ == 0) {
+        ULOGE("No vectorscope programs");
+        return false;
+    }
+    glUseProgram(scatterProgram_);
+    glUniform1i(glGetUniformLocation(scatterProgram_, "uFrame"), 0);
+    gridLocation_ = glGetUniformLocation(scatterProgram_, "uGrid");
+    hitIntensityLocation_ = glGetUniformLocation(scatterProgram_, "uIntensity");
+    bindOverlayBlock(fillProgram_);
+    intensityLocation_ = glGetUniformLocation(fillProgram_, "uIntensity");
+    bindOverlayBlock(displayProgram_);
+    glUseProgram(displayProgram_);
+    glUniform1i(glGetUniformLocation(displayProgram_, "uTrace"), 0);
+    pixelLocation_ = glGetUniformLocation(displayProgram_, "uPixel");
+    glUseProgram(0);
+
+    targetVao_ = targetVao;
+    glGenVertexArrays(1, &emptyVao_);
+    trace_ = {};
+    cleared_ = false;
+    gpuTimer_.init();
+    stats_ = {};
+    return true;
+}
+
+void Vectorscope::update(const RenderTarget &frame) {
+    TRACE_SECTION("vectorscope");
+    gpuTimer_.collect([this](uint32_t, nanoseconds gpuTime) { stats_.recordUpdate(gpuTime); });
+    gpuTimer_.begin(0);
+    trace_.ensureSize(kTraceSize, kTraceSize);
+    trace_.bind();
+    if (!cleared_) {
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        cleared_ = true;
+    }
+    glEnable(GL_BLEND);
+
+    // trace * kDecay - kFloor, so that the 8-bit trace also fades out where it is faint.
+    glUseProgram(fillProgram_);
+    glBindVertexArray(targetVao_);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendColor(kDecay, kDecay, kDecay, kDecay);
+    glBlendFunc(GL_ZERO, GL_CONSTANT_COLOR);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBlendEquation(GL_FUNC_REVERSE_SUBTRACT);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glUniform1f(intensityLocation_, kFloor);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glBlendEquation(GL_FUNC_ADD);
+    glUseProgram(scatterProgram_);
+    glUniform2i(gridLocation_, kGridWidth, kGridHeight);
+    glUniform1f(hitIntensityLocation_, kHitIntensity);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, frame.texture);
+    glBindVertexArray(emptyVao_);
+    glDrawArrays(GL_POINTS, 0, kGridWidth * kGridHeight);
+    glBindVertexArray(0);
+    glDisable(GL_BLEND);
+    gpuTimer_.end();
+}
+
+void Vectorscope::draw(int32_t windowWidth, int32_t windowHeight) {
+    if (!cleared_) return;
+    auto size = static_cast<int32_t>(static_cast<float>(std::min(windowWidth, windowHeight)) * kScopeFraction);
+    if (size <= 0) return;
+    glViewport(windowWidth - size - kScopeMargin, kScopeMargin, size, size);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUseProgram(displayProgram_);
+    glUniform1f(pixelLocation_, 2.0f / static_cast<float>(size));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, trace_.texture);
+    glBindVertexArray(targetVao_);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    glDisable(GL_BLEND);
+    glViewport(0, 0, windowWidth, windowHeight);
+}
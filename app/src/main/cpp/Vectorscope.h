@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <chrono>
+#include <cstdint>
+
+#include "GpuTimer.h"
+#include "RenderTarget.h"
+
+using namespace std::chrono;
+
+class ProgramCache;
+
+struct VectorscopeStats {
+    uint32_t updates = 0;
+    nanoseconds gpuTime{0ns};
+    nanoseconds maxGpuTime{0ns};
+    steady_clock::time_point t0{steady_clock::now()};
+
+    void recordUpdate(nanoseconds updateGpuTime);
+};
+
+/**
+ * Vectorscope of the shown frames, computed entirely on the GPU. For every new frame the trace,
+ * a small texture over the U/V plane, is decayed with two blend passes and the chroma of a grid
+ * of frame samples is added to it: a vertex shader reads each sample of the converted frame and
+ * places a point at its U/V position, and additive blending counts the hits. Nothing is read
+ * back to the CPU. The trace is then drawn with a graticule into the corner of the window.
+ */
+class Vectorscope final {
+public:
+    /** targetVao draws a full screen quad with texture row 0 at the bottom. */
+    bool init(ProgramCache &programCache, GLuint targetVao);
+
+    /** Adds the chroma of frame, the converted image being shown, to the trace. */
+    void update(const RenderTarget &frame);
+
+    /** Draws the scope into the bottom right corner of the window, which is bound. */
+    void draw(int32_t windowWidth, int32_t windowHeight);
+
+    /** Clears the trace, for example when the scope is turned off. */
+    void reset() { cleared_ = false; }
+
+private:
+    GLuint scatterProgram_{};
+    GLint gridLocation_{-1};
+    GLint hitIntensityLocation_{-1};
+    GLuint fillProgram_{};
+    GLint intensityLocation_{-1};
+    GLuint displayProgram_{};
+    GLint pixelLocation_{-1};
+    GLuint targetVao_{};
+    // Points are drawn without attributes, from gl_VertexID, but GLES needs a bound VAO.
+    GLuint emptyVao_{};
+    RenderTarget trace_{};
+    bool cleared_{false};
+    GpuTimer gpuTimer_{};
+    VectorscopeStats stats_{};
+};
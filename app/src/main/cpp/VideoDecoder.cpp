@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define GL_GLEXT_PROTOTYPES
+#include "VideoDecoder.h"
+
+#include <GLES2/gl2ext.h>
+#include <android/hardware_buffer.h>
+#include <android/log.h>
+#include <media/NdkMediaFormat.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "Trace.h"
+
+#define ULOGI(...) __android_log_print(ANDROID_LOG_INFO, "VideoDecoder", __VA_ARGS__)
+#define ULOGW(...) __android_log_print(ANDROID_LOG_WARN, "VideoDecoder", __VA_ARGS__)
+#define ULOGE(...) __android_log_print(ANDROID_LOG_ERROR, "VideoDecoder", __VA_ARGS__)
+
+namespace {
+
+// Decoded pictures in flight between the decoder and GL: one bound to the texture, one
+// being acquired and slack for the decoder.
+constexpr int32_t kMaxImages = 4;
+
+} // namespace
+
+void VideoDecoderStats::recordFrame(nanoseconds latency, uint32_t droppedAccessUnits) {
+    frames++;
+    latency_ += latency;
+    maxLatency_ = std::max(maxLatency_, latency);
+
+    auto now = steady_clock::now();
+    if (now - t0 < 10s) return;
+    ULOGI(
+            "Decoded %u frames, avg latency %.2f ms, max %.2f ms, input starved %u, dropped %u access units",
+            frames,
+            duration<float, std::milli>(latency_).count() / frames,
+            duration<float, std::milli>(maxLatency_).count(),
+            inputStarved,
+            droppedAccessUnits);
+    *this = {};
+    t0 = now;
+}
+
+VideoDecoder::VideoDecoder(VideoCodec codec, int32_t width, int32_t height, int32_t fps) :
+        codec_(codec),
+        width_(width),
+        height_(height),
+        fps_(fps),
+        filter_(codec) {
+}
+
+VideoDecoder::~VideoDecoder() {
+    if (mediaCodec_ != nullptr) {
+        if (started_) AMediaCodec_stop(mediaCodec_);
+        AMediaCodec_delete(mediaCodec_);
+    }
+    releaseImage();
+    if (imageReader_ != nullptr) AImageReader_delete(imageReader_);
+}
+
+bool VideoDecoder::start() {
+    if (started_) return true;
+
+    media_status_t status = AImageReader_newWithUsage(
+            width_, height_, AIMAGE_FORMAT_PRIVATE, AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE, kMaxImages,
+            &imageReader_);
+    if (status != AMEDIA_OK) {
+        ULOGE("AImageReader_newWithUsage failed %d", status);
+        return false;
+    }
+    AImageReader_ImageListener imageListener{this, onImageAvailable};
+    AImageReader_setImageListener(imageReader_, &imageListener);
+    ANativeWindow *window = nullptr;
+    AImageReader_getWindow(imageReader_, &window);
+
+    const char *mime = codec_ == VideoCodec::H264 ? "video/avc" : "video/hevc";
+    mediaCodec_ = AMediaCodec_createDecoderByType(mime);
+    if (mediaCodec_ == nullptr) {
+        ULOGE("No decoder for %s", mime);
+        return false;
+    }
+
+    AMediaFormat *format = AMediaFormat_new();
+    AMediaFormat_setString(format, AMEDIAFORMAT_KEY_MIME, mime);
+    AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_WIDTH, width_);
+    AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_HEIGHT, height_);
+    AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_FRAME_RATE, fps_);
+    AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_MAX_INPUT_SIZE, width_ * height_);
+    // Output each picture as soon as it is decoded instead of filling the reorder queue, and
+    // schedule the codec as a real time session.
+    AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_LOW_LATENCY, 1);
+    AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_PRIORITY, 0);
+    status = AMediaCodec_configure(mediaCodec_, format, window, nullptr, 0);
+    AMediaFormat_delete(format);
+    if (status != AMEDIA_OK) {
+        ULOGE("AMediaCodec_configure %s %dx%d failed %d", mime, width_, height_, status);
+        return false;
+    }
+
+    AMediaCodecOnAsyncNotifyCallback callback{onInputAvailable, onOutputAvailable, onFormatChanged, onError};
+    status = AMediaCodec_setAsyncNotifyCallback(mediaCodec_, callback, this);
+    if (status != AMEDIA_OK) {
+        ULOGE("AMediaCodec_setAsyncNotifyCallback failed %d", status);
+        return false;
+    }
+    status = AMediaCodec_start(mediaCodec_);
+    if (status != AMEDIA_OK) {
+        ULOGE("AMediaCodec_start failed %d", status);
+        return false;
+    }
+
+    char *name = nullptr;
+    if (AMediaCodec_getName(mediaCodec_, &name) == AMEDIA_OK) {
+        ULOGI("Decoding %s %dx%d with %s", mime, width_, height_, name);
+        AMediaCodec_releaseName(mediaCodec_, name);
+    }
+    started_ = true;
+    return true;
+}
+
+bool VideoDecoder::decode(const uint8_t *data, size_t size, int64_t presentationTimeUs) {
+    TRACE_SECTION("VideoDecoder::decode");
+    std::lock_guard<std::mutex> lock(inputMutex_);
+    if (!started_ || !filter_.accept(data, size)) return false;
+    TRACE_COUNTER("decode.freeInputBuffers", freeInputBuffers_.size());
+
+    if (freeInputBuffers_.empty()) {
+        // Skipping a reference picture would corrupt everything up to the next keyframe.
+        stats_.inputStarved++;
+        filter_.reset();
+        return false;
+    }
+    int32_t index = freeInputBuffers_.front();
+    freeInputBuffers_.pop_front();
+
+    size_t capacity = 0;
+    uint8_t *buffer = AMediaCodec_getInputBuffer(mediaCodec_, index, &capacity);
+    if (buffer == nullptr || capacity < size) {
+        ULOGW("Access unit of %zu bytes does not fit input buffer of %zu", size, capacity);
+        AMediaCodec_queueInputBuffer(mediaCodec_, index, 0, 0, presentationTimeUs, 0);
+        filter_.reset();
+        return false;
+    }
+    std::memcpy(buffer, data, size);
+    if (AMediaCodec_queueInputBuffer(mediaCodec_, index, 0, size, presentationTimeUs, 0) != AMEDIA_OK) return false;
+    // Keyed by the presentation time, which comes back with the decoded picture.
+    TRACE_ASYNC_BEGIN("decode", presentationTimeUs);
+    return true;
+}
+
+void VideoDecoder::setFrameListener(std::function<void()> listener) {
+    std::lock_guard<std::mutex> lock(listenerMutex_);
+    frameListener_ = std::move(listener);
+}
+
+void VideoDecoder::onImageAvailable(void *context, AImageReader *) {
+    auto *self = static_cast<VideoDecoder *>(context);
+    std::lock_guard<std::mutex> lock(self->listenerMutex_);
+    if (self->frameListener_) self->frameListener_();
+}
+
+void VideoDecoder::onInputAvailable(AMediaCodec *, void *userdata, int32_t index) {
+    auto *self = static_cast<VideoDecoder *>(userdata);
+    std::lock_guard<std::mutex> lock(self->inputMutex_);
+    self->freeInputBuffers_.push_back(index);
+}
+
+void VideoDecoder::onOutputAvailable(
+        AMediaCodec *codec, void *userdata, int32_t index, AMediaCodecBufferInfo *bufferInfo) {
+    auto *self = static_cast<VideoDecoder *>(userdata);
+    bool render = bufferInfo->size > 0 || (bufferInfo->flags & AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM) == 0;
+    AMediaCodec_releaseOutputBuffer(codec, index, render);
+    if (!render) return;
+    TRACE_ASYNC_END("decode", bufferInfo->presentationTimeUs);
+
+    // Presentation times are steady clock timestamps taken when the access unit was queued.
+    auto latency = steady_clock::now().time_since_epoch() - microseconds(bufferInfo->presentationTimeUs);
+    uint32_t dropped;
+    {
+        std::lock_guard<std::mutex> lock(self->inputMutex_);
+        dropped = self->filter_.dropped();
+    }
+    self->stats_.recordFrame(duration_cast<nanoseconds>(latency), dropped);
+}
+
+void VideoDecoder::onFormatChanged(AMediaCodec *, void *, AMediaFormat *format) {
+    ULOGI("Output format %s", AMediaFormat_toString(format));
+}
+
+void VideoDecoder::onError(AMediaCodec *, void *userdata, media_status_t error, int32_t actionCode, const char *detail) {
+    auto *self = static_cast<VideoDecoder *>(userdata);
+    ULOGE("Decoder error %d (action %d): %s", error, actionCode, detail != nullptr ? detail : "");
+    std::lock_guard<std::mutex> lock(self->inputMutex_);
+    self->filter_.reset();
+}
+
+bool VideoDecoder::bindLatestImage(GLuint texture) {
+    TRACE_SECTION("VideoDecoder::bindLatestImage");
+    if (imageReader_ == nullptr) return false;
+    AImage *image = nullptr;
+    if (AImageReader_acquireLatestImage(imageReader_, &image) != AMEDIA_OK || image == nullptr) {
+        // Nothing new; the texture still holds the previous picture.
+        return false;
+    }
+
+    AHardwareBuffer *hardwareBuffer = nullptr;
+    if (AImage_getHardwareBuffer(image, &hardwareBuffer) != AMEDIA_OK || hardwareBuffer == nullptr) {
+        AImage_delete(image);
+        return false;
+    }
+    EGLDisplay display = eglGetCurrentDisplay();
+    const EGLint attributes[] = {EGL_IMAGE_PRESERVED_KHR, EGL_TRUE, EGL_NONE};
+    EGLImageKHR eglImage = eglCreateImageKHR(
+            display, EGL_NO_CONTEXT, EGL_NATIVE_BUFFER_ANDROID,
+            eglGetNativeClientBufferANDROID(hardwareBuffer), attributes);
+    if (eglImage == EGL_NO_IMAGE_KHR) {
+        ULOGE("eglCreateImageKHR failed 0x%x", eglGetError());
+        AImage_delete(image);
+        return false;
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_EXTERNAL_OES, texture);
+    glEGLImageTargetTexture2DOES(GL_TEXTURE_EXTERNAL_OES, static_cast<GLeglImageOES>(eglImage));
+
+    // The previous picture is no longer referenced by the texture and goes back to the reader.
+    releaseImage();
+    image_ = image;
+    eglDisplay_ = display;
+    eglImage_ = eglImage;
+    return true;
+}
+
+void VideoDecoder::discardLatestImage() {
+    AImage *image = nullptr;
+    if (imageReader_ != nullptr && AImageReader_acquireLatestImage(imageReader_, &image) == AMEDIA_OK) {
+        AImage_delete(image);
+    }
+}
+
+void VideoDecoder::releaseImage() {
+    if (eglImage_ != EGL_NO_IMAGE_KHR) eglDestroyImageKHR(eglDisplay_, eglImage_);
+    eglImage_ = EGL_NO_IMAGE_KHR;
+    if (image_ != nullptr) AImage_delete(image_);
+    image_ = nullptr;
+}
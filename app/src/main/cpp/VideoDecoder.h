@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#define EGL_EGLEXT_PROTOTYPES
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+#include <media/NdkImageReader.h>
+#include <media/NdkMediaCodec.h>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include "H26xBitstream.h"
+
+using namespace std::chrono;
+
+struct VideoDecoderStats {
+    uint32_t frames = 0;
+    nanoseconds latency_{0ns};
+    nanoseconds maxLatency_{0ns};
+    uint32_t inputStarved = 0;
+    steady_clock::time_point t0{steady_clock::now()};
+
+    void recordFrame(nanoseconds latency, uint32_t droppedAccessUnits);
+};
+
+/**
+ * Decodes UVC frame based H.264/HEVC access units with the platform decoder (AMediaCodec in
+ * asynchronous, low latency mode). Pictures are rendered straight into an AImageReader and are
+ * sampled by GL as GL_TEXTURE_EXTERNAL_OES through an EGLImage, so decoded frames never reach
+ * the CPU.
+ */
+class VideoDecoder final {
+public:
+    VideoDecoder(VideoCodec codec, int32_t width, int32_t height, int32_t fps);
+
+    ~VideoDecoder();
+
+    VideoDecoder(const VideoDecoder &) = delete;
+    VideoDecoder &operator=(const VideoDecoder &) = delete;
+
+    bool start();
+
+    /**
+     * Queues one access unit. Units the decoder can't start from are dropped, and so is
+     * everything up to the next keyframe when no input buffer is free. Returns whether the unit
+     * was queued.
+     */
+    bool decode(const uint8_t *data, size_t size, int64_t presentationTimeUs);
+
+    /** Invoked on an image reader thread for every decoded picture. */
+    void setFrameListener(std::function<void()> listener);
+
+    /** Binds the newest decoded picture to texture. Must be called on the GL thread. */
+    bool bindLatestImage(GLuint texture);
+
+    /** Returns the newest decoded picture to the decoder without displaying it. */
+    void discardLatestImage();
+
+private:
+    static void onImageAvailable(void *context, AImageReader *reader);
+    static void onInputAvailable(AMediaCodec *codec, void *userdata, int32_t index);
+    static void onOutputAvailable(
+            AMediaCodec *codec, void *userdata, int32_t index, AMediaCodecBufferInfo *bufferInfo);
+    static void onFormatChanged(AMediaCodec *codec, void *userdata, AMediaFormat *format);
+    static void onError(
+            AMediaCodec *codec, void *userdata, media_status_t error, int32_t actionCode, const char *detail);
+
+    void releaseImage();
+
+    VideoCodec codec_;
+    int32_t width_;
+    int32_t height_;
+    int32_t fps_;
+
+    AMediaCodec *mediaCodec_{nullptr};
+    AImageReader *imageReader_{nullptr};
+    bool started_{false};
+
+    // Input buffer indices handed out by onInputAvailable.
+    std::mutex inputMutex_;
+    std::deque<int32_t> freeInputBuffers_;
+    AccessUnitFilter filter_;
+
+    std::mutex listenerMutex_;
+    std::function<void()> frameListener_;
+    VideoDecoderStats stats_{};
+
+    // GL thread only
+    AImage *image_{nullptr};
+    EGLDisplay eglDisplay_{EGL_NO_DISPLAY};
+    EGLImageKHR eglImage_{EGL_NO_IMAGE_KHR};
+};
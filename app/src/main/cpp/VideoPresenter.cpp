@@ -0,0 +1,650 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "VideoPresenter.h"
+
+#include <EGL/eglext.h>
+#include <android/log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <cstring>
+#include <optional>
+
+#include "ProgramCache.h"
+#include "ThreadPolicy.h"
+#include "Trace.h"
+#include "UsbVideoStreamer.h"
+
+#define ULOGI(...) __android_log_print(ANDROID_LOG_INFO, "VideoPresenter", __VA_ARGS__)
+#define ULOGE(...) __android_log_print(ANDROID_LOG_ERROR, "VideoPresenter", __VA_ARGS__)
+
+namespace {
+
+// How often the fences of probe reads are polled while the source sends no frames.
+constexpr auto kProbePollInterval = 4ms;
+
+const char *modeName(PresenterMode mode) {
+    return mode == PresenterMode::CPU_BLIT ? "cpu-blit" : "gl";
+}
+
+nanoseconds threadCpuTime() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return seconds(ts.tv_sec) + nanoseconds(ts.tv_nsec);
+}
+
+} // namespace
+
+void PresentStats::recordFrame(PresenterMode mode, nanoseconds cpuTime, nanoseconds wallTime) {
+    frames++;
+    cpuTime_ += cpuTime;
+    wallTime_ += wallTime;
+    maxWallTime_ = std::max(maxWallTime_, wallTime);
+
+    auto now = steady_clock::now();
+    if (now - t0 < 10s) return;
+    if (frames > 0) {
+        ULOGI(
+                "Present stats (%s): %u frames, avg cpu %.3f ms, avg wall %.3f ms, max wall %.3f ms",
+                modeName(mode),
+                frames,
+                duration<float, std::milli>(cpuTime_).count() / frames,
+                duration<float, std::milli>(wallTime_).count() / frames,
+                duration<float, std::milli>(maxWallTime_).count());
+    }
+    *this = {};
+    t0 = now;
+}
+
+void ReplayStats::recordFrame(uint64_t skippedFrames, nanoseconds readTime, std::optional<nanoseconds> intervalError) {
+    frames++;
+    skipped += skippedFrames;
+    readTime_ += readTime;
+    maxReadTime_ = std::max(maxReadTime_, readTime);
+    if (intervalError.has_value()) {
+        intervals++;
+        intervalError_ += *intervalError;
+        maxIntervalError_ = std::max(maxIntervalError_, *intervalError);
+    }
+    if (steady_clock::now() - t0 >= 10s) log();
+}
+
+void ReplayStats::log() {
+    if (frames > 0) {
+        ULOGI(
+                "Replay stats: %u frames, %llu skipped, read avg %.3f ms, max %.3f ms, "
+                "interval error avg %.2f ms, max %.2f ms",
+                frames,
+                static_cast<unsigned long long>(skipped),
+                duration<float, std::milli>(readTime_).count() / frames,
+                duration<float, std::milli>(maxReadTime_).count(),
+                intervals > 0 ? duration<float, std::milli>(intervalError_).count() / intervals : 0.0f,
+                duration<float, std::milli>(maxIntervalError_).count());
+    }
+    *this = {};
+}
+
+VideoPresenter::VideoPresenter(ANativeWindow *window, AAssetManager *assetManager, std::string programCacheDir) :
+        window_(window),
+        assetManager_(assetManager),
+        programCacheDir_(std::move(programCacheDir)) {
+    ANativeWindow_acquire(window_);
+}
+
+VideoPresenter::~VideoPresenter() {
+    stop();
+    setSource(nullptr);
+    ANativeWindow_release(window_);
+}
+
+void VideoPresenter::start() {
+    if (thread_.joinable()) return;
+    stopRequested_ = false;
+    thread_ = std::thread(&VideoPresenter::renderLoop, this);
+}
+
+void VideoPresenter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopRequested_ = true;
+    }
+    wakeUp_.notify_one();
+    if (thread_.joinable()) thread_.join();
+}
+
+void VideoPresenter::setSource(UsbVideoStreamer *source) {
+    std::lock_guard<std::mutex> sourceLock(sourceMutex_);
+    if (source_ != nullptr) {
+        source_->setFrameListener(nullptr);
+        if (livePaused_) source_->resumePresenting();
+    }
+    source_ = source;
+    if (source_ != nullptr) {
+        source_->setFrameListener([this] { onFrameArrived(); });
+        if (livePaused_) source_->pausePresenting();
+    }
+}
+
+void VideoPresenter::onFrameArrived() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        frameArrival_ = steady_clock::now();
+        renderRequested_ = true;
+    }
+    wakeUp_.notify_one();
+}
+
+void VideoPresenter::onSurfaceChanged() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        surfaceChanged_ = true;
+        renderRequested_ = true;
+    }
+    wakeUp_.notify_one();
+}
+
+void VideoPresenter::setShowZebra(bool showZebra) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        options_.showZebra = showZebra;
+        renderRequested_ = true;
+    }
+    wakeUp_.notify_one();
+}
+
+void VideoPresenter::setHdrMode(HdrTransfer transfer, bool toneMap) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        options_.transfer = transfer;
+        options_.toneMap = toneMap;
+        renderRequested_ = true;
+    }
+    wakeUp_.notify_one();
+}
+
+void VideoPresenter::setDeinterlaceMode(DeinterlaceMode mode) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        options_.deinterlace = mode;
+        renderRequested_ = true;
+    }
+    wakeUp_.notify_one();
+}
+
+void VideoPresenter::setScaler(ScaleFilter filter, float sharpness) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        options_.scaleFilter = filter;
+        options_.sharpness = sharpness;
+        renderRequested_ = true;
+    }
+    wakeUp_.notify_one();
+}
+
+void VideoPresenter::setDenoise(float strength) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        options_.denoise = strength;
+        renderRequested_ = true;
+    }
+    wakeUp_.notify_one();
+}
+
+void VideoPresenter::setFrameMarker(bool visible) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        options_.frameMarker = visible;
+        renderRequested_ = true;
+    }
+    wakeUp_.notify_one();
+}
+
+void VideoPresenter::setVectorscope(bool visible) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        options_.vectorscope = visible;
+        renderRequested_ = true;
+    }
+    wakeUp_.notify_one();
+}
+
+void VideoPresenter::requestProbe(const ProbeRequest &request) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        probeRequests_.push_back(request);
+        renderRequested_ = true;
+    }
+    wakeUp_.notify_one();
+}
+
+void VideoPresenter::setProbeListener(std::function<void(const ProbeResult &)> listener) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    probeListener_ = std::move(listener);
+}
+
+void VideoPresenter::setReplaySource(ReplayCache *cache) {
+    std::lock_guard<std::mutex> sourceLock(sourceMutex_);
+    replaySource_ = cache;
+}
+
+void VideoPresenter::startReplay(milliseconds back, float speed) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        replaySeek_ = back;
+        replaySpeed_ = speed;
+        replaying_ = true;
+        renderRequested_ = true;
+    }
+    wakeUp_.notify_one();
+}
+
+void VideoPresenter::setReplaySpeed(float speed) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!replaySpeed_.has_value()) return;
+        replaySpeed_ = speed;
+        renderRequested_ = true;
+    }
+    wakeUp_.notify_one();
+}
+
+void VideoPresenter::stopReplay() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        replaySpeed_.reset();
+        replaySeek_.reset();
+        replaying_ = false;
+        renderRequested_ = true;
+    }
+    wakeUp_.notify_one();
+}
+
+void VideoPresenter::setMode(PresenterMode mode) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (mode_ == mode) return;
+        mode_ = mode;
+        renderRequested_ = true;
+    }
+    wakeUp_.notify_one();
+}
+
+PresenterMode VideoPresenter::mode() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return mode_;
+}
+
+void VideoPresenter::setDisplayRefreshRates(std::vector<float> rates) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    displayRates_ = std::move(rates);
+}
+
+void VideoPresenter::requestRender() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        renderRequested_ = true;
+    }
+    wakeUp_.notify_one();
+}
+
+bool VideoPresenter::initEgl() {
+    display_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display_ == EGL_NO_DISPLAY || !eglInitialize(display_, nullptr, nullptr)) {
+        ULOGE("eglInitialize failed 0x%x", eglGetError());
+        return false;
+    }
+
+    const EGLint configAttributes[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT_KHR,
+            EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_ALPHA_SIZE, 8,
+            EGL_NONE,
+    };
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(display_, configAttributes, &config, 1, &numConfigs) || numConfigs == 0) {
+        ULOGE("eglChooseConfig failed 0x%x", eglGetError());
+        return false;
+    }
+
+    const EGLint contextAttributes[] = {EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE};
+    context_ = eglCreateContext(display_, config, EGL_NO_CONTEXT, contextAttributes);
+    if (context_ == EGL_NO_CONTEXT) {
+        ULOGE("eglCreateContext failed 0x%x", eglGetError());
+        return false;
+    }
+
+    surface_ = eglCreateWindowSurface(display_, config, window_, nullptr);
+    if (surface_ == EGL_NO_SURFACE) {
+        ULOGE("eglCreateWindowSurface failed 0x%x", eglGetError());
+        return false;
+    }
+
+    if (!eglMakeCurrent(display_, surface_, surface_, context_)) {
+        ULOGE("eglMakeCurrent failed 0x%x", eglGetError());
+        return false;
+    }
+
+    const char *extensions = eglQueryString(display_, EGL_EXTENSIONS);
+    if (extensions != nullptr && std::strstr(extensions, "EGL_ANDROID_presentation_time") != nullptr) {
+        presentationTime_ = reinterpret_cast<PFNEGLPRESENTATIONTIMEANDROIDPROC>(
+                eglGetProcAddress("eglPresentationTimeANDROID"));
+    }
+    if (presentationTime_ == nullptr) ULOGI("No EGL_ANDROID_presentation_time, frames are not paced");
+    return true;
+}
+
+void VideoPresenter::releaseEgl() {
+    if (display_ == EGL_NO_DISPLAY) return;
+    eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface_ != EGL_NO_SURFACE) eglDestroySurface(display_, surface_);
+    if (context_ != EGL_NO_CONTEXT) eglDestroyContext(display_, context_);
+    eglTerminate(display_);
+    presentationTime_ = nullptr;
+    display_ = EGL_NO_DISPLAY;
+    context_ = EGL_NO_CONTEXT;
+    surface_ = EGL_NO_SURFACE;
+}
+
+bool VideoPresenter::initGl() {
+    if (!initEgl()) return false;
+
+    auto shadersStart = steady_clock::now();
+    ProgramCache programCache(assetManager_, programCacheDir_);
+    bool ready = renderer_.init(programCache);
+    ULOGI(
+            "Shaders ready in %.2f ms (binary cache hits %u, misses %u)",
+            duration<float, std::milli>(steady_clock::now() - shadersStart).count(),
+            programCache.hits(),
+            programCache.misses());
+    return ready;
+}
+
+bool VideoPresenter::activateMode(PresenterMode mode) {
+    // A window can only be connected to one producer at a time, so the EGL surface is destroyed
+    // before the CPU path locks buffers and the buffer geometry is reset before EGL takes over.
+    if (mode == PresenterMode::CPU_BLIT) {
+        releaseEgl();
+        return true;
+    }
+    blitter_.reset(window_);
+    if (initGl()) return true;
+    releaseEgl();
+    return false;
+}
+
+bool VideoPresenter::present(
+        bool surfaceChanged, const DisplayOptions &options, std::optional<steady_clock::time_point> presentAt,
+        bool replay) {
+    if (surface_ == EGL_NO_SURFACE) {
+        std::lock_guard<std::mutex> sourceLock(sourceMutex_);
+        return blitter_.blit(window_, source_);
+    }
+
+    if (surfaceChanged) {
+        EGLint width = 0;
+        EGLint height = 0;
+        eglQuerySurface(display_, surface_, EGL_WIDTH, &width);
+        eglQuerySurface(display_, surface_, EGL_HEIGHT, &height);
+        renderer_.resize(width, height);
+    }
+    {
+        TRACE_SECTION("drawFrame");
+        std::lock_guard<std::mutex> sourceLock(sourceMutex_);
+        if (replay) {
+            renderer_.drawReplay(replayBuffer_.data(), replayFrame_.width, replayFrame_.height, options);
+        } else {
+            renderer_.drawFrame(source_, options);
+        }
+    }
+    if (presentAt.has_value() && presentationTime_ != nullptr) {
+        // steady_clock is CLOCK_MONOTONIC, the clock of presentation times.
+        presentationTime_(display_, surface_, duration_cast<nanoseconds>(presentAt->time_since_epoch()).count());
+    }
+    TRACE_SECTION("eglSwapBuffers");
+    if (!eglSwapBuffers(display_, surface_)) {
+        ULOGE("eglSwapBuffers failed 0x%x", eglGetError());
+        return false;
+    }
+    return true;
+}
+
+std::optional<steady_clock::time_point> VideoPresenter::collectProbes(
+        const std::function<void(const ProbeResult &)> &listener) {
+    bool reading = renderer_.collectProbes([&listener](const ProbeResult &result) {
+        if (listener) listener(result);
+    });
+    if (!reading) return std::nullopt;
+    return steady_clock::now() + kProbePollInterval;
+}
+
+bool VideoPresenter::advanceReplay(std::optional<nanoseconds> seek, float speed) {
+    std::lock_guard<std::mutex> sourceLock(sourceMutex_);
+    if (replaySource_ == nullptr) return false;
+    auto span = replaySource_->span();
+    if (!span.has_value()) return false;
+    auto now = steady_clock::now();
+    if (seek.has_value()) {
+        if (!livePaused_ && source_ != nullptr) source_->pausePresenting();
+        livePaused_ = true;
+        replayPosition_ = std::max(span->first, span->second - *seek);
+        replayFrame_ = {};
+        replayShownAt_.reset();
+    } else if (replayPosition_.has_value()) {
+        *replayPosition_ += duration_cast<nanoseconds>((now - replayMovedAt_) * speed);
+    } else {
+        return false;
+    }
+    replayMovedAt_ = now;
+    if (speed > 0.0f && *replayPosition_ >= span->second) return false;
+    // Frames behind the position may have been dropped from the cache meanwhile.
+    replayPosition_ = std::clamp(*replayPosition_, span->first, span->second);
+
+    replayBuffer_.resize(ReplayCache::kMaxFrameBytes);
+    ReplayFrame previous = replayFrame_;
+    auto readStart = steady_clock::now();
+    if (replaySource_->read(*replayPosition_, replayFrame_, replayBuffer_.data())) {
+        nanoseconds readTime = steady_clock::now() - readStart;
+        uint64_t skipped = 0;
+        std::optional<nanoseconds> intervalError;
+        if (previous.serial != 0) {
+            uint64_t step = replayFrame_.serial > previous.serial ? replayFrame_.serial - previous.serial
+                                                                  : previous.serial - replayFrame_.serial;
+            skipped = step - 1;
+            if (replayShownAt_.has_value() && speed != 0.0f) {
+                auto captured = duration<float>(replayFrame_.stamp.captured - previous.stamp.captured);
+                auto expected = duration_cast<nanoseconds>(captured / std::abs(speed));
+                intervalError = abs((now - *replayShownAt_) - expected);
+            }
+        }
+        replayShownAt_ = now;
+        replayStats_.recordFrame(skipped, readTime, intervalError);
+    }
+
+    // Sleeps until the position reaches the capture time of the next frame.
+    replayDueAt_.reset();
+    if (speed != 0.0f) {
+        if (auto change = replaySource_->nextChange(*replayPosition_, speed > 0.0f)) {
+            nanoseconds ahead = speed > 0.0f ? *change - *replayPosition_ : *replayPosition_ - *change + 1ns;
+            replayDueAt_ = now + duration_cast<nanoseconds>(ahead / std::abs(speed));
+        }
+    }
+    return true;
+}
+
+void VideoPresenter::endReplay() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (replaySeek_.has_value()) return;
+        replaySpeed_.reset();
+        replaying_ = false;
+    }
+    replayPosition_.reset();
+    replayDueAt_.reset();
+    {
+        std::lock_guard<std::mutex> sourceLock(sourceMutex_);
+        if (livePaused_ && source_ != nullptr) source_->resumePresenting();
+        livePaused_ = false;
+    }
+    replayStats_.log();
+    ULOGI("Back to live video");
+}
+
+void VideoPresenter::renderLoop() {
+    applyThreadPolicy(ThreadRole::Render);
+
+    std::optional<PresenterMode> activeMode;
+    // When the second field of an interlaced frame is due, and when it is to be shown; a new
+    // frame replaces it.
+    std::optional<steady_clock::time_point> nextFieldAt;
+    std::optional<steady_clock::time_point> nextFieldPresentAt;
+    // While probes are being read back, when to poll them again without drawing.
+    std::optional<steady_clock::time_point> probePollAt;
+    std::function<void(const ProbeResult &)> probeListener;
+    // Source and mode the cadence measures, which starts over when either changes.
+    const UsbVideoStreamer *cadenceSource = nullptr;
+    uint32_t cadenceNegotiations = 0;
+    while (true) {
+        bool surfaceChanged;
+        DisplayOptions options;
+        PresenterMode mode;
+        std::optional<steady_clock::time_point> arrival;
+        std::optional<std::vector<float>> displayRates;
+        std::vector<ProbeRequest> probes;
+        std::optional<float> replaySpeed;
+        std::optional<nanoseconds> replaySeek;
+        bool pollOnly;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            auto ready = [this] { return stopRequested_ || renderRequested_; };
+            std::optional<steady_clock::time_point> wakeAt = nextFieldAt;
+            for (const auto &at : {probePollAt, replayDueAt_}) {
+                if (at.has_value() && (!wakeAt.has_value() || *at < *wakeAt)) wakeAt = at;
+            }
+            if (wakeAt.has_value()) {
+                wakeUp_.wait_until(lock, *wakeAt, ready);
+            } else {
+                wakeUp_.wait(lock, ready);
+            }
+            if (stopRequested_) break;
+            if (probePollAt.has_value() || !probeRequests_.empty()) probeListener = probeListener_;
+            // Woken only to poll the probes, with nothing to draw.
+            auto due = [now = steady_clock::now()](const std::optional<steady_clock::time_point> &at) {
+                return at.has_value() && now >= *at;
+            };
+            pollOnly = !renderRequested_ && !due(nextFieldAt) && !due(replayDueAt_);
+            if (!pollOnly) {
+                nextFieldAt.reset();
+                surfaceChanged = surfaceChanged_;
+                options = options_;
+                mode = mode_;
+                arrival = frameArrival_;
+                displayRates.swap(displayRates_);
+                probes.swap(probeRequests_);
+                replaySpeed = replaySpeed_;
+                replaySeek.swap(replaySeek_);
+                surfaceChanged_ = false;
+                renderRequested_ = false;
+                frameArrival_.reset();
+            }
+        }
+        if (pollOnly) {
+            probePollAt = activeMode == PresenterMode::GL ? collectProbes(probeListener) : std::nullopt;
+            continue;
+        }
+
+        if (displayRates.has_value()) cadence_.setDisplayRates(std::move(*displayRates));
+        {
+            std::lock_guard<std::mutex> sourceLock(sourceMutex_);
+            uint32_t negotiations = source_ != nullptr ? source_->negotiations() : 0;
+            if (source_ != cadenceSource || negotiations != cadenceNegotiations) {
+                cadence_.reset(source_ != nullptr ? source_->nominalFrameInterval() : 0ns);
+                cadenceSource = source_;
+                cadenceNegotiations = negotiations;
+            }
+        }
+        std::optional<steady_clock::time_point> presentAt;
+        if (arrival.has_value()) {
+            presentAt = cadence_.schedule(*arrival);
+            nextFieldPresentAt.reset();
+        } else {
+            presentAt = nextFieldPresentAt;
+            nextFieldPresentAt.reset();
+        }
+        if (auto rate = cadence_.takeDisplayRateChange()) {
+            ANativeWindow_setFrameRate(window_, *rate, ANATIVEWINDOW_FRAME_RATE_COMPATIBILITY_FIXED_SOURCE);
+        }
+
+        if (activeMode != mode && !activateMode(mode)) {
+            // Only GL can fail to come up; the CPU path needs nothing but the window, so the
+            // video keeps showing without overlays instead of freezing.
+            ULOGE("Presenting with %s failed, falling back to %s", modeName(mode), modeName(PresenterMode::CPU_BLIT));
+            mode = PresenterMode::CPU_BLIT;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                mode_ = mode;
+            }
+            if (activeMode != mode) activateMode(mode);
+        }
+        if (activeMode != mode) {
+            ULOGI("Presenting with %s", modeName(mode));
+            activeMode = mode;
+            surfaceChanged = true;
+            stats_ = {};
+        }
+        if (mode == PresenterMode::GL) {
+            for (const ProbeRequest &probe : probes) renderer_.requestProbe(probe);
+        }
+        bool replay = false;
+        if (replaySpeed.has_value()) {
+            replay = mode == PresenterMode::GL && advanceReplay(replaySeek, *replaySpeed);
+            if (!replay) endReplay();
+            // Replay frames are shown as soon as they are due.
+            if (replay) presentAt.reset();
+        } else if (replayPosition_.has_value()) {
+            endReplay();
+        }
+
+        TRACE_SECTION("renderFrame");
+        auto cpuStart = threadCpuTime();
+        auto wallStart = steady_clock::now();
+        if (present(surfaceChanged, options, presentAt, replay)) {
+            auto wallTime = steady_clock::now() - wallStart;
+            stats_.recordFrame(mode, threadCpuTime() - cpuStart, wallTime);
+            TRACE_COUNTER("render.frameTimeUs", duration_cast<microseconds>(wallTime).count());
+        }
+        if (mode == PresenterMode::GL) {
+            probePollAt = collectProbes(probeListener);
+            if (auto delay = renderer_.nextFieldDelay()) {
+                nextFieldAt = wallStart + *delay;
+                if (presentAt.has_value()) nextFieldPresentAt = *presentAt + *delay;
+            }
+            cadence_.setFieldsPerFrame(renderer_.deinterlacing() ? 2 : 1);
+        } else {
+            probePollAt.reset();
+        }
+    }
+
+    // Leaves the refresh rate to the rest of the system again.
+    ANativeWindow_setFrameRate(window_, 0.0f, ANATIVEWINDOW_FRAME_RATE_COMPATIBILITY_DEFAULT);
+    releaseEgl();
+    blitter_.reset(window_);
+}
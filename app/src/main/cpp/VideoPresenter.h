@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <android/asset_manager.h>
+#include <android/native_window.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CpuFrameBlitter.h"
+#include "FrameCadence.h"
+#include "ReplayCache.h"
+#include "VideoRenderer.h"
+
+class UsbVideoStreamer;
+
+// Must be kept in sync with PresenterMode in UsbVideoNativeLibrary.kt.
+enum class PresenterMode : int {
+    GL = 0,
+    CPU_BLIT = 1,
+};
+
+struct PresentStats {
+    uint32_t frames = 0;
+    nanoseconds cpuTime_{0ns};
+    nanoseconds wallTime_{0ns};
+    nanoseconds maxWallTime_{0ns};
+    steady_clock::time_point t0{steady_clock::now()};
+
+    void recordFrame(PresenterMode mode, nanoseconds cpuTime, nanoseconds wallTime);
+};
+
+// Smoothness of instant replay: how far the time between two replay frames strays from the time
+// between their captures at the replay speed, and how long reading them from the cache takes.
+struct ReplayStats {
+    uint32_t frames = 0;
+    // Cached frames passed over between two shown ones.
+    uint64_t skipped = 0;
+    uint32_t intervals = 0;
+    nanoseconds intervalError_{0ns};
+    nanoseconds maxIntervalError_{0ns};
+    nanoseconds readTime_{0ns};
+    nanoseconds maxReadTime_{0ns};
+    steady_clock::time_point t0{steady_clock::now()};
+
+    void recordFrame(uint64_t skippedFrames, nanoseconds readTime, std::optional<nanoseconds> intervalError);
+    void log();
+};
+
+/**
+ * Presents frames of a UsbVideoStreamer on an ANativeWindow from a dedicated render thread. The
+ * thread sleeps until the capture callback reports a new frame (or the surface, mode or overlay
+ * state changes), so nothing is drawn while the source is idle.
+ *
+ * The window's frame rate is set to the refresh rate that fits the source best, and in GL mode
+ * frames get presentation times on an even cadence instead of going out as they arrive.
+ *
+ * In GL mode the thread owns an EGL context and draws through VideoRenderer; in CPU blit mode
+ * frames are converted straight into the window buffers and GL is not used at all (overlays are
+ * GL only).
+ */
+class VideoPresenter final {
+public:
+    VideoPresenter(ANativeWindow *window, AAssetManager *assetManager, std::string programCacheDir);
+
+    ~VideoPresenter();
+
+    VideoPresenter(const VideoPresenter &) = delete;
+    VideoPresenter &operator=(const VideoPresenter &) = delete;
+
+    void start();
+
+    void stop();
+
+    /** Switches the frame source; blocks until a frame being drawn from the old one is done. */
+    void setSource(UsbVideoStreamer *source);
+
+    void onSurfaceChanged();
+
+    void setShowZebra(bool showZebra);
+
+    void setHdrMode(HdrTransfer transfer, bool toneMap);
+
+    void setDeinterlaceMode(DeinterlaceMode mode);
+
+    void setScaler(ScaleFilter filter, float sharpness);
+
+    void setDenoise(float strength);
+
+    void setFrameMarker(bool visible);
+
+    void setVectorscope(bool visible);
+
+    /**
+     * Reads back a region of the next frame; the result reaches the probe listener on the
+     * render thread a frame or so later. Only served by the GL mode.
+     */
+    void requestProbe(const ProbeRequest &request);
+
+    void setProbeListener(std::function<void(const ProbeResult &)> listener);
+
+    /** Switches the replay cache; blocks until a replay frame being read from the old one is done. */
+    void setReplaySource(ReplayCache *cache);
+
+    /**
+     * Replays the cache from back before its newest frame at speed, which plays backwards when
+     * negative and pauses at 0. Live video returns once playing forwards catches up with the
+     * newest frame. Only served by the GL mode.
+     */
+    void startReplay(milliseconds back, float speed);
+
+    void setReplaySpeed(float speed);
+
+    void stopReplay();
+
+    bool replaying() const { return replaying_; }
+
+    void setMode(PresenterMode mode);
+
+    /** The mode last set, or CPU_BLIT once GL failed to start in place of it. */
+    PresenterMode mode();
+
+    /** Refresh rates the display supports, from which the cadence picks one for the source. */
+    void setDisplayRefreshRates(std::vector<float> rates);
+
+    void requestRender();
+
+private:
+    void renderLoop();
+    bool initGl();
+    bool initEgl();
+    void releaseEgl();
+    bool activateMode(PresenterMode mode);
+    bool present(
+            bool surfaceChanged, const DisplayOptions &options, std::optional<steady_clock::time_point> presentAt,
+            bool replay);
+    void onFrameArrived();
+    // Reports finished probes, and returns when to poll again while others are being read.
+    std::optional<steady_clock::time_point> collectProbes(const std::function<void(const ProbeResult &)> &listener);
+    // Moves the replay position on by the time since it last moved, or to seek before the newest
+    // frame, and reads the frame there; returns false when live video is to be shown instead.
+    bool advanceReplay(std::optional<nanoseconds> seek, float speed);
+    // Returns to live video unless another replay was started meanwhile.
+    void endReplay();
+
+    ANativeWindow *window_;
+    AAssetManager *assetManager_;
+    std::string programCacheDir_;
+
+    EGLDisplay display_{EGL_NO_DISPLAY};
+    EGLContext context_{EGL_NO_CONTEXT};
+    EGLSurface surface_{EGL_NO_SURFACE};
+    VideoRenderer renderer_{};
+    CpuFrameBlitter blitter_{};
+    PresentStats stats_{};
+    FrameCadence cadence_{};
+    // From EGL_ANDROID_presentation_time, null without it.
+    PFNEGLPRESENTATIONTIMEANDROIDPROC presentationTime_{};
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wakeUp_;
+    bool stopRequested_{false};
+    bool renderRequested_{true};
+    bool surfaceChanged_{true};
+    DisplayOptions options_{};
+    PresenterMode mode_{PresenterMode::GL};
+    // Capture time of a frame that has not been presented yet.
+    std::optional<steady_clock::time_point> frameArrival_;
+    std::optional<std::vector<float>> displayRates_;
+    std::vector<ProbeRequest> probeRequests_;
+    std::function<void(const ProbeResult &)> probeListener_;
+    // Set while replaying; replaySeek_ holds a jump back from the newest frame until it is taken.
+    std::optional<float> replaySpeed_;
+    std::optional<nanoseconds> replaySeek_;
+    std::atomic<bool> replaying_{false};
+
+    // Only used by the render thread: the replay position on the capture clock, when it last
+    // moved, when the next frame is due, and the frame shown with its contents.
+    std::optional<steady_clock::time_point> replayPosition_;
+    steady_clock::time_point replayMovedAt_{};
+    std::optional<steady_clock::time_point> replayDueAt_;
+    std::optional<steady_clock::time_point> replayShownAt_;
+    ReplayFrame replayFrame_{};
+    std::vector<uint8_t> replayBuffer_;
+    ReplayStats replayStats_{};
+
+    // Held while drawing so the source can't be destroyed under the render thread.
+    std::mutex sourceMutex_;
+    UsbVideoStreamer *source_{nullptr};
+    ReplayCache *replaySource_{nullptr};
+    // Set from the start of a replay until it ends, while source_ is told it is not presented.
+    bool livePaused_{false};
+};
@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "VideoRenderer.h"
+
+#include <GLES2/gl2ext.h>
+#include <android/log.h>
+
+#include <algorithm>
+
+#include "ProgramCache.h"
+#include "RenderTarget.h"
+#include "Trace.h"
+#include "UsbVideoStreamer.h"
+
+#define ULOGI(...) __android_log_print(ANDROID_LOG_INFO, "VideoRenderer", __VA_ARGS__)
+#define ULOGE(...) __android_log_print(ANDROID_LOG_ERROR, "VideoRenderer", __VA_ARGS__)
+
+namespace {
+
+// Interleaved position (x, y) and texture coordinate (u, v) of a full screen triangle strip.
+constexpr GLfloat kQuadVertices[] = {
+        -1.0f, -1.0f, 0.0f, 1.0f,
+        1.0f, -1.0f, 1.0f, 1.0f,
+        -1.0f, 1.0f, 0.0f, 0.0f,
+        1.0f, 1.0f, 1.0f, 0.0f,
+};
+
+// The same quad for render targets, whose row 0 is at the bottom.
+constexpr GLfloat kTargetQuadVertices[] = {
+        -1.0f, -1.0f, 0.0f, 0.0f,
+        1.0f, -1.0f, 1.0f, 0.0f,
+        -1.0f, 1.0f, 0.0f, 1.0f,
+        1.0f, 1.0f, 1.0f, 1.0f,
+};
+
+enum class TextureLayout {
+    Single,
+    // Chroma plane bound to texture unit 1
+    Biplanar,
+    // Decoder output bound to GL_TEXTURE_EXTERNAL_OES
+    External,
+};
+
+struct FormatProgram {
+    VideoPixelFormat format;
+    const char *fragmentAsset;
+    const char *defines;
+    TextureLayout layout;
+};
+
+// Indexed by VideoPixelFormat.
+constexpr FormatProgram kFormatPrograms[] = {
+        {VideoPixelFormat::RGBA, "shaders/video_rgba_f.glsl", "", TextureLayout::Single},
+        {VideoPixelFormat::NV12, "shaders/video_nv12_f.glsl", "", TextureLayout::Biplanar},
+        {VideoPixelFormat::YUYV, "shaders/video_yuv422_f.glsl", "", TextureLayout::Single},
+        {VideoPixelFormat::P010, "shaders/video_p010_f.glsl", "", TextureLayout::Biplanar},
+        {VideoPixelFormat::UYVY, "shaders/video_yuv422_f.glsl", "#define UYVY\n", TextureLayout::Single},
+        {VideoPixelFormat::I420, "shaders/video_yuv420p_f.glsl", "", TextureLayout::Single},
+        {VideoPixelFormat::YV12, "shaders/video_yuv420p_f.glsl", "#define YV12\n", TextureLayout::Single},
+        {VideoPixelFormat::RGB24, "shaders/video_rgba_f.glsl", "", TextureLayout::Single},
+        {VideoPixelFormat::BGR24, "shaders/video_rgba_f.glsl", "#define BGR\n", TextureLayout::Single},
+        {VideoPixelFormat::GRAY8, "shaders/video_rgba_f.glsl", "#define GRAY\n", TextureLayout::Single},
+        {VideoPixelFormat::Y16, "shaders/video_y16_f.glsl", "", TextureLayout::Single},
+        {VideoPixelFormat::H264, "shaders/video_external_f.glsl", "", TextureLayout::External},
+        {VideoPixelFormat::HEVC, "shaders/video_external_f.glsl", "", TextureLayout::External},
+};
+
+static_assert(std::size(kFormatPrograms) == static_cast<size_t>(VideoPixelFormat::COUNT));
+
+constexpr GLuint kPositionLocation = 0;
+constexpr GLuint kTexCoordLocation = 1;
+
+// Bounds of the measured frame interval that spaces the fields of interlaced frames.
+constexpr nanoseconds kMinFrameInterval = 8ms;
+constexpr nanoseconds kMaxFrameInterval = 50ms;
+
+const char *deinterlaceModeName(DeinterlaceMode mode) {
+    return mode == DeinterlaceMode::BOB ? "bob" : "motion adaptive";
+}
+
+GLuint createQuad(const GLfloat (&vertices)[16], GLuint &vbo) {
+    GLuint vao = 0;
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(kPositionLocation);
+    glVertexAttribPointer(kPositionLocation, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), nullptr);
+    glEnableVertexAttribArray(kTexCoordLocation);
+    glVertexAttribPointer(
+            kTexCoordLocation, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat),
+            reinterpret_cast<const void *>(2 * sizeof(GLfloat)));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return vao;
+}
+
+GLuint createTexture(GLenum target = GL_TEXTURE_2D) {
+    GLuint tex = 0;
+    glGenTextures(1, &tex);
+    glBindTexture(target, tex);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return tex;
+}
+
+} // namespace
+
+bool VideoRenderer::init(ProgramCache &programCache) {
+    for (const FormatProgram &entry: kFormatPrograms) {
+        GLuint program = programCache.getOrCreateProgram("shaders/video_v.glsl", entry.fragmentAsset, entry.defines);
+        if (program == 0) {
+            ULOGE("No program for %s", videoPixelFormatName(entry.format));
+            return false;
+        }
+        programs_[static_cast<size_t>(entry.format)] = program;
+    }
+    deinterlaceProgram_ = programCache.getOrCreateProgram("shaders/video_v.glsl", "shaders/deinterlace_f.glsl");
+    if (deinterlaceProgram_ == 0) {
+        ULOGE("No deinterlace program");
+        return false;
+    }
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    // Rows of the packed 24-bit and planar formats are not always 4-byte aligned.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    texY_ = createTexture();
+    texUV_ = createTexture();
+    texExternal_ = createTexture(GL_TEXTURE_EXTERNAL_OES);
+    boundFormat_ = VideoPixelFormat::RGBA;
+    boundStreamer_ = nullptr;
+
+    vao_ = createQuad(kQuadVertices, vbo_);
+    targetVao_ = createQuad(kTargetQuadVertices, targetVbo_);
+    frames_ = {};
+    deinterlaced_ = {};
+    converted_ = {};
+    frameWidth_ = 0;
+    frameHeight_ = 0;
+    deinterlacing_ = false;
+    secondFieldPending_ = false;
+    if (!denoiser_.init(programCache, targetVao_)) return false;
+    if (!scaler_.init(programCache, targetVao_, vao_)) return false;
+    if (!frameMarker_.init(programCache, vao_)) return false;
+    if (!vectorscope_.init(programCache, targetVao_)) return false;
+    probe_.init();
+
+    overlay_ = {};
+    for (int i = 0; i < 4; i++) overlay_.mvp[i * 5] = 1.0f;
+    glGenBuffers(1, &overlayUbo_);
+    glBindBuffer(GL_UNIFORM_BUFFER, overlayUbo_);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(OverlayParams), &overlay_, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, kOverlayBlockBinding, overlayUbo_);
+
+    // Sampler units never change, so they are assigned once instead of on every draw.
+    for (const FormatProgram &entry: kFormatPrograms) {
+        configureProgram(programs_[static_cast<size_t>(entry.format)], 0, entry.layout == TextureLayout::Biplanar ? 1 : -1);
+    }
+    configureProgram(deinterlaceProgram_, -1, -1);
+    glUseProgram(deinterlaceProgram_);
+    glUniform1i(glGetUniformLocation(deinterlaceProgram_, "uCurrent"), 0);
+    glUniform1i(glGetUniformLocation(deinterlaceProgram_, "uPrevious"), 1);
+    fieldParityLocation_ = glGetUniformLocation(deinterlaceProgram_, "uFieldParity");
+    weaveFromPreviousLocation_ = glGetUniformLocation(deinterlaceProgram_, "uWeaveFromPrevious");
+    motionAdaptiveLocation_ = glGetUniformLocation(deinterlaceProgram_, "uMotionAdaptive");
+    glUseProgram(0);
+    startTime_ = steady_clock::now();
+    return true;
+}
+
+void VideoRenderer::configureProgram(GLuint program, GLint textureUnitY, GLint textureUnitUV) {
+    GLuint blockIndex = glGetUniformBlockIndex(program, "Overlay");
+    if (blockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program, blockIndex, kOverlayBlockBinding);
+    }
+    glUseProgram(program);
+    GLint location = glGetUniformLocation(program, "uTextureY");
+    if (location < 0) location = glGetUniformLocation(program, "uTextureRGBA");
+    if (location >= 0 && textureUnitY >= 0) glUniform1i(location, textureUnitY);
+    location = glGetUniformLocation(program, "uTextureUV");
+    if (location >= 0 && textureUnitUV >= 0) glUniform1i(location, textureUnitUV);
+    glUseProgram(0);
+}
+
+void VideoRenderer::resize(int32_t width, int32_t height) {
+    viewportWidth_ = width;
+    viewportHeight_ = height;
+    glViewport(0, 0, width, height);
+}
+
+void VideoRenderer::updateOverlay(const DisplayOptions &options) {
+    // The animation time is only sampled by the zebra pattern, so without it the block stays
+    // unchanged and is not re-uploaded.
+    float time = options.showZebra ? duration<float, std::milli>(steady_clock::now() - startTime_).count() : 0.0f;
+    int32_t zebra = options.showZebra ? 1 : 0;
+    auto transfer = static_cast<int32_t>(options.transfer);
+    int32_t toneMap = options.toneMap ? 1 : 0;
+    if (overlay_.time == time && overlay_.showZebra == zebra &&
+        overlay_.transfer == transfer && overlay_.toneMap == toneMap) {
+        return;
+    }
+    overlay_.time = time;
+    overlay_.showZebra = zebra;
+    overlay_.transfer = transfer;
+    overlay_.toneMap = toneMap;
+    glBindBuffer(GL_UNIFORM_BUFFER, overlayUbo_);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(OverlayParams), &overlay_);
+}
+
+void VideoRenderer::drawFrame(UsbVideoStreamer *streamer, const DisplayOptions &options) {
+    // When no new frame arrived, the textures still hold the previous one and are drawn again
+    // to avoid flickering.
+    bool newFrame = false;
+    FieldOrder fieldOrder = FieldOrder::Progressive;
+    if (streamer != nullptr) {
+        newFrame = streamer->bindFrameToTextures(
+                texY_, texUV_, texExternal_, boundFormat_, streamer == boundStreamer_);
+        if (newFrame) boundStreamer_ = streamer;
+        fieldOrder = streamer->fieldOrder();
+        if (newFrame) streamer->getFrameSize(frameWidth_, frameHeight_);
+    }
+
+    DeinterlaceMode mode = options.deinterlace;
+    if (mode == DeinterlaceMode::AUTO) {
+        mode = fieldOrder == FieldOrder::Progressive ? DeinterlaceMode::OFF : DeinterlaceMode::MOTION_ADAPTIVE;
+    }
+    if (mode == DeinterlaceMode::OFF || streamer == nullptr) {
+        if (deinterlacing_) ULOGI("Deinterlacing off");
+        deinterlacing_ = false;
+        secondFieldPending_ = false;
+    }
+    ScaleFilter filter = VideoScaler::resolve(
+            options.scaleFilter, frameWidth_, frameHeight_, viewportWidth_, viewportHeight_);
+
+    bool denoising = options.denoise > 0.0f && streamer != nullptr;
+    if (!denoising) denoiser_.reset();
+    bool scope = options.vectorscope && streamer != nullptr;
+    if (!scope) vectorscope_.reset();
+    if (streamer == nullptr) probe_.reset();
+    bool probing = probe_.hasQueued();
+
+    // The stages after the format program work on an RGB copy of the frame at frame size.
+    const RenderTarget *image = nullptr;
+    // Whether image holds a frame or field that was not shown before.
+    bool newImage = newFrame;
+    if (frameWidth_ <= 0 || frameHeight_ <= 0) {
+        filter = ScaleFilter::BILINEAR;
+        denoising = false;
+        scope = false;
+        probing = false;
+    } else if (mode != DeinterlaceMode::OFF && streamer != nullptr) {
+        newImage = newFrame || secondFieldPending_ || !deinterlacing_;
+        image = &deinterlace(newFrame, fieldOrder, mode, options);
+    } else if (filter != ScaleFilter::BILINEAR || denoising || scope || probing) {
+        convertFrame(converted_, options);
+        image = &converted_;
+    }
+    if (denoising) {
+        image = &denoiser_.apply(*image, newImage, options.denoise);
+    }
+    if (scope && newImage) vectorscope_.update(*image);
+    if (probing) probe_.schedule(*image, *streamer);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, viewportWidth_, viewportHeight_);
+    glClear(GL_COLOR_BUFFER_BIT);
+    updateOverlay(options);
+    if (image == nullptr) {
+        drawSource(boundFormat_, vao_);
+    } else if (filter != ScaleFilter::BILINEAR) {
+        scaler_.draw(*image, viewportWidth_, viewportHeight_, filter, options.sharpness);
+    } else {
+        glUseProgram(programs_[static_cast<size_t>(VideoPixelFormat::RGBA)]);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, image->texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glBindVertexArray(vao_);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glBindVertexArray(0);
+    }
+    if (scope) vectorscope_.draw(viewportWidth_, viewportHeight_);
+    if (options.frameMarker && streamer != nullptr) {
+        frameMarker_.draw(streamer->boundFrameStamp(), viewportWidth_, viewportHeight_);
+    }
+}
+
+void VideoRenderer::drawReplay(const uint8_t *nv12, int32_t width, int32_t height, const DisplayOptions &options) {
+    // The unpack alignment of 1 set in init() also covers the unpadded rows of the replay frames.
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texY_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, nv12);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, texUV_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(
+            GL_TEXTURE_2D, 0, GL_RG8, width / 2, height / 2, 0, GL_RG, GL_UNSIGNED_BYTE,
+            nv12 + static_cast<size_t>(width) * height);
+
+    boundFormat_ = VideoPixelFormat::NV12;
+    boundStreamer_ = nullptr;
+    frameWidth_ = width;
+    frameHeight_ = height;
+    drawFrame(nullptr, options);
+}
+
+bool VideoRenderer::collectProbes(const std::function<void(const ProbeResult &)> &onResult) {
+    probe_.collect(onResult);
+    return probe_.reading();
+}
+
+std::optional<nanoseconds> VideoRenderer::nextFieldDelay() const {
+    if (!deinterlacing_ || !secondFieldPending_) return std::nullopt;
+    return frameInterval_ / 2;
+}
+
+void VideoRenderer::drawSource(VideoPixelFormat format, GLuint vao) {
+    const FormatProgram &entry = kFormatPrograms[static_cast<size_t>(format)];
+    glUseProgram(programs_[static_cast<size_t>(format)]);
+    glActiveTexture(GL_TEXTURE0);
+    if (entry.layout == TextureLayout::External) {
+        glBindTexture(GL_TEXTURE_EXTERNAL_OES, texExternal_);
+    } else {
+        glBindTexture(GL_TEXTURE_2D, texY_);
+    }
+    if (entry.layout == TextureLayout::Biplanar) {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, texUV_);
+    }
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+}
+
+void VideoRenderer::convertFrame(RenderTarget &target, const DisplayOptions &options) {
+    // Zebra stripes are only added when the result is displayed.
+    target.ensureSize(frameWidth_, frameHeight_);
+    target.bind();
+    DisplayOptions sourceOptions = options;
+    sourceOptions.showZebra = false;
+    updateOverlay(sourceOptions);
+    drawSource(boundFormat_, targetVao_);
+}
+
+const RenderTarget &VideoRenderer::deinterlace(
+        bool newFrame, FieldOrder fieldOrder, DeinterlaceMode mode, const DisplayOptions &options) {
+    TRACE_SECTION("deinterlace");
+    bool restarted = !deinterlacing_;
+    if (restarted) {
+        ULOGI("Deinterlacing %s, %s field first", deinterlaceModeName(mode),
+              fieldOrder == FieldOrder::BottomFirst ? "bottom" : "top");
+        deinterlacing_ = true;
+        // The textures still hold the last frame, which is converted again.
+        newFrame = true;
+    }
+
+    if (newFrame) {
+        auto now = steady_clock::now();
+        if (lastFrameTime_ != steady_clock::time_point{}) {
+            frameInterval_ = std::clamp<nanoseconds>(now - lastFrameTime_, kMinFrameInterval, kMaxFrameInterval);
+        }
+        lastFrameTime_ = now;
+
+        // Converted at frame size, so the fields are taken apart on frame rows and not on
+        // display rows.
+        const RenderTarget &previous = frames_[currentFrame_];
+        hasPreviousFrame_ = !restarted && previous.width == frameWidth_ && previous.height == frameHeight_;
+        currentFrame_ ^= 1;
+        convertFrame(frames_[currentFrame_], options);
+
+        secondField_ = false;
+        secondFieldPending_ = true;
+    } else if (secondFieldPending_) {
+        secondField_ = true;
+        secondFieldPending_ = false;
+    }
+
+    const RenderTarget &current = frames_[currentFrame_];
+    const RenderTarget &previous = frames_[currentFrame_ ^ 1];
+    deinterlaced_.ensureSize(current.width, current.height);
+    deinterlaced_.bind();
+    glUseProgram(deinterlaceProgram_);
+    bool topField = (fieldOrder != FieldOrder::BottomFirst) != secondField_;
+    glUniform1i(fieldParityLocation_, topField ? 0 : 1);
+    glUniform1i(weaveFromPreviousLocation_, secondField_ ? 0 : 1);
+    // Bob until there is a previous frame to compare with.
+    glUniform1i(motionAdaptiveLocation_, mode == DeinterlaceMode::MOTION_ADAPTIVE && hasPreviousFrame_ ? 1 : 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, current.texture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, previous.texture);
+    glBindVertexArray(targetVao_);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    return deinterlaced_;
+}
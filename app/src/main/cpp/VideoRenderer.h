@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+#include "FrameMarker.h"
+#include "PixelProbe.h"
+#include "RenderTarget.h"
+#include "TemporalDenoiser.h"
+#include "UsbVideoStreamer.h"
+#include "Vectorscope.h"
+#include "VideoScaler.h"
+
+using namespace std::chrono;
+
+class ProgramCache;
+
+// Transfer function of 10-bit sources. Must be kept in sync with HdrTransfer in
+// UsbVideoNativeLibrary.kt.
+enum class HdrTransfer : int32_t {
+    SDR = 0,
+    PQ = 1,
+    HLG = 2,
+};
+
+// Must be kept in sync with DeinterlaceMode in UsbVideoNativeLibrary.kt.
+enum class DeinterlaceMode : int32_t {
+    // MotionAdaptive for sources that are flagged or detected as interlaced
+    AUTO = 0,
+    OFF = 1,
+    BOB = 2,
+    MOTION_ADAPTIVE = 3,
+};
+
+struct DisplayOptions {
+    bool showZebra{false};
+    HdrTransfer transfer{HdrTransfer::SDR};
+    // Compresses HDR highlights into SDR range instead of clipping them at SDR reference white.
+    bool toneMap{true};
+    DeinterlaceMode deinterlace{DeinterlaceMode::AUTO};
+    ScaleFilter scaleFilter{ScaleFilter::AUTO};
+    // Strength of the unsharp mask of the bicubic and Lanczos scalers, 0 for none.
+    float sharpness{0.0f};
+    // Strength of the temporal denoiser, 0 for off.
+    float denoise{0.0f};
+    // Burns the sequence number and capture time of each frame into the window.
+    bool frameMarker{false};
+    bool vectorscope{false};
+};
+
+/**
+ * Draws the latest frame of a UsbVideoStreamer on the GL context that is current on the calling
+ * thread. Every method must be called on that thread.
+ *
+ * GL objects are not deleted on destruction: the renderer is dropped together with its context,
+ * and names from a lost context may already be reused by a new one.
+ */
+class VideoRenderer final {
+public:
+    /** Builds the program of every VideoPixelFormat through programCache. */
+    bool init(ProgramCache &programCache);
+
+    void resize(int32_t width, int32_t height);
+
+    void drawFrame(UsbVideoStreamer *streamer, const DisplayOptions &options);
+
+    /**
+     * Draws a frame of instant replay: an NV12 buffer of the given even size, the Y plane followed
+     * by the interleaved UV plane. The frame replaces that of the streamer in the textures, so
+     * the next drawFrame uploads a whole frame; overlays that need a live frame are left out.
+     */
+    void drawReplay(const uint8_t *nv12, int32_t width, int32_t height, const DisplayOptions &options);
+
+    /**
+     * Interlaced frames are shown one field at a time, at twice the frame rate. After the first
+     * field of a frame was drawn this is the delay after which drawFrame should be called again
+     * for the second one.
+     */
+    std::optional<nanoseconds> nextFieldDelay() const;
+
+    bool deinterlacing() const { return deinterlacing_; }
+
+    /** Probes a region of the next frame that is drawn, see PixelProbe. */
+    void requestProbe(const ProbeRequest &request) { probe_.request(request); }
+
+    /** Reports the probes that were read back; returns whether others are still being read. */
+    bool collectProbes(const std::function<void(const ProbeResult &)> &onResult);
+
+private:
+    // Mirrors the std140 "Overlay" uniform block shared by all video shaders.
+    struct OverlayParams {
+        float mvp[16];
+        float time;
+        int32_t showZebra;
+        int32_t transfer;
+        int32_t toneMap;
+    };
+
+    static constexpr GLuint kOverlayBlockBinding = 0;
+
+    void configureProgram(GLuint program, GLint textureUnitY, GLint textureUnitUV);
+    void updateOverlay(const DisplayOptions &options);
+    void drawSource(VideoPixelFormat format, GLuint vao);
+    // Draws the bound frame into target at frame size.
+    void convertFrame(RenderTarget &target, const DisplayOptions &options);
+    const RenderTarget &deinterlace(
+            bool newFrame, FieldOrder fieldOrder, DeinterlaceMode mode, const DisplayOptions &options);
+
+    std::array<GLuint, static_cast<size_t>(VideoPixelFormat::COUNT)> programs_{};
+    GLuint texY_{};
+    GLuint texUV_{};
+    GLuint texExternal_{};
+    // Layout of the frame in the textures, which is drawn again until a new one is bound.
+    VideoPixelFormat boundFormat_{VideoPixelFormat::RGBA};
+    // Streamer whose last frame the textures hold, which then only uploads the tiles that changed.
+    const UsbVideoStreamer *boundStreamer_{nullptr};
+    int32_t frameWidth_{};
+    int32_t frameHeight_{};
+    GLuint vao_{};
+    GLuint vbo_{};
+    // Full screen quad for render targets, which are not flipped like the window.
+    GLuint targetVao_{};
+    GLuint targetVbo_{};
+    GLuint overlayUbo_{};
+    int32_t viewportWidth_{};
+    int32_t viewportHeight_{};
+
+    // Deinterlacer: the converted current and previous frames, and the woven or interpolated field.
+    GLuint deinterlaceProgram_{};
+    GLint fieldParityLocation_{-1};
+    GLint weaveFromPreviousLocation_{-1};
+    GLint motionAdaptiveLocation_{-1};
+    std::array<RenderTarget, 2> frames_{};
+    size_t currentFrame_{0};
+    bool hasPreviousFrame_{false};
+    RenderTarget deinterlaced_{};
+    bool deinterlacing_{false};
+    bool secondField_{false};
+    bool secondFieldPending_{false};
+    steady_clock::time_point lastFrameTime_{};
+    nanoseconds frameInterval_{33ms};
+
+    // Progressive frames are converted here when they are denoised or scaled.
+    RenderTarget converted_{};
+    TemporalDenoiser denoiser_{};
+    FrameMarker frameMarker_{};
+    Vectorscope vectorscope_{};
+    PixelProbe probe_{};
+    VideoScaler scaler_{};
+
+    OverlayParams overlay_{};
+    steady_clock::time_point startTime_{steady_clock::now()};
+};
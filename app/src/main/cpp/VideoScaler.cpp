@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "VideoScaler.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <format>
+#include <string>
+
+#include "ProgramCache.h"
+#include "Trace.h"
+
+#define ULOGI(...) __android_log_print(ANDROID_LOG_INFO, "VideoScaler", __VA_ARGS__)
+#define ULOGE(...) __android_log_print(ANDROID_LOG_ERROR, "VideoScaler", __VA_ARGS__)
+
+namespace {
+
+// uKernel values of scale_f.glsl
+constexpr GLint kKernelCubic = 0;
+constexpr GLint kKernelLanczos = 1;
+
+// Scale factors closer to 1 than this are drawn 1:1.
+constexpr float kUnityTolerance = 0.01f;
+constexpr int32_t kMaxMipLevel = 4;
+
+const char *scaleFilterName(ScaleFilter filter) {
+    switch (filter) {
+        case ScaleFilter::BICUBIC:
+            return "bicubic";
+        case ScaleFilter::LANCZOS:
+            return "lanczos";
+        case ScaleFilter::BILINEAR:
+            return "bilinear";
+        default:
+            return "auto";
+    }
+}
+
+} // namespace
+
+void ScalerStats::recordPass(ScaleFilter filter, nanoseconds passGpuTime) {
+    auto index = static_cast<size_t>(filter);
+    passes[index]++;
+    gpuTime[index] += passGpuTime;
+    maxGpuTime[index] = std::max(maxGpuTime[index], passGpuTime);
+
+    auto now = steady_clock::now();
+    if (now - t0 < 10s) return;
+    std::string summary;
+    for (size_t i = 0; i < passes.size(); i++) {
+        if (passes[i] == 0) continue;
+        summary += std::format(
+                "{}{} {} passes, avg {:.2f} ms, max {:.2f} ms",
+                summary.empty() ? "" : "; ",
+                scaleFilterName(static_cast<ScaleFilter>(i)),
+                passes[i],
+                duration<float, std::milli>(gpuTime[i]).count() / passes[i],
+                duration<float, std::milli>(maxGpuTime[i]).count());
+    }
+    ULOGI("GPU scaling time: %s", summary.c_str());
+    *this = {};
+    t0 = now;
+}
+
+bool VideoScaler::init(ProgramCache &programCache, GLuint targetVao, GLuint windowVao) {
+    if (!initPass(horizontal_, programCache, "") || !initPass(vertical_, programCache, "#define VERTICAL\n")) {
+        return false;
+    }
+    targetVao_ = targetVao;
+    windowVao_ = windowVao;
+    intermediate_ = {};
+    gpuTimer_.init();
+    stats_ = {};
+    loggedLevel_ = -1;
+    return true;
+}
+
+bool VideoScaler::initPass(PassProgram &pass, ProgramCache &programCache, const char *defines) {
+    pass.program = programCache.getOrCreateProgram("shaders/video_v.glsl", "shaders/scale_f.glsl", defines);
+    if (pass.program == 0) {
+        ULOGE("No scaler program for '%s'", defines);
+        return false;
+    }
+    // Shares the Overlay block binding of the format programs, see VideoRenderer.
+    GLuint blockIndex = glGetUniformBlockIndex(pass.program, "Overlay");
+    if (blockIndex != GL_INVALID_INDEX) glUniformBlockBinding(pass.program, blockIndex, 0);
+    glUseProgram(pass.program);
+    glUniform1i(glGetUniformLocation(pass.program, "uSource"), 0);
+    pass.level = glGetUniformLocation(pass.program, "uLevel");
+    pass.kernel = glGetUniformLocation(pass.program, "uKernel");
+    pass.scale = glGetUniformLocation(pass.program, "uScale");
+    pass.sharpness = glGetUniformLocation(pass.program, "uSharpness");
+    glUseProgram(0);
+    return true;
+}
+
+ScaleFilter VideoScaler::resolve(
+        ScaleFilter requested, int32_t width, int32_t height, int32_t windowWidth, int32_t windowHeight) {
+    if (requested != ScaleFilter::AUTO) return requested;
+    if (width <= 0 || height <= 0) return ScaleFilter::BILINEAR;
+    float scale = std::max(
+            static_cast<float>(windowWidth) / static_cast<float>(width),
+            static_cast<float>(windowHeight) / static_cast<float>(height));
+    if (std::abs(scale - 1.0f) < kUnityTolerance) return ScaleFilter::BILINEAR;
+    // Lanczos keeps enlarged edges sharpest; its ringing shows more when reducing, where the
+    // widened cubic kernel already removes the aliasing.
+    return scale > 1.0f ? ScaleFilter::LANCZOS : ScaleFilter::BICUBIC;
+}
+
+void VideoScaler::draw(
+        const RenderTarget &source, int32_t windowWidth, int32_t windowHeight, ScaleFilter filter, float sharpness) {
+    TRACE_SECTION("scale");
+    gpuTimer_.collect([this](uint32_t tag, nanoseconds gpuTime) {
+        stats_.recordPass(static_cast<ScaleFilter>(tag), gpuTime);
+    });
+
+    // Reductions start from the smallest mipmap level that is still at least the window size.
+    int32_t level = 0;
+    while (level < kMaxMipLevel &&
+           (source.width >> (level + 1)) >= windowWidth &&
+           (source.height >> (level + 1)) >= windowHeight) {
+        level++;
+    }
+    int32_t levelWidth = std::max(source.width >> level, 1);
+    int32_t levelHeight = std::max(source.height >> level, 1);
+    if (filter != loggedFilter_ || level != loggedLevel_ ||
+        windowWidth != loggedWindowWidth_ || windowHeight != loggedWindowHeight_) {
+        ULOGI("Scaling %dx%d to %dx%d with %s from mipmap level %d",
+              source.width, source.height, windowWidth, windowHeight, scaleFilterName(filter), level);
+        loggedFilter_ = filter;
+        loggedLevel_ = level;
+        loggedWindowWidth_ = windowWidth;
+        loggedWindowHeight_ = windowHeight;
+    }
+
+    gpuTimer_.begin(static_cast<uint32_t>(filter));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, source.texture);
+    if (level > 0) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+        // texelFetch only reaches levels above 0 with a mipmapped minification filter.
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+    } else {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    }
+    GLint kernel = filter == ScaleFilter::LANCZOS ? kKernelLanczos : kKernelCubic;
+
+    intermediate_.ensureSize(windowWidth, levelHeight);
+    intermediate_.bind();
+    glUseProgram(horizontal_.program);
+    glUniform1i(horizontal_.level, level);
+    glUniform1i(horizontal_.kernel, kernel);
+    glUniform1f(horizontal_.scale, static_cast<float>(levelWidth) / static_cast<float>(windowWidth));
+    glUniform1f(horizontal_.sharpness, 0.0f);
+    glBindTexture(GL_TEXTURE_2D, source.texture);
+    glBindVertexArray(targetVao_);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, windowWidth, windowHeight);
+    glUseProgram(vertical_.program);
+    glUniform1i(vertical_.level, 0);
+    glUniform1i(vertical_.kernel, kernel);
+    glUniform1f(vertical_.scale, static_cast<float>(levelHeight) / static_cast<float>(windowHeight));
+    glUniform1f(vertical_.sharpness, sharpness);
+    glBindTexture(GL_TEXTURE_2D, intermediate_.texture);
+    glBindVertexArray(windowVao_);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    gpuTimer_.end();
+}
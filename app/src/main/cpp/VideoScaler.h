@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include "GpuTimer.h"
+#include "RenderTarget.h"
+
+using namespace std::chrono;
+
+class ProgramCache;
+
+// Must be kept in sync with ScaleFilter in UsbVideoNativeLibrary.kt.
+enum class ScaleFilter : int32_t {
+    // LANCZOS to enlarge, BICUBIC to reduce and BILINEAR when the frame fits the window 1:1
+    AUTO = 0,
+    BILINEAR = 1,
+    BICUBIC = 2,
+    LANCZOS = 3,
+};
+
+struct ScalerStats {
+    std::array<uint32_t, 4> passes{};
+    std::array<nanoseconds, 4> gpuTime{};
+    std::array<nanoseconds, 4> maxGpuTime{};
+    steady_clock::time_point t0{steady_clock::now()};
+
+    void recordPass(ScaleFilter filter, nanoseconds passGpuTime);
+};
+
+/**
+ * Resamples frames to the window with a separable bicubic (Catmull-Rom) or Lanczos-3 filter in
+ * two passes, instead of the bilinear sampling of the format programs. When reducing, the kernel
+ * is widened to cover every source texel of an output pixel, and reductions beyond 2:1 start
+ * from a mipmap level of the frame so the kernel stays short. The GPU time of each filter is
+ * measured with timer queries and logged every 10 s.
+ */
+class VideoScaler final {
+public:
+    /** targetVao and windowVao draw a full screen quad into a RenderTarget and into the window. */
+    bool init(ProgramCache &programCache, GLuint targetVao, GLuint windowVao);
+
+    /** The filter that requested resolves to for a frame of the given size in the window. */
+    static ScaleFilter resolve(ScaleFilter requested, int32_t width, int32_t height, int32_t windowWidth, int32_t windowHeight);
+
+    /**
+     * Draws source into the window framebuffer at windowWidth x windowHeight, adding the zebra
+     * pattern of the Overlay block. sharpness > 0 adds an unsharp mask of that strength.
+     */
+    void draw(const RenderTarget &source, int32_t windowWidth, int32_t windowHeight, ScaleFilter filter, float sharpness);
+
+private:
+    struct PassProgram {
+        GLuint program{};
+        GLint level{-1};
+        GLint kernel{-1};
+        GLint scale{-1};
+        GLint sharpness{-1};
+    };
+
+    bool initPass(PassProgram &pass, ProgramCache &programCache, const char *defines);
+
+    PassProgram horizontal_{};
+    PassProgram vertical_{};
+    GLuint targetVao_{};
+    GLuint windowVao_{};
+    // Output width, source (level) height
+    RenderTarget intermediate_{};
+    GpuTimer gpuTimer_{};
+    ScalerStats stats_{};
+
+    // Last logged configuration
+    ScaleFilter loggedFilter_{ScaleFilter::BILINEAR};
+    int32_t loggedLevel_{-1};
+    int32_t loggedWindowWidth_{};
+    int32_t loggedWindowHeight_{};
+};
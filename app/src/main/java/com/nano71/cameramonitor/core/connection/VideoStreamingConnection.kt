@@ -49,8 +49,14 @@ private const val UVC_VS_FORMAT_UNCOMPRESSED: Int = 0x04
 private const val UVC_VS_FRAME_UNCOMPRESSED: Int = 0x05
 private const val UVC_VS_FORMAT_MJPEG: Int = 0x06
 private const val UVC_VS_FRAME_MJPEG: Int = 0x07
+private const val UVC_VS_FORMAT_FRAME_BASED: Int = 0x10
+private const val UVC_VS_FRAME_FRAME_BASED: Int = 0x11
 
-private val SUPPORTED_VIDEO_FOURCC_FORMATS: Array<String> = arrayOf("YUY2", "NV12", "MJPEG")
+private val SUPPORTED_VIDEO_FOURCC_FORMATS: Array<String> =
+    arrayOf("YUY2", "NV12", "MJPEG", "P010", "UYVY", "I420", "YV12", "RGB3", "BGR3", "Y800", "Y16 ", "H264", "HEVC", "H265")
+
+// DirectShow MEDIASUBTYPE_RGB24 {E436EB7D-524F-11CE-9F53-0020AF0BA770}: B, G, R byte order.
+private val RGB24_GUID_PREFIX = byteArrayOf(0x7D, 0xEB.toByte(), 0x36, 0xE4.toByte())
 
 private fun aspectRatio(width: Int, height: Int): Pair<Int, Int> {
     val divisor = gcd(width, height)
@@ -102,7 +108,8 @@ class VideoStreamingConnection(
                     interfaceDescriptor = InterfaceDescriptor(descriptor.buffer)
                 }
 
-                descriptor.isVSUncompressedFormatTypeDescriptor() -> {
+                descriptor.isVSUncompressedFormatTypeDescriptor() ||
+                        descriptor.isVSFrameBasedFormatDescriptor() -> {
                     val uncompressedFormatDescriptor = VSUncompressedFormatDescriptor(descriptor.buffer)
                     fourccFormat = uncompressedFormatDescriptor.fourccFormat
                 }
@@ -262,6 +269,11 @@ fun Descriptor.isVSUncompressedFormatTypeDescriptor(): Boolean {
             buffer.getBInt(offset + 2) == UVC_VS_FORMAT_UNCOMPRESSED
 }
 
+fun Descriptor.isVSFrameBasedFormatDescriptor(): Boolean {
+    return bDescriptorType == USB_DT_CLASSSPECIFIC_INTERFACE &&
+            buffer.getBInt(offset + 2) == UVC_VS_FORMAT_FRAME_BASED
+}
+
 fun Descriptor.isMJPEGVideoFormatDescriptor(): Boolean {
     return bDescriptorType == USB_DT_CLASSSPECIFIC_INTERFACE &&
             buffer.getBInt(offset + 2) == UVC_VS_FORMAT_MJPEG
@@ -269,7 +281,7 @@ fun Descriptor.isMJPEGVideoFormatDescriptor(): Boolean {
 
 fun Descriptor.isVSFrameDescriptor(): Boolean {
     return bDescriptorType == USB_DT_CLASSSPECIFIC_INTERFACE &&
-            buffer.getBInt(offset + 2) in intArrayOf(UVC_VS_FRAME_UNCOMPRESSED, UVC_VS_FRAME_MJPEG)
+            buffer.getBInt(offset + 2) in intArrayOf(UVC_VS_FRAME_UNCOMPRESSED, UVC_VS_FRAME_MJPEG, UVC_VS_FRAME_FRAME_BASED)
 }
 
 fun Descriptor.isVideoStreamingEndpoint(): Boolean {
@@ -296,6 +308,14 @@ data class VideoFormat(
             "YUY2" -> LibuvcFrameFormat.UVC_FRAME_FORMAT_YUYV
             "MJPEG" -> LibuvcFrameFormat.UVC_FRAME_FORMAT_MJPEG
             "NV12" -> LibuvcFrameFormat.UVC_FRAME_FORMAT_NV12
+            "P010" -> LibuvcFrameFormat.UVC_FRAME_FORMAT_P010
+            "UYVY" -> LibuvcFrameFormat.UVC_FRAME_FORMAT_UYVY
+            "BGR3" -> LibuvcFrameFormat.UVC_FRAME_FORMAT_BGR
+            "Y800" -> LibuvcFrameFormat.UVC_FRAME_FORMAT_GRAY8
+            "Y16 " -> LibuvcFrameFormat.UVC_FRAME_FORMAT_GRAY16
+            "H264" -> LibuvcFrameFormat.UVC_FRAME_FORMAT_H264
+            // libuvc has no frame format for these; the native side negotiates them by fourcc.
+            "I420", "YV12", "RGB3", "HEVC", "H265" -> LibuvcFrameFormat.UVC_FRAME_FORMAT_ANY
             else -> throw IllegalArgumentException("Unsupported fourcc format $fourccFormat")
         }
     }
@@ -325,6 +345,8 @@ data class VideoFormat(
  * Data (HexDump)           : 1B 24 04 02 0B 59 55 59 32 00 00 10 00 80 00 00   .$...YUY2.......
  *                            AA 00 38 9B 71 10 01 00 00 00 00                  ..8.q......
  * </pre>
+ * The Frame Based Format Type Descriptor (subtype 0x10) of H.264/HEVC starts with the same
+ * fields and is parsed with this class as well.
  */
 class VSUncompressedFormatDescriptor(pack: ByteBuffer) {
     val bLength: Int = pack.getBInt()
@@ -334,10 +356,11 @@ class VSUncompressedFormatDescriptor(pack: ByteBuffer) {
     val bNumFrameDescriptors: Int = pack.getBInt()
 
     // the descriptor contains 16 bytes guidFormat but we only read first 4 bytes which is
-    // fourccFormat and skip 12
+    // fourccFormat and skip 12. The DirectShow RGB24 GUID has no fourcc and is named BGR3.
     val fourccFormat: String =
-        String(byteArrayOf(pack.get(), pack.get(), pack.get(), pack.get())).also {
+        byteArrayOf(pack.get(), pack.get(), pack.get(), pack.get()).let {
             pack.position(pack.position() + 12)
+            if (it.contentEquals(RGB24_GUID_PREFIX)) "BGR3" else String(it)
         }
 
     val bBitsPerPixel: Int = pack.getBInt()
@@ -421,7 +444,8 @@ class VSFrameDescriptor(pack: ByteBuffer) {
     val wHeight: Int = pack.getWInt()
     val dwMinBitRate: Int = pack.getInt()
     val dwMaxBitRate: Int = pack.getInt()
-    val dwMaxVideoFrameBufferSize: Int = pack.getInt()
+    // Frame based frame descriptors have no dwMaxVideoFrameBufferSize.
+    val dwMaxVideoFrameBufferSize: Int = if (bDescriptorSubtype == UVC_VS_FRAME_FRAME_BASED) 0 else pack.getInt()
     val dwDefaultFrameInterval: Int = pack.getInt()
     val bFrameIntervalType: Int = pack.getBInt()
 
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.nano71.cameramonitor.core.usb
+
+import android.graphics.Bitmap
+import android.graphics.Rect
+import android.media.MediaMetadataRetriever
+import kotlin.math.abs
+import kotlin.math.sqrt
+
+// Cells of the bar code; the layout must be kept in sync with FrameMarker.h and marker_f.glsl.
+private const val MARKER_BITS = 78
+private const val GUARD_BITS = 3
+
+// Rows of a region scanned for the bar code, which is six cells high.
+private const val ROW_STEP = 2
+
+/** A frame marker read back from a recording of the screen. */
+data class FrameMarkerReading(
+    /** UVC sequence number of the frame, or the count of decoded frames for H.264/HEVC. */
+    val sequence: Long,
+
+    /** When the frame was captured, on the clock of SystemClock.uptimeMillis(), modulo 2^32. */
+    val captureTimeMillis: Long,
+)
+
+/**
+ * Reads the bar code that the native presenter burns into the top left corner of the window
+ * while [UsbVideoNativeLibrary.setFrameMarkerVisibleNative] is on: a row of 78 equal cells on a
+ * black band, holding the guard bits 101, the sequence number and capture time as 32-bit words
+ * and the XOR of their eight bytes, most significant bit first, and 101 again.
+ */
+object FrameMarkerDecoder {
+    /**
+     * Decodes a row of luma values (0 to 255) that crosses the bar code, or returns null when the
+     * row holds none. Every bright run is tried as the start guard, so the bar code may sit
+     * anywhere in the row.
+     */
+    fun decodeRow(luma: IntArray): FrameMarkerReading? {
+        if (luma.isEmpty()) return null
+        val min = luma.min()
+        val max = luma.max()
+        if (max - min < 64) return null
+        val threshold = (min + max) / 2
+        // Samples this close to the threshold are blurred edges rather than cells.
+        val margin = (max - min) / 4
+
+        val starts = mutableListOf<Int>()
+        val ends = mutableListOf<Int>()
+        for (x in luma.indices) {
+            val bright = luma[x] >= threshold
+            if (bright && (x == 0 || luma[x - 1] < threshold)) starts.add(x)
+            if (bright && (x == luma.size - 1 || luma[x + 1] < threshold)) ends.add(x + 1)
+        }
+        for (start in starts) {
+            for (end in ends) {
+                val cell = (end - start).toFloat() / MARKER_BITS
+                if (cell < 2f) continue
+                decodeSpan(luma, start, cell, threshold, margin)?.let { return it }
+            }
+        }
+        return null
+    }
+
+    /** Scans the rows of [region] in [bitmap], by default its top left quarter, for the bar code. */
+    fun decode(bitmap: Bitmap, region: Rect? = null): FrameMarkerReading? {
+        val area = region ?: Rect(0, 0, bitmap.width / 2, bitmap.height / 2)
+        if (area.isEmpty) return null
+        val pixels = IntArray(area.width())
+        val luma = IntArray(area.width())
+        for (y in area.top until area.bottom step ROW_STEP) {
+            bitmap.getPixels(pixels, 0, area.width(), area.left, y, area.width(), 1)
+            for (x in pixels.indices) {
+                val color = pixels[x]
+                luma[x] = ((color shr 16 and 0xff) * 77 + (color shr 8 and 0xff) * 150 + (color and 0xff) * 29) shr 8
+            }
+            decodeRow(luma)?.let { return it }
+        }
+        return null
+    }
+
+    private fun decodeSpan(luma: IntArray, start: Int, cell: Float, threshold: Int, margin: Int): FrameMarkerReading? {
+        val bits = BooleanArray(MARKER_BITS)
+        for (i in 0 until MARKER_BITS) {
+            val value = luma[(start + (i + 0.5f) * cell).toInt().coerceAtMost(luma.size - 1)]
+            if (abs(value - threshold) < margin) return null
+            bits[i] = value >= threshold
+        }
+        val guard = booleanArrayOf(true, false, true)
+        for (i in 0 until GUARD_BITS) {
+            if (bits[i] != guard[i] || bits[MARKER_BITS - GUARD_BITS + i] != guard[i]) return null
+        }
+        fun word(first: Int, count: Int): Long {
+            var value = 0L
+            for (i in first until first + count) value = value shl 1 or (if (bits[i]) 1L else 0L)
+            return value
+        }
+        val sequence = word(GUARD_BITS, 32)
+        val millis = word(GUARD_BITS + 32, 32)
+        val checksum = word(GUARD_BITS + 64, 8)
+        val folded = sequence xor millis
+        val expected = (folded xor (folded shr 8) xor (folded shr 16) xor (folded shr 24)) and 0xff
+        return if (checksum == expected) FrameMarkerReading(sequence, millis) else null
+    }
+}
+
+/**
+ * Frame markers read from a recording of the screen, for example by a high-speed camera. Frames
+ * are timed by the recording's frame rate, so capture to display latency is only known up to the
+ * offset between the two clocks; its spread is independent of that offset.
+ */
+data class FrameMarkerReport(
+    val recordedFrames: Int,
+    val decodedFrames: Int,
+    /** Distinct frames seen on screen. */
+    val shownFrames: Int,
+    /** Frames whose sequence number was never seen between two shown ones. */
+    val missingFrames: Long,
+    val meanIntervalMillis: Double,
+    /** Standard deviation of the time between two shown frames. */
+    val intervalJitterMillis: Double,
+    /** Median and 95th percentile of capture to display latency above its minimum. */
+    val latencySpreadP50Millis: Double,
+    val latencySpreadP95Millis: Double,
+) {
+    override fun toString(): String =
+        "$recordedFrames recorded frames, $decodedFrames decoded, $shownFrames shown, $missingFrames missing, " +
+            "interval %.2f ms ± %.2f ms, latency spread p50 %.2f ms p95 %.2f ms".format(
+                meanIntervalMillis,
+                intervalJitterMillis,
+                latencySpreadP50Millis,
+                latencySpreadP95Millis,
+            )
+}
+
+/** Decodes the frame markers of every frame of a video file. */
+object FrameMarkerAnalyzer {
+    /**
+     * Reads every frame of the video at [path], recorded at [recordingFps] (the real rate of a
+     * high-speed camera, not that of the file's playback), and reports when each marked frame
+     * first appeared. Blocks until the whole video was read.
+     */
+    fun analyze(path: String, recordingFps: Double, region: Rect? = null): FrameMarkerReport {
+        val retriever = MediaMetadataRetriever()
+        try {
+            retriever.setDataSource(path)
+            val frameCount =
+                retriever.extractMetadata(MediaMetadataRetriever.METADATA_KEY_VIDEO_FRAME_COUNT)?.toIntOrNull() ?: 0
+            val readings = (0 until frameCount).map { index ->
+                retriever.getFrameAtIndex(index)?.let { frame ->
+                    FrameMarkerDecoder.decode(frame, region).also { frame.recycle() }
+                }
+            }
+            return report(readings, recordingFps)
+        } finally {
+            retriever.release()
+        }
+    }
+
+    /** Builds the report from the reading of each recorded frame, null where none was found. */
+    fun report(readings: List<FrameMarkerReading?>, recordingFps: Double): FrameMarkerReport {
+        // When each frame was first seen, in recording milliseconds.
+        val shown = mutableListOf<Pair<FrameMarkerReading, Double>>()
+        readings.forEachIndexed { index, reading ->
+            if (reading != null && reading != shown.lastOrNull()?.first) {
+                shown.add(reading to index * 1000.0 / recordingFps)
+            }
+        }
+        val intervals = shown.zipWithNext { a, b -> b.second - a.second }
+        val meanInterval = if (intervals.isEmpty()) 0.0 else intervals.average()
+        val jitter =
+            if (intervals.isEmpty()) 0.0 else sqrt(intervals.sumOf { (it - meanInterval) * (it - meanInterval) } / intervals.size)
+        val missing = shown.zipWithNext { a, b -> (b.first.sequence - a.first.sequence - 1).coerceAtLeast(0) }.sum()
+        val latencies = shown.map { (reading, seenAt) -> seenAt - reading.captureTimeMillis }
+        val spreads = latencies.map { it - (latencies.minOrNull() ?: 0.0) }.sorted()
+        fun percentile(p: Double) = if (spreads.isEmpty()) 0.0 else spreads[((spreads.size - 1) * p).toInt()]
+        return FrameMarkerReport(
+            recordedFrames = readings.size,
+            decodedFrames = readings.count { it != null },
+            shownFrames = shown.size,
+            missingFrames = missing,
+            meanIntervalMillis = meanInterval,
+            intervalJitterMillis = jitter,
+            latencySpreadP50Millis = percentile(0.5),
+            latencySpreadP95Millis = percentile(0.95),
+        )
+    }
+}
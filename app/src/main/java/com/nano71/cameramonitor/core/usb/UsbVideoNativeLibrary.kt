@@ -16,21 +16,15 @@
 package com.nano71.cameramonitor.core.usb
 
 import android.content.Context
+import android.content.res.AssetManager
+import android.graphics.Bitmap
 import android.media.AudioManager
 import android.media.AudioTrack
-import android.opengl.GLES30
-import android.opengl.GLSurfaceView
-import android.opengl.Matrix
-import android.os.SystemClock
+import android.view.Surface
 import com.nano71.cameramonitor.core.connection.AudioStreamingConnection
 import com.nano71.cameramonitor.core.connection.AudioStreamingFormatTypeDescriptor
 import com.nano71.cameramonitor.core.connection.VideoFormat
 import com.nano71.cameramonitor.core.connection.VideoStreamingConnection
-import java.nio.ByteBuffer
-import java.nio.ByteOrder
-import java.nio.FloatBuffer
-import javax.microedition.khronos.egl.EGLConfig
-import javax.microedition.khronos.opengles.GL10
 
 enum class UsbSpeed {
     Unknown,
@@ -41,6 +35,97 @@ enum class UsbSpeed {
     SuperPlus,
 }
 
+/** How the native presenter puts frames on screen; the ordinals match PresenterMode in VideoPresenter.h. */
+enum class PresenterMode {
+    /** Draws through GLES on the presenter's own EGL context, with overlays. */
+    Gl,
+
+    /** Converts frames on the CPU straight into the window buffers, without GL and overlays. */
+    CpuBlit,
+}
+
+/**
+ * Transfer function that 10-bit (P010) video is decoded with; the ordinals match HdrTransfer in
+ * VideoRenderer.h. UVC descriptors can't signal PQ or HLG, so this is chosen by the user.
+ */
+enum class HdrTransfer {
+    Sdr,
+    Pq,
+    Hlg,
+}
+
+/**
+ * How interlaced video is shown; the ordinals match DeinterlaceMode in VideoRenderer.h. Each field
+ * is shown on its own, so 1080i60 plays at 60 frames per second.
+ */
+enum class DeinterlaceMode {
+    /** MotionAdaptive for formats flagged as interlaced and for sources that show combing. */
+    Auto,
+    Off,
+
+    /** Interpolates the missing rows of every field. */
+    Bob,
+
+    /** Weaves the fields where the picture is still and interpolates where it moves. */
+    MotionAdaptive,
+}
+
+/** How frames are resampled to the window; the ordinals match ScaleFilter in VideoScaler.h. */
+enum class ScaleFilter {
+    /** Lanczos to enlarge, bicubic to reduce, bilinear when the frame fits the window 1:1. */
+    Auto,
+    Bilinear,
+    Bicubic,
+    Lanczos,
+}
+
+/** What the capture card delivers; the ordinals match SignalState in SignalMonitor.h. */
+enum class SignalState {
+    Live,
+
+    /** The same frame over and over, usually the last one before the source went away. */
+    Frozen,
+
+    /** Black frames, which most capture cards send without an HDMI input. */
+    NoSignal,
+}
+
+/** Owners of accounted native buffers; the ordinals match MemorySubsystem in MemoryBudget.h. */
+enum class MemorySubsystem {
+    /** Planes of the stored frame and decoded MJPEG. */
+    VideoFrames,
+
+    /** Frame buffers of libuvc and isochronous transfers of the USB audio path. */
+    UsbTransfers,
+    AudioRing,
+    Thumbnails,
+    Replay,
+}
+
+/** Bytes a subsystem holds now and held at most since the process started. */
+data class MemoryUsage(val currentBytes: Long, val peakBytes: Long)
+
+/** Receives motion found by the native detector, on its own thread. */
+fun interface MotionListener {
+    /**
+     * [boxes] holds left, top, right and bottom of each moving region as fractions of the frame,
+     * [activity] the moving fraction of the frame. Called at most twice a second.
+     */
+    fun onMotion(boxes: FloatArray, activity: Float)
+}
+
+/** Receives pixel probe results from the native presenter, on its render thread. */
+fun interface PixelProbeListener {
+    /**
+     * Result of the probe [id] of the frame with [frameSequence]. [region] holds x, y, width and
+     * height of the probed pixels. [rgb] is the mean R, G and B (0 to 255) of the frame as shown,
+     * before scaling and overlays, over at most 64x64 pixels around the region's centre. [yuv] is
+     * the mean Y, Cb and Cr code values of the whole region in the source frame on an 8-bit scale,
+     * or null when the source has no Y'CbCr planes or they already hold a newer frame.
+     */
+    fun onProbe(id: Int, frameSequence: Long, region: IntArray, rgb: FloatArray, yuv: FloatArray?)
+}
+
 object UsbVideoNativeLibrary {
     fun getUsbSpeed(): UsbSpeed {
         return UsbSpeed.entries[getUsbDeviceSpeed()]
@@ -106,6 +191,21 @@ object UsbVideoNativeLibrary {
 
     external fun stopUsbAudioStreamingNative()
 
+    /** Bands of the audio spectrum, logarithmically spaced from 20 Hz to 20 kHz. */
+    const val AUDIO_SPECTRUM_BANDS = 64
+
+    /**
+     * Starts or stops the spectrum analyzer of the USB audio stream, which works on a copy of the
+     * samples on its own thread and updates 30 times a second. Only 16-bit streams are analysed.
+     */
+    external fun setAudioSpectrumEnabledNative(enabled: Boolean)
+
+    /**
+     * Copies the level of each of the [AUDIO_SPECTRUM_BANDS] bands in dBFS, from -100 up, into
+     * [bands]. Returns false while the analyzer has no result.
+     */
+    external fun getAudioSpectrumNative(bands: FloatArray): Boolean
+
     fun connectUsbVideoStreaming(
         videoStreamingConnection: VideoStreamingConnection,
         frameFormat: VideoFormat?,
@@ -118,6 +218,7 @@ object UsbVideoNativeLibrary {
                 videoFormat.height,
                 videoFormat.fps,
                 videoFormat.toLibuvcFrameFormat().ordinal,
+                videoFormat.fourccFormat,
             )
         ) {
             true to "Success"
@@ -132,193 +233,176 @@ object UsbVideoNativeLibrary {
         height: Int,
         fps: Int,
         libuvcFrameFormat: Int,
+        fourccFormat: String,
     ): Boolean
 
     external fun startUsbVideoStreamingNative(): Boolean
     external fun stopUsbVideoStreamingNative()
     external fun disconnectUsbVideoStreamingNative()
     external fun streamingStatsSummaryString(): String
-    external fun getVideoFormat(): Int
-
-    @JvmStatic
-    external fun updateTextures(texY: Int, texUV: Int): Boolean
-
-    class VideoRenderer(private val context: Context) : GLSurfaceView.Renderer {
-        private var programNV12 = 0
-        private var programRGBA = 0
-
-        private var texY = 0
-        private var texUV = 0
-
-        var showZebra = false
-        private val startTime = SystemClock.uptimeMillis()
-
-        private lateinit var vertexBuffer: FloatBuffer
-        private lateinit var texCoordBuffer: FloatBuffer
-
-        private val mvpMatrix = FloatArray(16).apply { Matrix.setIdentityM(this, 0) }
-
-        private val vertices = floatArrayOf(
-            -1.0f, -1.0f,
-            1.0f, -1.0f,
-            -1.0f, 1.0f,
-            1.0f, 1.0f
-        )
-
-        private val texCoords = floatArrayOf(
-            0.0f, 1.0f,
-            1.0f, 1.0f,
-            0.0f, 0.0f,
-            1.0f, 0.0f
-        )
-
-        override fun onSurfaceCreated(unused: GL10, p1: EGLConfig) {
-            GLES30.glClearColor(0f, 0f, 0f, 1f)
-            texY = createTexture()
-            texUV = createTexture()
-
-            vertexBuffer = ByteBuffer.allocateDirect(vertices.size * 4)
-                .order(ByteOrder.nativeOrder())
-                .asFloatBuffer()
-                .put(vertices)
-            vertexBuffer.position(0)
-
-            texCoordBuffer = ByteBuffer.allocateDirect(texCoords.size * 4)
-                .order(ByteOrder.nativeOrder())
-                .asFloatBuffer()
-                .put(texCoords)
-            texCoordBuffer.position(0)
-
-            initShaders()
-        }
-
-        private fun initShaders() {
-            val vertexShaderCode = loadShaderFromAssets("shaders/video_v.glsl")
-            val fragmentShaderNV12Code = loadShaderFromAssets("shaders/video_nv12_f.glsl")
-            val fragmentShaderRGBACode = loadShaderFromAssets("shaders/video_rgba_f.glsl")
-
-            programNV12 = createProgram(vertexShaderCode, fragmentShaderNV12Code)
-            programRGBA = createProgram(vertexShaderCode, fragmentShaderRGBACode)
-        }
-
-        private fun loadShaderFromAssets(fileName: String): String {
-            return context.assets.open(fileName).bufferedReader().use { it.readText() }
-        }
-
-        private fun createProgram(vSource: String, fSource: String): Int {
-            val vShader = loadShader(GLES30.GL_VERTEX_SHADER, vSource)
-            val fShader = loadShader(GLES30.GL_FRAGMENT_SHADER, fSource)
-            val program = GLES30.glCreateProgram()
-            GLES30.glAttachShader(program, vShader)
-            GLES30.glAttachShader(program, fShader)
-            GLES30.glLinkProgram(program)
-            return program
-        }
-
-        private fun loadShader(type: Int, shaderCode: String): Int {
-            return GLES30.glCreateShader(type).also { shader ->
-                GLES30.glShaderSource(shader, shaderCode)
-                GLES30.glCompileShader(shader)
-            }
-        }
-
-        override fun onSurfaceChanged(unused: GL10?, width: Int, height: Int) {
-            GLES30.glViewport(0, 0, width, height)
-        }
-
-        override fun onDrawFrame(unused: GL10?) {
-            // Attempt to update textures. If false, we still draw the last frame data
-            // to avoid flickering (skipping draw or clearing to black).
-            updateTextures(texY, texUV)
-
-            GLES30.glClear(GLES30.GL_COLOR_BUFFER_BIT)
-
-            val time = (SystemClock.uptimeMillis() - startTime).toFloat()
-
-            val format = getVideoFormat()
-            if (format == 1) { // NV12
-                drawNV12(time)
-            } else { // RGBA or others treated as RGBA
-                drawRGBA(time)
-            }
-        }
-
-        private fun drawNV12(time: Float) {
-            GLES30.glUseProgram(programNV12)
-
-            val positionHandle = GLES30.glGetAttribLocation(programNV12, "aPosition")
-            GLES30.glEnableVertexAttribArray(positionHandle)
-            GLES30.glVertexAttribPointer(positionHandle, 2, GLES30.GL_FLOAT, false, 8, vertexBuffer)
-
-            val texCoordHandle = GLES30.glGetAttribLocation(programNV12, "aTexCoord")
-            GLES30.glEnableVertexAttribArray(texCoordHandle)
-            GLES30.glVertexAttribPointer(texCoordHandle, 2, GLES30.GL_FLOAT, false, 8, texCoordBuffer)
-
-            val mvpHandle = GLES30.glGetUniformLocation(programNV12, "uMVPMatrix")
-            GLES30.glUniformMatrix4fv(mvpHandle, 1, false, mvpMatrix, 0)
-
-            val timeHandle = GLES30.glGetUniformLocation(programNV12, "uTime")
-            GLES30.glUniform1f(timeHandle, time)
-
-            val zebraHandle = GLES30.glGetUniformLocation(programNV12, "uShowZebra")
-            GLES30.glUniform1i(zebraHandle, if (showZebra) 1 else 0)
-
-            val texYHandle = GLES30.glGetUniformLocation(programNV12, "uTextureY")
-            GLES30.glActiveTexture(GLES30.GL_TEXTURE0)
-            GLES30.glBindTexture(GLES30.GL_TEXTURE_2D, texY)
-            GLES30.glUniform1i(texYHandle, 0)
-
-            val texUVHandle = GLES30.glGetUniformLocation(programNV12, "uTextureUV")
-            GLES30.glActiveTexture(GLES30.GL_TEXTURE1)
-            GLES30.glBindTexture(GLES30.GL_TEXTURE_2D, texUV)
-            GLES30.glUniform1i(texUVHandle, 1)
 
-            GLES30.glDrawArrays(GLES30.GL_TRIANGLE_STRIP, 0, 4)
-
-            GLES30.glDisableVertexAttribArray(positionHandle)
-            GLES30.glDisableVertexAttribArray(texCoordHandle)
-        }
-
-        private fun drawRGBA(time: Float) {
-            GLES30.glUseProgram(programRGBA)
-
-            val positionHandle = GLES30.glGetAttribLocation(programRGBA, "aPosition")
-            GLES30.glEnableVertexAttribArray(positionHandle)
-            GLES30.glVertexAttribPointer(positionHandle, 2, GLES30.GL_FLOAT, false, 8, vertexBuffer)
-
-            val texCoordHandle = GLES30.glGetAttribLocation(programRGBA, "aTexCoord")
-            GLES30.glEnableVertexAttribArray(texCoordHandle)
-            GLES30.glVertexAttribPointer(texCoordHandle, 2, GLES30.GL_FLOAT, false, 8, texCoordBuffer)
-
-            val mvpHandle = GLES30.glGetUniformLocation(programRGBA, "uMVPMatrix")
-            GLES30.glUniformMatrix4fv(mvpHandle, 1, false, mvpMatrix, 0)
-
-            val timeHandle = GLES30.glGetUniformLocation(programRGBA, "uTime")
-            GLES30.glUniform1f(timeHandle, time)
-
-            val zebraHandle = GLES30.glGetUniformLocation(programRGBA, "uShowZebra")
-            GLES30.glUniform1i(zebraHandle, if (showZebra) 1 else 0)
-
-            val texRGBAHandle = GLES30.glGetUniformLocation(programRGBA, "uTextureRGBA")
-            GLES30.glActiveTexture(GLES30.GL_TEXTURE0)
-            GLES30.glBindTexture(GLES30.GL_TEXTURE_2D, texY)
-            GLES30.glUniform1i(texRGBAHandle, 0)
-
-            GLES30.glDrawArrays(GLES30.GL_TRIANGLE_STRIP, 0, 4)
+    fun getSignalState(): SignalState {
+        return SignalState.entries[getSignalStateNative()]
+    }
 
-            GLES30.glDisableVertexAttribArray(positionHandle)
-            GLES30.glDisableVertexAttribArray(texCoordHandle)
-        }
+    external fun getSignalStateNative(): Int
+
+    /**
+     * Whether frames are dropped before decode and upload while the source is frozen or black
+     * (off by default, the state is only reported). The last frame stays on screen; black is
+     * probed twice a second.
+     */
+    external fun setSkipWhileSignalDownNative(skip: Boolean)
+    /**
+     * Starts the native presenter on [surface] in [presenterMode], an ordinal of [PresenterMode].
+     * It renders on its own thread and is woken by the capture path, so there is no Java render
+     * loop. Shader program binaries are cached in [programCacheDir].
+     */
+    external fun attachSurfaceNative(
+        surface: Surface,
+        assetManager: AssetManager,
+        programCacheDir: String,
+        presenterMode: Int,
+    )
+    external fun surfaceChangedNative()
+    external fun detachSurfaceNative()
+    external fun setZebraVisibleNative(visible: Boolean)
+    external fun setPresenterModeNative(mode: Int)
+
+    /**
+     * Mode the attached presenter runs in, which is [PresenterMode.CpuBlit] once GL failed to
+     * start; null without a surface.
+     */
+    fun getPresenterMode(): PresenterMode? {
+        return getPresenterModeNative().takeIf { it >= 0 }?.let { PresenterMode.entries[it] }
+    }
 
-        private fun createTexture(): Int {
-            val tex = IntArray(1)
-            GLES30.glGenTextures(1, tex, 0)
-            GLES30.glBindTexture(GLES30.GL_TEXTURE_2D, tex[0])
-            GLES30.glTexParameteri(GLES30.GL_TEXTURE_2D, GLES30.GL_TEXTURE_MIN_FILTER, GLES30.GL_LINEAR)
-            GLES30.glTexParameteri(GLES30.GL_TEXTURE_2D, GLES30.GL_TEXTURE_MAG_FILTER, GLES30.GL_LINEAR)
-            GLES30.glTexParameteri(GLES30.GL_TEXTURE_2D, GLES30.GL_TEXTURE_WRAP_S, GLES30.GL_CLAMP_TO_EDGE)
-            GLES30.glTexParameteri(GLES30.GL_TEXTURE_2D, GLES30.GL_TEXTURE_WRAP_T, GLES30.GL_CLAMP_TO_EDGE)
-            return tex[0]
+    external fun getPresenterModeNative(): Int
+    external fun setHdrModeNative(transfer: Int, toneMap: Boolean)
+    external fun setDeinterlaceModeNative(mode: Int)
+
+    /** [sharpness] from 0 (none) to 1 adds an unsharp mask to the bicubic and Lanczos filters. */
+    external fun setScalerNative(filter: Int, sharpness: Float)
+
+    /**
+     * [strength] from 0 (off) to 1 blends each frame with the previous ones where the picture is
+     * still, which hides the noise of cheap capture cards without adding latency.
+     */
+    external fun setDenoiseNative(strength: Float)
+
+    /**
+     * Burns the sequence number and capture time of each frame into the top left corner of the
+     * window, as digits and as a bar code that [FrameMarkerDecoder] reads back from a high-speed
+     * recording of the screen. Only drawn by the GL presenter.
+     */
+    external fun setFrameMarkerVisibleNative(visible: Boolean)
+
+    /**
+     * Shows a vectorscope of the frame's chroma in the bottom right corner of the window, with
+     * targets for 75% color bars and the skin tone line. Built on the GPU and only drawn by the
+     * GL presenter.
+     */
+    external fun setVectorscopeVisibleNative(visible: Boolean)
+
+    /**
+     * Refresh rates the display supports. The presenter switches the window to the one that fits
+     * the source frame rate best and paces frames evenly onto it.
+     */
+    external fun setDisplayRefreshRatesNative(rates: FloatArray)
+
+    /**
+     * Starts motion detection on the luma of the video with [listener], or stops it when null.
+     * H.264/HEVC streams are not analysed. The listener must not call back into this method.
+     */
+    external fun setMotionListenerNative(listener: MotionListener?)
+
+    /** Size of the thumbnails of the timeline; bitmaps passed to [getThumbnailNative] must match. */
+    const val THUMBNAIL_WIDTH = 160
+    const val THUMBNAIL_HEIGHT = 90
+
+    /**
+     * Starts a rolling timeline of thumbnails of the video, one every [intervalMillis], held in
+     * an arena of at most [memoryCapBytes] that replaces the oldest thumbnail once it is full. A
+     * running timeline is dropped first; zero for either stops it. H.264/HEVC is not covered.
+     */
+    external fun setThumbnailTimelineNative(intervalMillis: Int, memoryCapBytes: Long)
+
+    /** Capture times of the thumbnails of the timeline, oldest first, in SystemClock.uptimeMillis(). */
+    external fun getThumbnailTimesNative(): LongArray
+
+    /**
+     * Copies the thumbnail captured closest to [timeMillis] into [bitmap], an ARGB_8888 bitmap
+     * of [THUMBNAIL_WIDTH] x [THUMBNAIL_HEIGHT]. Returns false while the timeline is empty.
+     */
+    external fun getThumbnailNative(timeMillis: Long, bitmap: Bitmap): Boolean
+
+    /**
+     * Reads the region from [left], [top] to [right], [bottom] (fractions of the frame) of the next
+     * frame back from the GPU, without stalling it, and reports it to the probe listener a frame
+     * or so later. A region smaller than a pixel probes the pixel it falls in. Only served by the
+     * GL presenter.
+     */
+    external fun requestPixelProbeNative(id: Int, left: Float, top: Float, right: Float, bottom: Float)
+
+    /** Sets the listener of [requestPixelProbeNative], which must not call back into this method. */
+    external fun setPixelProbeListenerNative(listener: PixelProbeListener?)
+
+    /**
+     * Keeps the last [durationMillis] of video for instant replay, scaled down to at most
+     * 480x270 and optionally LZ4 compressed, in an arena that together with its working buffers
+     * takes at most [memoryCapBytes]. A running cache is dropped first; zero for either stops it.
+     * Only 8-bit Y'CbCr, gray and MJPEG video is cached.
+     */
+    external fun setReplayCacheNative(durationMillis: Int, memoryCapBytes: Long, compress: Boolean)
+
+    /**
+     * Shows the cached video from [backMillis] before its newest frame at [speed] (negative plays
+     * backwards, zero pauses) while capture goes on. Live video returns when playing forwards
+     * catches up, or on [stopReplayNative]. Only served by the GL presenter.
+     */
+    external fun startReplayNative(backMillis: Int, speed: Float)
+
+    external fun setReplaySpeedNative(speed: Float)
+
+    external fun stopReplayNative()
+
+    external fun isReplayingNative(): Boolean
+
+    /**
+     * Caps the native buffers of all subsystems together at [bytes], or lifts the cap at zero.
+     * Buffers the video and audio paths need are allocated regardless and only logged when they
+     * exceed it; the thumbnail timeline and replay cache take what is left when they start.
+     */
+    external fun setMemoryBudgetNative(bytes: Long)
+
+    /** Current and peak bytes of each [MemorySubsystem] in order, followed by those of the total. */
+    external fun getMemoryUsageNative(): LongArray
+
+    /** Usage of each subsystem, and of all of them under null; the total peak is not the sum of theirs. */
+    fun memoryUsage(): Map<MemorySubsystem?, MemoryUsage> {
+        val usage = getMemoryUsageNative()
+        val subsystems = MemorySubsystem.entries + null
+        return subsystems.withIndex().associate { (i, subsystem) ->
+            subsystem to MemoryUsage(usage[2 * i], usage[2 * i + 1])
         }
     }
+
+    /** Feeds the native quality governor, which holds a cheaper stream while the battery is low. */
+    external fun setBatteryStateNative(levelPercent: Int, charging: Boolean, powerSave: Boolean)
+
+    /**
+     * Replays an Annex B H.264/HEVC elementary stream at [fps] through the frame based decode
+     * path, either into MediaCodec or into a stand-in that only applies the keyframe filter, and
+     * returns a summary. [backgroundLoadThreads] busy threads run meanwhile to show how well the
+     * native thread policy holds the pacing under CPU load. Blocks for the length of the stream.
+     */
+    external fun replayVideoBitstreamNative(
+        path: String,
+        hevc: Boolean,
+        width: Int,
+        height: Int,
+        fps: Int,
+        useMediaCodec: Boolean,
+        backgroundLoadThreads: Int,
+    ): String
 }
@@ -23,8 +23,10 @@ import android.content.Intent
 import android.content.IntentFilter
 import android.hardware.usb.UsbDevice
 import android.hardware.usb.UsbManager
+import android.os.BatteryManager
 import android.os.Build
 import android.os.Bundle
+import android.os.PowerManager
 import android.os.Process
 import android.util.Log
 import androidx.activity.ComponentActivity
@@ -51,6 +53,7 @@ import com.nano71.cameramonitor.core.usb.UsbMonitor
 import com.nano71.cameramonitor.core.usb.UsbMonitor.findUvcDevice
 import com.nano71.cameramonitor.core.usb.UsbMonitor.getUsbManager
 import com.nano71.cameramonitor.core.usb.UsbMonitor.setState
+import com.nano71.cameramonitor.core.usb.UsbVideoNativeLibrary
 import com.nano71.cameramonitor.feature.streamer.adapter.StreamerScreensAdapter
 import com.nano71.cameramonitor.feature.streamer.animation.ZoomOutPageTransformer
 import kotlinx.coroutines.delay
@@ -107,6 +110,7 @@ class StreamerActivity : ComponentActivity() {
     private fun doOnCreate() {
         prepareCameraPermissionLaunchers()
         prepareUsbBroadcastReceivers()
+        prepareBatteryBroadcastReceivers()
         setContentView(R.layout.activity_streamer)
         viewPager = findViewById(R.id.view_pager)
         viewPager.offscreenPageLimit = 1
@@ -302,6 +306,31 @@ class StreamerActivity : ComponentActivity() {
             })
     }
 
+    private fun prepareBatteryBroadcastReceivers() {
+        registerReceiver(batteryReceiver, IntentFilter(Intent.ACTION_BATTERY_CHANGED))
+        registerReceiver(batteryReceiver, IntentFilter(PowerManager.ACTION_POWER_SAVE_MODE_CHANGED))
+        lifecycle.addObserver(
+            LifecycleEventObserver { _, event ->
+                if (event == Lifecycle.Event.ON_DESTROY) {
+                    unregisterReceiver(batteryReceiver)
+                }
+            })
+    }
+
+    private val batteryReceiver: BroadcastReceiver =
+        object : BroadcastReceiver() {
+            override fun onReceive(context: Context, intent: Intent) {
+                // ACTION_BATTERY_CHANGED is sticky, so the last battery state is always available.
+                val battery = registerReceiver(null, IntentFilter(Intent.ACTION_BATTERY_CHANGED)) ?: return
+                val level = battery.getIntExtra(BatteryManager.EXTRA_LEVEL, -1)
+                val scale = battery.getIntExtra(BatteryManager.EXTRA_SCALE, -1)
+                if (level < 0 || scale <= 0) return
+                val charging = battery.getIntExtra(BatteryManager.EXTRA_PLUGGED, 0) != 0
+                val powerSave = (getSystemService(POWER_SERVICE) as PowerManager).isPowerSaveMode
+                UsbVideoNativeLibrary.setBatteryStateNative(level * 100 / scale, charging, powerSave)
+            }
+        }
+
     private fun UsbDevice.loggingInfo(): String = "$productName by $manufacturerName at $deviceName"
 
     private val usbReceiver: BroadcastReceiver =
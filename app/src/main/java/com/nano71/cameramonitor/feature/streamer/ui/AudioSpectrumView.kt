@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.nano71.cameramonitor.feature.streamer.ui
+
+import android.content.Context
+import android.graphics.Canvas
+import android.graphics.Color
+import android.graphics.Paint
+import android.util.AttributeSet
+import android.view.View
+import com.nano71.cameramonitor.core.usb.UsbVideoNativeLibrary
+
+// Levels shown, in dBFS.
+private const val MIN_LEVEL_DB = -72f
+private const val MAX_LEVEL_DB = 0f
+
+// The native analyzer updates 30 times a second.
+private const val REFRESH_INTERVAL_MS = 33L
+
+/** Bars of the native audio spectrum analyzer along the bottom of the video. */
+class AudioSpectrumView @JvmOverloads constructor(
+    context: Context,
+    attrs: AttributeSet? = null
+) : View(context, attrs) {
+
+    private val bands = FloatArray(UsbVideoNativeLibrary.AUDIO_SPECTRUM_BANDS) { MIN_LEVEL_DB }
+    private var hasBands = false
+
+    private val paint = Paint().apply {
+        color = Color.GREEN
+        style = Paint.Style.FILL
+        alpha = 160
+    }
+
+    private val refresh = object : Runnable {
+        override fun run() {
+            hasBands = UsbVideoNativeLibrary.getAudioSpectrumNative(bands)
+            invalidate()
+            postDelayed(this, REFRESH_INTERVAL_MS)
+        }
+    }
+
+    override fun onVisibilityChanged(changedView: View, visibility: Int) {
+        super.onVisibilityChanged(changedView, visibility)
+        if (!isAttachedToWindow) return
+        removeCallbacks(refresh)
+        val shown = isShown
+        UsbVideoNativeLibrary.setAudioSpectrumEnabledNative(shown)
+        if (shown) post(refresh)
+    }
+
+    override fun onDetachedFromWindow() {
+        super.onDetachedFromWindow()
+        removeCallbacks(refresh)
+        UsbVideoNativeLibrary.setAudioSpectrumEnabledNative(false)
+    }
+
+    override fun onDraw(canvas: Canvas) {
+        super.onDraw(canvas)
+        if (!hasBands) return
+
+        val barWidth = width.toFloat() / bands.size
+        val maxHeight = height / 3f
+        for (i in bands.indices) {
+            val level = ((bands[i] - MIN_LEVEL_DB) / (MAX_LEVEL_DB - MIN_LEVEL_DB)).coerceIn(0f, 1f)
+            val left = i * barWidth
+            canvas.drawRect(left + 1f, height - level * maxHeight, left + barWidth - 1f, height.toFloat(), paint)
+        }
+    }
+}
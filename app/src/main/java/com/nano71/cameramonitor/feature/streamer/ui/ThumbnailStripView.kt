@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.nano71.cameramonitor.feature.streamer.ui
+
+import android.annotation.SuppressLint
+import android.content.Context
+import android.graphics.Bitmap
+import android.graphics.Canvas
+import android.graphics.Color
+import android.graphics.Paint
+import android.graphics.RectF
+import android.os.SystemClock
+import android.util.AttributeSet
+import android.view.MotionEvent
+import android.view.View
+import com.nano71.cameramonitor.core.usb.PresenterMode
+import com.nano71.cameramonitor.core.usb.UsbVideoNativeLibrary
+import com.nano71.cameramonitor.core.usb.UsbVideoNativeLibrary.THUMBNAIL_HEIGHT
+import com.nano71.cameramonitor.core.usb.UsbVideoNativeLibrary.THUMBNAIL_WIDTH
+
+// Two thumbnails a second in 16 MB, which holds a little over two minutes.
+private const val THUMBNAIL_INTERVAL_MS = 500
+private const val THUMBNAIL_MEMORY_CAP_BYTES = 16L * 1024 * 1024
+
+// The last ten seconds at preview quality for instant replay; LZ4 roughly halves typical frames.
+private const val REPLAY_DURATION_MS = 10_000
+private const val REPLAY_MEMORY_CAP_BYTES = 48L * 1024 * 1024
+// Faster than real time, so a replay gains on live video and ends once it catches up.
+private const val REPLAY_SPEED = 1.5f
+
+private const val REFRESH_INTERVAL_MS = THUMBNAIL_INTERVAL_MS.toLong()
+
+// Height of the strip and of the preview while scrubbing, in dp.
+private const val STRIP_HEIGHT_DP = 48f
+private const val PREVIEW_HEIGHT_DP = 180f
+
+/**
+ * A strip of thumbnails of the last minutes along the top of the video, oldest on the left.
+ * Dragging along the strip shows the thumbnail under the finger, and how long ago it was taken,
+ * in a larger preview. Letting go within the last ten seconds replays the video from there at
+ * 1.5x speed until it catches up with live video, and touching the strip during a replay goes
+ * back to live video at once. Replay needs the GL presenter; without it the strip only previews.
+ * The native timeline and replay cache run while the view is attached, so their history is there
+ * when the strip is shown.
+ */
+class ThumbnailStripView @JvmOverloads constructor(
+    context: Context,
+    attrs: AttributeSet? = null
+) : View(context, attrs) {
+
+    private val density = resources.displayMetrics.density
+    private val stripHeight = STRIP_HEIGHT_DP * density
+    private val previewHeight = PREVIEW_HEIGHT_DP * density
+
+    // Bitmaps of the cells of the strip, reused between refreshes.
+    private val cells = mutableListOf<Bitmap>()
+    private val preview = Bitmap.createBitmap(THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT, Bitmap.Config.ARGB_8888)
+    private var times = LongArray(0)
+    private var scrubTime: Long? = null
+
+    private val framePaint = Paint().apply {
+        color = Color.WHITE
+        style = Paint.Style.STROKE
+        strokeWidth = density
+    }
+    private val bitmapPaint = Paint(Paint.FILTER_BITMAP_FLAG)
+    private val textPaint = Paint(Paint.ANTI_ALIAS_FLAG).apply {
+        color = Color.WHITE
+        textSize = 14f * density
+        setShadowLayer(2f * density, 0f, 0f, Color.BLACK)
+    }
+
+    private val refresh = object : Runnable {
+        override fun run() {
+            times = UsbVideoNativeLibrary.getThumbnailTimesNative()
+            invalidate()
+            postDelayed(this, REFRESH_INTERVAL_MS)
+        }
+    }
+
+    override fun onAttachedToWindow() {
+        super.onAttachedToWindow()
+        UsbVideoNativeLibrary.setThumbnailTimelineNative(THUMBNAIL_INTERVAL_MS, THUMBNAIL_MEMORY_CAP_BYTES)
+        UsbVideoNativeLibrary.setReplayCacheNative(REPLAY_DURATION_MS, REPLAY_MEMORY_CAP_BYTES, compress = true)
+    }
+
+    override fun onVisibilityChanged(changedView: View, visibility: Int) {
+        super.onVisibilityChanged(changedView, visibility)
+        if (!isAttachedToWindow) return
+        removeCallbacks(refresh)
+        scrubTime = null
+        if (isShown) post(refresh)
+    }
+
+    override fun onDetachedFromWindow() {
+        super.onDetachedFromWindow()
+        removeCallbacks(refresh)
+        UsbVideoNativeLibrary.setThumbnailTimelineNative(0, 0)
+        UsbVideoNativeLibrary.setReplayCacheNative(0, 0, compress = false)
+    }
+
+    override fun onDraw(canvas: Canvas) {
+        super.onDraw(canvas)
+        if (times.isEmpty()) return
+
+        val cellWidth = stripHeight * THUMBNAIL_WIDTH / THUMBNAIL_HEIGHT
+        val cellCount = maxOf(1, (width / cellWidth).toInt())
+        while (cells.size < cellCount) {
+            cells.add(Bitmap.createBitmap(THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT, Bitmap.Config.ARGB_8888))
+        }
+        val left = (width - cellCount * cellWidth) / 2f
+        for (i in 0 until cellCount) {
+            val time = timeAt((i + 0.5f) / cellCount)
+            if (!UsbVideoNativeLibrary.getThumbnailNative(time, cells[i])) return
+            val rect = RectF(left + i * cellWidth, 0f, left + (i + 1) * cellWidth, stripHeight)
+            canvas.drawBitmap(cells[i], null, rect, bitmapPaint)
+        }
+        if (UsbVideoNativeLibrary.isReplayingNative()) {
+            canvas.drawText("REPLAY", left + 6f * density, stripHeight - 6f * density, textPaint)
+        }
+
+        val time = scrubTime ?: return
+        if (!UsbVideoNativeLibrary.getThumbnailNative(time, preview)) return
+        val previewWidth = previewHeight * THUMBNAIL_WIDTH / THUMBNAIL_HEIGHT
+        val rect = RectF(
+            (width - previewWidth) / 2f,
+            stripHeight + 8f * density,
+            (width + previewWidth) / 2f,
+            stripHeight + 8f * density + previewHeight,
+        )
+        canvas.drawBitmap(preview, null, rect, bitmapPaint)
+        canvas.drawRect(rect, framePaint)
+        val age = (SystemClock.uptimeMillis() - time) / 1000f
+        canvas.drawText("-%.1f s".format(age), rect.left + 6f * density, rect.bottom - 6f * density, textPaint)
+    }
+
+    @SuppressLint("ClickableViewAccessibility")
+    override fun onTouchEvent(event: MotionEvent): Boolean {
+        if (times.isEmpty()) return false
+        when (event.actionMasked) {
+            MotionEvent.ACTION_DOWN -> {
+                // Touches below the strip go on to the views underneath.
+                if (event.y > stripHeight) return false
+                if (UsbVideoNativeLibrary.isReplayingNative()) {
+                    UsbVideoNativeLibrary.stopReplayNative()
+                } else {
+                    scrubTime = timeAt(event.x / width)
+                }
+            }
+            MotionEvent.ACTION_MOVE -> if (scrubTime != null) scrubTime = timeAt(event.x / width)
+            MotionEvent.ACTION_UP -> {
+                val age = scrubTime?.let { SystemClock.uptimeMillis() - it }
+                val replayAvailable = UsbVideoNativeLibrary.getPresenterMode() == PresenterMode.Gl
+                if (replayAvailable && age != null && age <= REPLAY_DURATION_MS) {
+                    UsbVideoNativeLibrary.startReplayNative(age.toInt(), REPLAY_SPEED)
+                }
+                scrubTime = null
+            }
+            MotionEvent.ACTION_CANCEL -> scrubTime = null
+        }
+        invalidate()
+        return true
+    }
+
+    // Time of the thumbnail at a fraction of the timeline, from the oldest to the newest.
+    private fun timeAt(fraction: Float): Long {
+        val first = times.first()
+        val last = times.last()
+        return first + ((last - first) * fraction.coerceIn(0f, 1f)).toLong()
+    }
+}
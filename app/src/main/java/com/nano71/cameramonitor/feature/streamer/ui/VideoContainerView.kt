@@ -15,42 +15,182 @@
  */
 package com.nano71.cameramonitor.feature.streamer.ui
 
+import android.app.ActivityManager
 import android.content.Context
-import android.opengl.GLSurfaceView
 import android.util.AttributeSet
 import android.view.Gravity
+import android.view.SurfaceHolder
+import android.view.SurfaceView
 import android.widget.FrameLayout
 import androidx.core.view.isVisible
+import com.nano71.cameramonitor.core.usb.DeinterlaceMode
+import com.nano71.cameramonitor.core.usb.HdrTransfer
+import com.nano71.cameramonitor.core.usb.PresenterMode
+import com.nano71.cameramonitor.core.usb.ScaleFilter
 import com.nano71.cameramonitor.core.usb.UsbVideoNativeLibrary
+import java.io.File
+import kotlin.math.roundToInt
+
+private const val PROGRAM_CACHE_DIR_NAME = "shader_programs"
+
+// Native buffers of the pipeline, including the thumbnail timeline and replay cache.
+private const val NATIVE_MEMORY_BUDGET_BYTES = 192L * 1024 * 1024
+private const val LOW_RAM_NATIVE_MEMORY_BUDGET_BYTES = 96L * 1024 * 1024
 
 class VideoContainerView @JvmOverloads constructor(
     context: Context,
     attrs: AttributeSet? = null
-) : FrameLayout(context, attrs) {
-    private val renderer = UsbVideoNativeLibrary.VideoRenderer(context)
-
-    private var glSurfaceView: GLSurfaceView? = null
+) : FrameLayout(context, attrs), SurfaceHolder.Callback {
+    private var surfaceView: SurfaceView? = null
     private val gridOverlay = CameraGridOverlay(context)
+    private val audioSpectrumView = AudioSpectrumView(context).apply { visibility = GONE }
+    private val thumbnailStripView = ThumbnailStripView(context).apply { visibility = GONE }
+    private var showZebra = false
+    var hdrTransfer = HdrTransfer.Sdr
+        private set
+    private var hdrToneMap = true
+    // The presenter falls back to CpuBlit by itself when GL fails to start.
+    var presenterMode = PresenterMode.Gl
+        get() {
+            UsbVideoNativeLibrary.getPresenterMode()?.let { field = it }
+            return field
+        }
+        set(value) {
+            field = value
+            UsbVideoNativeLibrary.setPresenterModeNative(value.ordinal)
+        }
+    private var videoWidth = 0
+    private var videoHeight = 0
+    private var scaleFilter = ScaleFilter.Auto
+    private var scaleSharpness = 0f
+    var denoiseStrength = 0f
+        set(value) {
+            field = value
+            UsbVideoNativeLibrary.setDenoiseNative(value)
+        }
+    var frameMarkerVisible = false
+        set(value) {
+            field = value
+            UsbVideoNativeLibrary.setFrameMarkerVisibleNative(value)
+        }
+    var vectorscopeVisible = false
+        set(value) {
+            field = value
+            UsbVideoNativeLibrary.setVectorscopeVisibleNative(value)
+        }
+    var deinterlaceMode = DeinterlaceMode.Auto
+        set(value) {
+            field = value
+            UsbVideoNativeLibrary.setDeinterlaceModeNative(value.ordinal)
+        }
 
     fun toggleGridVisible() {
         gridOverlay.visibility = if (gridOverlay.isVisible) GONE else VISIBLE
     }
 
+    fun toggleAudioSpectrumVisible() {
+        audioSpectrumView.visibility = if (audioSpectrumView.isVisible) GONE else VISIBLE
+    }
+
+    fun setThumbnailStripVisible(visible: Boolean) {
+        thumbnailStripView.visibility = if (visible) VISIBLE else GONE
+    }
+
     fun setZebraVisible(visible: Boolean) {
-        renderer.showZebra = visible
+        showZebra = visible
+        UsbVideoNativeLibrary.setZebraVisibleNative(visible)
+    }
+
+    fun setHdrMode(transfer: HdrTransfer, toneMap: Boolean = true) {
+        hdrTransfer = transfer
+        hdrToneMap = toneMap
+        UsbVideoNativeLibrary.setHdrModeNative(transfer.ordinal, toneMap)
+    }
+
+    fun setScaler(filter: ScaleFilter, sharpness: Float = 0f) {
+        scaleFilter = filter
+        scaleSharpness = sharpness
+        UsbVideoNativeLibrary.setScalerNative(filter.ordinal, sharpness)
     }
 
     fun initialize(videoWidth: Int, videoHeight: Int) {
-        if (glSurfaceView != null) return
-        glSurfaceView = GLSurfaceView(context).apply {
-            setEGLContextClientVersion(3)
-            setRenderer(renderer)
-            renderMode = GLSurfaceView.RENDERMODE_CONTINUOUSLY
+        if (surfaceView != null) return
+        this.videoWidth = videoWidth
+        this.videoHeight = videoHeight
+        // Set before the thumbnail strip starts the optional caches, which take what is left.
+        val activityManager = context.getSystemService(Context.ACTIVITY_SERVICE) as ActivityManager
+        UsbVideoNativeLibrary.setMemoryBudgetNative(
+            if (activityManager.isLowRamDevice) LOW_RAM_NATIVE_MEMORY_BUDGET_BYTES else NATIVE_MEMORY_BUDGET_BYTES
+        )
+        surfaceView = SurfaceView(context).apply {
+            holder.addCallback(this@VideoContainerView)
+        }
+
+        addView(surfaceView, fittedLayoutParams(width, height))
+        addView(gridOverlay, fittedLayoutParams(width, height))
+        addView(audioSpectrumView, fittedLayoutParams(width, height))
+        addView(thumbnailStripView, fittedLayoutParams(width, height))
+    }
+
+    override fun onSizeChanged(w: Int, h: Int, oldw: Int, oldh: Int) {
+        super.onSizeChanged(w, h, oldw, oldh)
+        if (surfaceView == null) return
+        // Layout params can't change while the layout pass is running.
+        post {
+            surfaceView?.layoutParams = fittedLayoutParams(w, h)
+            gridOverlay.layoutParams = fittedLayoutParams(w, h)
+            audioSpectrumView.layoutParams = fittedLayoutParams(w, h)
+            thumbnailStripView.layoutParams = fittedLayoutParams(w, h)
+        }
+    }
+
+    /**
+     * Fits the video into the container at its aspect ratio. The surface then has the pixels of
+     * the screen area, and the native scaler resamples frames to it.
+     */
+    private fun fittedLayoutParams(containerWidth: Int, containerHeight: Int): LayoutParams {
+        if (containerWidth == 0 || containerHeight == 0) {
+            return LayoutParams(videoWidth, videoHeight, Gravity.CENTER)
         }
+        val scale = minOf(containerWidth.toFloat() / videoWidth, containerHeight.toFloat() / videoHeight)
+        return LayoutParams(
+            (videoWidth * scale).roundToInt(),
+            (videoHeight * scale).roundToInt(),
+            Gravity.CENTER,
+        )
+    }
 
-        val params = LayoutParams(videoWidth, videoHeight, Gravity.CENTER)
+    override fun surfaceCreated(holder: SurfaceHolder) {
+        UsbVideoNativeLibrary.attachSurfaceNative(
+            holder.surface,
+            context.assets,
+            File(context.codeCacheDir, PROGRAM_CACHE_DIR_NAME).absolutePath,
+            presenterMode.ordinal,
+        )
+        UsbVideoNativeLibrary.setZebraVisibleNative(showZebra)
+        UsbVideoNativeLibrary.setHdrModeNative(hdrTransfer.ordinal, hdrToneMap)
+        UsbVideoNativeLibrary.setDeinterlaceModeNative(deinterlaceMode.ordinal)
+        UsbVideoNativeLibrary.setScalerNative(scaleFilter.ordinal, scaleSharpness)
+        UsbVideoNativeLibrary.setDenoiseNative(denoiseStrength)
+        UsbVideoNativeLibrary.setFrameMarkerVisibleNative(frameMarkerVisible)
+        UsbVideoNativeLibrary.setVectorscopeVisibleNative(vectorscopeVisible)
+        display?.let { display ->
+            // Modes at other resolutions would make the panel switch resolution too.
+            val current = display.mode
+            val rates = display.supportedModes
+                .filter { it.physicalWidth == current.physicalWidth && it.physicalHeight == current.physicalHeight }
+                .map { it.refreshRate }
+                .distinct()
+            UsbVideoNativeLibrary.setDisplayRefreshRatesNative(rates.toFloatArray())
+        }
+    }
+
+    override fun surfaceChanged(holder: SurfaceHolder, format: Int, width: Int, height: Int) {
+        UsbVideoNativeLibrary.surfaceChangedNative()
+    }
 
-        addView(glSurfaceView, params)
-        addView(gridOverlay, params)
+    override fun surfaceDestroyed(holder: SurfaceHolder) {
+        // Blocks until the render thread has released the window.
+        UsbVideoNativeLibrary.detachSurfaceNative()
     }
 }
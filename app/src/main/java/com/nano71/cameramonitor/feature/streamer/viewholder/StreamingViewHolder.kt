@@ -26,6 +26,9 @@ import androidx.lifecycle.lifecycleScope
 import androidx.lifecycle.repeatOnLifecycle
 import androidx.recyclerview.widget.RecyclerView
 import com.nano71.cameramonitor.R
+import com.nano71.cameramonitor.core.usb.DeinterlaceMode
+import com.nano71.cameramonitor.core.usb.HdrTransfer
+import com.nano71.cameramonitor.core.usb.PresenterMode
 import com.nano71.cameramonitor.feature.streamer.StreamerScreen
 import com.nano71.cameramonitor.feature.streamer.StreamerViewModel
 import com.nano71.cameramonitor.feature.streamer.ui.VideoContainerView
@@ -76,13 +79,50 @@ class StreamingViewHolder(
             Log.i(TAG, "offButton clicked")
             onNavigate(StreamerScreen.Status)
         }
+        backButton.setOnLongClickListener {
+            // Cycles the temporal denoiser: off, medium and strong.
+            val strengths = listOf(0f, 0.5f, 1f)
+            val next = (strengths.indexOf(videoContainerView.denoiseStrength) + 1) % strengths.size
+            videoContainerView.denoiseStrength = strengths[next]
+            Log.i(TAG, "Denoise strength ${videoContainerView.denoiseStrength}")
+            true
+        }
         gridButton.setOnClickListener {
             videoContainerView.toggleGridVisible()
         }
+        gridButton.setOnLongClickListener {
+            // Cycles the deinterlacer: automatic, off, bob and motion adaptive.
+            val modes = DeinterlaceMode.entries
+            videoContainerView.deinterlaceMode = modes[(videoContainerView.deinterlaceMode.ordinal + 1) % modes.size]
+            Log.i(TAG, "Deinterlace mode ${videoContainerView.deinterlaceMode}")
+            true
+        }
         zebraPrintButton.setOnClickListener {
+            // Cycles the exposure and color aids: none, zebra, vectorscope and both.
+            if (showZebra) videoContainerView.vectorscopeVisible = !videoContainerView.vectorscopeVisible
             showZebra = !showZebra
             videoContainerView.setZebraVisible(showZebra)
         }
+        zebraPrintButton.setOnLongClickListener {
+            // Cycles how 10-bit sources are decoded: SDR, PQ and HLG (tone mapped to SDR).
+            val transfers = HdrTransfer.entries
+            val transfer = transfers[(videoContainerView.hdrTransfer.ordinal + 1) % transfers.size]
+            videoContainerView.setHdrMode(transfer)
+            Log.i(TAG, "HDR transfer $transfer")
+            true
+        }
+        streamStatsTextView.setOnClickListener {
+            videoContainerView.toggleAudioSpectrumVisible()
+        }
+        streamStatsTextView.setOnLongClickListener {
+            // Switches between the GL and the CPU blit presenter, to compare them on the device.
+            videoContainerView.presenterMode = when (videoContainerView.presenterMode) {
+                PresenterMode.Gl -> PresenterMode.CpuBlit
+                PresenterMode.CpuBlit -> PresenterMode.Gl
+            }
+            Log.i(TAG, "Presenter mode ${videoContainerView.presenterMode}")
+            true
+        }
     }
 
     private fun setupToolbarToggle() {
@@ -97,10 +137,13 @@ class StreamingViewHolder(
     }
 
     private fun toggleToolbar() {
+        // The thumbnail strip of the last minutes comes and goes with the toolbar.
         if (bottomToolbar.isVisible) {
             fadeOut(bottomToolbar)
+            videoContainerView.setThumbnailStripVisible(false)
         } else {
             fadeIn(bottomToolbar)
+            videoContainerView.setThumbnailStripVisible(true)
         }
     }
 
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "QualityGovernor.h"
+
+namespace {
+
+// A window of a 60 fps source whose capture takes 4 ms a frame and whose frames are all replaced
+// before anything takes them.
+StageCounters replacedWindow(bool presenting) {
+    StageCounters counters;
+    for (int i = 0; i < 60; i++) {
+        counters.frames++;
+        counters.capture += 4ms;
+        counters.recordReplaced(presenting);
+    }
+    return counters;
+}
+
+} // namespace
+
+TEST(QualityGovernorTests, ReplayLeavesTheStepUnchanged) {
+    // The presenter shows the replay cache and takes no live frames meanwhile.
+    StageCounters counters = replacedWindow(false);
+    EXPECT_EQ(counters.dropped, 0u);
+    EXPECT_EQ(counters.unpresented, 60u);
+    EXPECT_FALSE(QualityGovernor::pipelineBehind(counters, 60));
+}
+
+TEST(QualityGovernorTests, DroppedFramesWhilePresentingAreBehind) {
+    StageCounters counters = replacedWindow(true);
+    EXPECT_EQ(counters.dropped, 60u);
+    EXPECT_TRUE(QualityGovernor::pipelineBehind(counters, 60));
+}
+
+TEST(QualityGovernorTests, SlowStagesAreBehind) {
+    StageCounters counters;
+    counters.frames = 30;
+    counters.capture = 30 * 15ms;
+    counters.upload = 30 * 5ms;
+    EXPECT_TRUE(QualityGovernor::pipelineBehind(counters, 60));
+    EXPECT_FALSE(QualityGovernor::pipelineBehind(counters, 30));
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.nano71.cameramonitor.usb
+
+import com.nano71.cameramonitor.core.usb.FrameMarkerAnalyzer
+import com.nano71.cameramonitor.core.usb.FrameMarkerDecoder
+import com.nano71.cameramonitor.core.usb.FrameMarkerReading
+import org.junit.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertNull
+
+/** Tests [FrameMarkerDecoder] and [FrameMarkerAnalyzer.report] */
+class FrameMarkerDecoderTests {
+    @Test
+    fun `decodes a bar code inside a row of video`() {
+        val row = markerRow(sequence = 123456, millis = 0x89abcdefL, cell = 3, left = 40, width = 400)
+        assertEquals(FrameMarkerReading(123456, 0x89abcdefL), FrameMarkerDecoder.decodeRow(row))
+    }
+
+    @Test
+    fun `rejects a bar code with a wrong checksum`() {
+        val row = markerRow(sequence = 7, millis = 1000, cell = 4, left = 10, width = 400, flipBit = 50)
+        assertNull(FrameMarkerDecoder.decodeRow(row))
+    }
+
+    @Test
+    fun `reports shown and missing frames`() {
+        val readings = listOf(
+            FrameMarkerReading(1, 1000),
+            FrameMarkerReading(1, 1000),
+            null,
+            FrameMarkerReading(2, 1016),
+            FrameMarkerReading(2, 1016),
+            FrameMarkerReading(4, 1050),
+        )
+        val report = FrameMarkerAnalyzer.report(readings, recordingFps = 100.0)
+        assertEquals(3, report.shownFrames)
+        assertEquals(5, report.decodedFrames)
+        assertEquals(1, report.missingFrames)
+        assertEquals(25.0, report.meanIntervalMillis, 1e-9)
+    }
+
+    private fun markerRow(
+        sequence: Long,
+        millis: Long,
+        cell: Int,
+        left: Int,
+        width: Int,
+        flipBit: Int = -1,
+    ): IntArray {
+        val folded = sequence xor millis
+        val checksum = (folded xor (folded shr 8) xor (folded shr 16) xor (folded shr 24)) and 0xff
+        val bits = mutableListOf(true, false, true)
+        for (i in 31 downTo 0) bits.add((sequence shr i and 1L) == 1L)
+        for (i in 31 downTo 0) bits.add((millis shr i and 1L) == 1L)
+        for (i in 7 downTo 0) bits.add((checksum shr i and 1L) == 1L)
+        bits.addAll(listOf(true, false, true))
+        if (flipBit >= 0) bits[flipBit] = !bits[flipBit]
+
+        // Mid gray video around the black band of the marker.
+        val row = IntArray(width) { 128 }
+        for (x in left - 2 * cell until left + (bits.size + 2) * cell) row[x] = 16
+        bits.forEachIndexed { i, bit ->
+            if (bit) for (x in left + i * cell until left + (i + 1) * cell) row[x] = 235
+        }
+        return row
+    }
+}
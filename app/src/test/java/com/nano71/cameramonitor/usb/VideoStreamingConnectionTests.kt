@@ -19,6 +19,7 @@ package com.nano71.cameramonitor.usb
 import android.hardware.usb.UsbDevice
 import android.hardware.usb.UsbDeviceConnection
 import android.util.Log
+import com.nano71.cameramonitor.core.connection.LibuvcFrameFormat
 import com.nano71.cameramonitor.core.connection.VideoFormat
 import com.nano71.cameramonitor.core.connection.VideoStreamingConnection
 import io.mockk.MockKAnnotations
@@ -73,6 +74,35 @@ class VideoStreamingConnectionTests {
         videoFormatAndFrameTester(CamLink, "YUY2", 1920, 1080, 59)
     }
 
+    @Test
+    fun `uncompressed fourcc formats map to libuvc frame formats`() {
+        mapOf(
+            "YUY2" to LibuvcFrameFormat.UVC_FRAME_FORMAT_YUYV,
+            "UYVY" to LibuvcFrameFormat.UVC_FRAME_FORMAT_UYVY,
+            "NV12" to LibuvcFrameFormat.UVC_FRAME_FORMAT_NV12,
+            "P010" to LibuvcFrameFormat.UVC_FRAME_FORMAT_P010,
+            "BGR3" to LibuvcFrameFormat.UVC_FRAME_FORMAT_BGR,
+            "Y800" to LibuvcFrameFormat.UVC_FRAME_FORMAT_GRAY8,
+            "Y16 " to LibuvcFrameFormat.UVC_FRAME_FORMAT_GRAY16,
+            "I420" to LibuvcFrameFormat.UVC_FRAME_FORMAT_ANY,
+            "YV12" to LibuvcFrameFormat.UVC_FRAME_FORMAT_ANY,
+            "RGB3" to LibuvcFrameFormat.UVC_FRAME_FORMAT_ANY,
+        ).forEach { (fourcc, libuvcFrameFormat) ->
+            assertEquals(expected = libuvcFrameFormat, VideoFormat(fourcc, 1920, 1080, 30).toLibuvcFrameFormat())
+        }
+    }
+
+    @Test
+    fun `frame based fourcc formats map to libuvc frame formats`() {
+        mapOf(
+            "H264" to LibuvcFrameFormat.UVC_FRAME_FORMAT_H264,
+            "HEVC" to LibuvcFrameFormat.UVC_FRAME_FORMAT_ANY,
+            "H265" to LibuvcFrameFormat.UVC_FRAME_FORMAT_ANY,
+        ).forEach { (fourcc, libuvcFrameFormat) ->
+            assertEquals(expected = libuvcFrameFormat, VideoFormat(fourcc, 1920, 1080, 30).toLibuvcFrameFormat())
+        }
+    }
+
     private fun videoFormatAndFrameTester(
         usbDescriptor: String,
         fourccFormat: String,